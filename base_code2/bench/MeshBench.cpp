@@ -0,0 +1,296 @@
+// Microbenchmarks de las etapas CPU de la malla (sin contexto GL).
+// Las mallas sinteticas salen de MeshGenerator (terreno sin normales).
+// Uso: MeshBench [--max-tris N] [--models a.obj,b.obj] [--no-models] [--no-synthetic]
+//                [--min-time S] [--csv ARCHIVO] [--tmp DIR]
+// Se ejecuta desde base_code2 (los modelos se buscan en objetos3D/).
+#include "src/MeshPipeline.h"
+#include "src/AllocTracker.h"
+#include "src/Bounds.h"
+#include "src/MeshGenerator.h"
+#include "src/NormalGenerator.h"
+#include "src/TangentGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+namespace {
+
+struct BenchOptions {
+    unsigned long long maxTris = 50000000ull;
+    std::vector<std::string> models;
+    bool runModels = true;
+    bool runSynthetic = true;
+    double minTime = 0.3;
+    std::string csvPath;
+    std::string tmpDir;
+};
+
+struct StageResult {
+    std::string input;
+    const char* stage = "";
+    unsigned long long tris = 0;
+    // Bytes leidos o producidos por la etapa (para MB/s)
+    unsigned long long dataBytes = 0;
+    double medianMs = 0.0;
+    int reps = 0;
+    unsigned long long allocs = 0;
+    unsigned long long allocBytes = 0;
+};
+
+double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Repite 'body' hasta acumular minTime segundos (al menos una vez).
+// 'setup' restaura la entrada entre repeticiones y no se mide.
+// 'bytes' se evalua al final: algunas etapas solo conocen su salida despues de correr.
+template <typename Setup, typename Body, typename Bytes>
+StageResult measure(const BenchOptions& opt, const std::string& input, const char* stage, unsigned long long tris, Setup setup, Body body, Bytes bytes) {
+    StageResult r;
+    r.input = input;
+    r.stage = stage;
+    r.tris = tris;
+    std::vector<double> times;
+    double total = 0.0;
+    while (times.empty() || (total < opt.minTime && times.size() < 1000)) {
+        setup();
+        // Solo las que llegan al heap
+        AllocCounters c0 = processAllocCounters();
+        double t0 = nowSeconds();
+        body();
+        double t = nowSeconds() - t0;
+        // Se queda con la ultima: la primera incluye los bloques que la arena de carga
+        // pide al heap una sola vez
+        AllocCounters c1 = processAllocCounters();
+        r.allocs = c1.allocations - c0.allocations;
+        r.allocBytes = c1.bytes - c0.bytes;
+        times.push_back(t);
+        total += t;
+    }
+    std::sort(times.begin(), times.end());
+    r.medianMs = times[times.size() / 2] * 1000.0;
+    r.reps = (int)times.size();
+    r.dataBytes = bytes();
+    return r;
+}
+
+unsigned long long fileSize(const std::string& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : (unsigned long long)size;
+}
+
+// Corre todas las etapas sobre un OBJ, en el mismo orden que C3DViewer::loadOBJ
+void benchFile(const BenchOptions& opt, const std::string& label, const std::string& path, std::vector<StageResult>& results) {
+    // Como en el visor, lo leido vive en la arena de carga: en el heap solo quedan
+    // unas pocas asignaciones por carga (materiales, nombres), no una por cara
+    LoadArena& arena = LoadArena::instance();
+    std::optional<ObjData> obj;
+    std::string warn, err;
+    results.push_back(measure(opt, label, "parse", 0,
+        [&]() { obj.reset(); arena.rewind(); obj.emplace(&arena); warn.clear(); err.clear(); },
+        [&]() { if (!parseOBJ(path, *obj, warn, err)) std::cerr << "Error al leer " << path << ": " << err << std::endl; },
+        [&]() { return fileSize(path); }));
+    unsigned long long tris = obj->triangleCount();
+    results.back().tris = tris;
+    if (tris == 0) {
+        obj.reset();
+        arena.rewind();
+        return;
+    }
+
+    VertexStreams vertices;
+    std::vector<SubMesh> subMeshes;
+    std::vector<Material> materials;
+    std::vector<MaterialRange> ranges;
+    results.push_back(measure(opt, label, "flatten", tris,
+        [&]() { vertices = VertexStreams(); subMeshes = std::vector<SubMesh>(); materials.clear(); ranges.clear(); },
+        [&]() { flattenOBJ(*obj, 0, vertices, subMeshes, materials, ranges); },
+        [&]() { return (unsigned long long)(vertices.size() * VertexStreams::bytesPerVertex()); }));
+    // Lo leido ya no hace falta (con 50M triangulos son varios GB)
+    obj.reset();
+    arena.rewind();
+
+    std::vector<Model> models(1);
+    Model& model = models[0];
+    model.name = label;
+    model.subMeshCount = subMeshes.size();
+    model.vertexCount = vertices.size();
+    const unsigned long long vertexBytes = vertices.size() * VertexStreams::bytesPerVertex();
+    results.push_back(measure(opt, label, "bounds", tris,
+        []() {},
+        [&]() { computeBounds(vertices, subMeshes, model); },
+        [&]() { return vertexBytes; }));
+
+    results.push_back(measure(opt, label, "normals", tris,
+        [&]() { for (auto* a : { &vertices.nx, &vertices.ny, &vertices.nz }) std::fill(a->begin(), a->end(), 0.0f); },
+        [&]() { computeFlatNormals(vertices); },
+        [&]() { return vertexBytes; }));
+
+    // Suaves con soldado de posiciones y pliegue de 60 grados (en el pool de hilos)
+    NormalSettings smooth;
+    results.push_back(measure(opt, label, "smooth_normals", tris,
+        []() {},
+        [&]() { generateNormals(vertices, 0, vertices.size(), nullptr, smooth); },
+        [&]() { return vertexBytes; }));
+
+    // Tangentes de todos los sub-mallados (un trabajo del pool por sub-mallado)
+    std::vector<VertexSpan> spans;
+    for (const SubMesh& sub : subMeshes) spans.push_back(VertexSpan{ sub.firstVertex, sub.indexCount });
+    results.push_back(measure(opt, label, "tangents", tris,
+        []() {},
+        [&]() { generateTangents(vertices, spans); },
+        [&]() { return vertexBytes; }));
+
+    std::vector<float> lines;
+    results.push_back(measure(opt, label, "normal_lines", tris,
+        [&]() { lines = std::vector<float>(); },
+        [&]() { lines.resize(normalLineFloats(models)); buildNormalLines(vertices, models, 0.05f, lines.data()); },
+        [&]() { return (unsigned long long)(lines.size() * sizeof(float)); }));
+    lines = std::vector<float>();
+
+    // Intercalado para el VBO (lo que hace setupMeshBuffers antes de subir)
+    std::vector<Vertex> interleaved;
+    results.push_back(measure(opt, label, "interleave", tris,
+        [&]() { interleaved = std::vector<Vertex>(); },
+        [&]() { interleaved.resize(vertices.size()); vertices.interleave(0, vertices.size(), interleaved.data()); },
+        [&]() { return vertexBytes; }));
+    interleaved = std::vector<Vertex>();
+
+    // Grafo minimo: raiz -> modelo -> sub-mallados (matrices identidad)
+    SceneGraph scene;
+    model.node = scene.addNode(SceneNodeType::Model, model.name, scene.root(), 0);
+    for (size_t i = 0; i < subMeshes.size(); i++) {
+        subMeshes[i].node = scene.addNode(SceneNodeType::SubMesh, subMeshes[i].name, model.node, (int)i);
+    }
+    scene.update();
+    std::string outPath = (std::filesystem::path(opt.tmpDir) / "meshbench_export.obj").string();
+    results.push_back(measure(opt, label, "export", tris,
+        []() {},
+        [&]() { writeOBJ(outPath, vertices, subMeshes, materials, ranges, models.size(), scene); },
+        [&]() { return fileSize(outPath); }));
+    std::error_code ec;
+    std::filesystem::remove(outPath, ec);
+    std::filesystem::remove((std::filesystem::path(opt.tmpDir) / "meshbench_export.mtl"), ec);
+}
+
+void printResult(const StageResult& r) {
+    double seconds = r.medianMs / 1000.0;
+    double mtris = seconds > 0.0 ? r.tris / seconds / 1e6 : 0.0;
+    double mbs = seconds > 0.0 ? r.dataBytes / seconds / (1024.0 * 1024.0) : 0.0;
+    printf("%-22s %-13s %11llu %11.3f %10.2f %10.1f %10llu %11.2f %5d\n", r.input.c_str(), r.stage, r.tris,
+        r.medianMs, mtris, mbs, r.allocs, r.allocBytes / (1024.0 * 1024.0), r.reps);
+}
+
+bool writeCSV(const std::string& path, const std::vector<StageResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "input,stage,triangles,median_ms,mtris_per_s,mb_per_s,allocs,alloc_mb,reps\n";
+    for (const auto& r : results) {
+        double seconds = r.medianMs / 1000.0;
+        out << r.input << "," << r.stage << "," << r.tris << "," << r.medianMs << ","
+            << (seconds > 0.0 ? r.tris / seconds / 1e6 : 0.0) << ","
+            << (seconds > 0.0 ? r.dataBytes / seconds / (1024.0 * 1024.0) : 0.0) << ","
+            << r.allocs << "," << r.allocBytes / (1024.0 * 1024.0) << "," << r.reps << "\n";
+    }
+    return true;
+}
+
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+bool parseArgs(int argc, char** argv, BenchOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--max-tris" && hasValue) opt.maxTris = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--models" && hasValue) opt.models = splitList(argv[++i]);
+        else if (arg == "--no-models") opt.runModels = false;
+        else if (arg == "--no-synthetic") opt.runSynthetic = false;
+        else if (arg == "--min-time" && hasValue) opt.minTime = std::atof(argv[++i]);
+        else if (arg == "--csv" && hasValue) opt.csvPath = argv[++i];
+        else if (arg == "--tmp" && hasValue) opt.tmpDir = argv[++i];
+        else {
+            fprintf(stderr, "Argumento desconocido: %s\n", arg.c_str());
+            fprintf(stderr, "Uso: MeshBench [--max-tris N] [--models a.obj,b.obj] [--no-models] [--no-synthetic]\n"
+                "                 [--min-time S] [--csv ARCHIVO] [--tmp DIR]\n");
+            return false;
+        }
+    }
+    if (opt.tmpDir.empty()) {
+        std::error_code ec;
+        opt.tmpDir = std::filesystem::temp_directory_path(ec).string();
+        if (ec) opt.tmpDir = ".";
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!parseArgs(argc, argv, opt)) return 2;
+    std::vector<StageResult> results;
+    printf("%-22s %-13s %11s %11s %10s %10s %10s %11s %5s\n", "entrada", "etapa", "triangulos", "ms (med)", "Mtri/s", "MB/s", "allocs", "MB asign.", "reps");
+    size_t printed = 0;
+    auto printNew = [&]() { for (; printed < results.size(); printed++) printResult(results[printed]); };
+
+    if (opt.runModels) {
+        std::vector<std::string> models = opt.models;
+        if (models.empty()) {
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator("objetos3D", ec)) {
+                if (entry.path().extension() == ".obj") models.push_back(entry.path().filename().string());
+            }
+            std::sort(models.begin(), models.end());
+        }
+        for (const auto& name : models) {
+            benchFile(opt, name, "objetos3D/" + name, results);
+            printNew();
+        }
+    }
+    if (opt.runSynthetic) {
+        // 10K a 50M triangulos; a 50M el aplanado solo ocupa ~4.5 GB
+        const unsigned long long sizes[] = { 10000ull, 100000ull, 1000000ull, 10000000ull, 50000000ull };
+        for (unsigned long long tris : sizes) {
+            if (tris > opt.maxTris) break;
+            std::string path = (std::filesystem::path(opt.tmpDir) / ("meshbench_terreno_" + std::to_string(tris) + ".obj")).string();
+            // Sin normales en el archivo: computeFlatNormals hace todo el trabajo, como con un escaneo crudo
+            GeneratorParams params;
+            params.shape = GeneratedShape::Terrain;
+            params.triangles = tris;
+            params.normals = false;
+            std::string error;
+            if (!generateOBJ(path, params, nullptr, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            benchFile(opt, "terreno_" + std::to_string(tris), path, results);
+            printNew();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            std::filesystem::path mtl(path);
+            std::filesystem::remove(mtl.replace_extension(".mtl"), ec);
+        }
+    }
+    if (!opt.csvPath.empty()) {
+        if (!writeCSV(opt.csvPath, results)) {
+            std::cerr << "No se pudo escribir " << opt.csvPath << std::endl;
+            return 1;
+        }
+        std::cout << "Resultados en " << opt.csvPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Generador de OBJ/MTL sinteticos para pruebas de estres.
+// Uso: MeshGen [--shape esfera|terreno|ensamblado] [--tris N] [--groups G] [--materials M]
+//              [--seed S] [--no-normals] [--texcoords] salida.obj
+#include "src/MeshGenerator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static void printUsage() {
+    printf("Uso: MeshGen [opciones] salida.obj\n"
+        "  --shape S       esfera, terreno o ensamblado (por defecto esfera)\n"
+        "  --tris N        Triangulos aproximados (por defecto 1000000)\n"
+        "  --groups G      Grupos 'g' (en el ensamblado, una pieza por grupo)\n"
+        "  --materials M   Materiales repartidos entre los grupos\n"
+        "  --seed S        Semilla (misma semilla, mismo archivo)\n"
+        "  --no-normals    No escribir 'vn'\n"
+        "  --texcoords     Escribir 'vt'\n");
+}
+
+int main(int argc, char** argv) {
+    GeneratorParams params;
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--shape" && hasValue) {
+            if (!parseShapeName(argv[++i], params.shape)) {
+                fprintf(stderr, "Forma desconocida: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (arg == "--tris" && hasValue) params.triangles = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--groups" && hasValue) params.groups = std::atoi(argv[++i]);
+        else if (arg == "--materials" && hasValue) params.materials = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) params.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--no-normals") params.normals = false;
+        else if (arg == "--texcoords") params.texcoords = true;
+        else if (arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] != '-' && output.empty()) output = arg;
+        else {
+            fprintf(stderr, "Argumento desconocido: %s\n", arg.c_str());
+            printUsage();
+            return 2;
+        }
+    }
+    if (output.empty()) {
+        printUsage();
+        return 2;
+    }
+    GeneratorStats stats;
+    std::string error;
+    if (!generateOBJ(output, params, &stats, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    printf("%s: %llu triangulos, %llu vertices, %d grupos, %d materiales, %.1f MB en %.2f s (%.1f MB/s)\n",
+        output.c_str(), stats.triangles, stats.vertices, stats.groups, stats.materials,
+        stats.bytes / (1024.0 * 1024.0), stats.seconds, stats.bytes / (1024.0 * 1024.0) / std::max(stats.seconds, 1e-9));
+    return 0;
+}
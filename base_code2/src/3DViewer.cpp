@@ -1,22 +1,414 @@
 #include "3DViewer.h"
 #include <iostream>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 #include <glm/gtc/type_ptr.hpp> 
+#include <filesystem>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <optional>
+#include "ImageWriter.h"
+#include "Parallel.h"
+
+// Hacia la luz direccional (sin normalizar, el shader la normaliza)
+static const glm::vec3 kSunDirection(0.2f, 0.5f, 0.8f);
+
+static glm::vec3 frontFromAngles(float yaw, float pitch) {
+    glm::vec3 front;
+    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    return glm::normalize(front);
+}
+
+// Bytes que un comando GL sube a un buffer: en m_frameArena o, si heap es true, en
+// un bloque de operator new que el comando libera tras subirlo
+struct UploadSpan {
+    const void* data;
+    size_t bytes;
+    bool heap;
+};
+
+// Lo mas que una subida por frame (slider) toma de m_frameArena; lo que pasa de esto
+// va al heap para no dejar bloques del tamano de la malla en cada slot del anillo
+static const size_t kMaxFrameUpload = 4u << 20;
+
+// ImGui reserva con malloc: pasarlo por operator new para que AllocTracker lo cuente
+static void* imguiAlloc(size_t size, void*) { return ::operator new(size, std::nothrow); }
+static void imguiFree(void* p, void*) { ::operator delete(p); }
 
 C3DViewer::C3DViewer() {}
 
 C3DViewer::~C3DViewer() {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    // El contexto GL tiene que volver a este hilo antes de liberar recursos
+    stopRenderThread();
+    if (m_generatorThread.joinable()) m_generatorThread.join();
+    // Lo capturado desde el ultimo volcado (solo si se pidio la captura)
+#if PROFILER_ENABLED
+    if (Profiler::eventCount() > 0 && PROFILE_DUMP("traza_cpu.json")) std::cout << "Traza CPU guardada en traza_cpu.json" << std::endl;
+#endif
+    if (!m_headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_drawIdVbo) glDeleteBuffers(1, &m_drawIdVbo);
     if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_drawDataTex) glDeleteTextures(1, &m_drawDataTex);
+    if (m_drawDataBuffer) glDeleteBuffers(1, &m_drawDataBuffer);
+    if (m_lightTextures[0]) glDeleteTextures(3, m_lightTextures);
+    if (m_lightBuffers[0]) glDeleteBuffers(3, m_lightBuffers);
     if (m_shaderProgram) glDeleteProgram(m_shaderProgram);
+    m_textures.destroyGL();
+    m_shadowMaps.destroy();
+    m_ssaoPass.destroy();
+    destroySceneTarget();
+    m_gpuProfiler.destroy();
+    if (m_headless) {
+        if (m_outputColorRbo) glDeleteRenderbuffers(1, &m_outputColorRbo);
+        if (m_outputDepthRbo) glDeleteRenderbuffers(1, &m_outputDepthRbo);
+        if (m_outputFbo) glDeleteFramebuffers(1, &m_outputFbo);
+        m_headlessContext.destroy();
+        return;
+    }
     if (m_window) glfwDestroyWindow(m_window);
     glfwTerminate();
 }
 
+bool C3DViewer::setupHeadless(int w, int h) {
+    m_headless = true;
+    m_onDemandRendering = false;
+    if (!m_headlessContext.create()) return false;
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress)) return false;
+    width = w;
+    height = h;
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_LINE_SMOOTH);
+    if (!setupShader()) return false;
+    m_gpuProfiler.init();
+    m_textures.init();
+    // Sin framebuffer por defecto: todo termina en este FBO del tamanno pedido
+    glGenFramebuffers(1, &m_outputFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_outputFbo);
+    glGenRenderbuffers(1, &m_outputColorRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_outputColorRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_outputColorRbo);
+    glGenRenderbuffers(1, &m_outputDepthRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_outputDepthRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_outputDepthRbo);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        fprintf(stderr, "ERROR::FRAMEBUFFER:: FBO de salida %dx%d incompleto\n", w, h);
+        return false;
+    }
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "Modo headless " << w << "x" << h << " (" << (renderer ? renderer : "?") << ")" << std::endl;
+    return true;
+}
+
+void C3DViewer::applyCameraPreset(const CameraPreset& preset) {
+    // Orbita alrededor de la posicion inicial del primer modelo
+    const glm::vec3 target(0.0f, 0.0f, -3.0f);
+    const float distance = 4.5f;
+    CameraKey key;
+    key.yaw = preset.yaw;
+    key.pitch = preset.pitch;
+    key.position = target - frontFromAngles(preset.yaw, preset.pitch) * distance;
+    applyCameraKey(key);
+}
+
+void C3DViewer::applyCameraKey(const CameraKey& key) {
+    m_cameraYaw = key.yaw;
+    m_cameraPitch = key.pitch;
+    m_cameraFront = frontFromAngles(m_cameraYaw, m_cameraPitch);
+    m_cameraPos = key.position;
+    m_prevCameraPos = m_viewPos = m_cameraPos;
+    m_prevCameraYaw = m_cameraYaw;
+    m_prevCameraPitch = m_cameraPitch;
+    m_viewFront = m_cameraFront;
+}
+
+static double benchNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Cadena JSON entre comillas: escapa comillas, barras y caracteres de control
+static void writeJsonString(std::ofstream& out, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        unsigned char ch = (unsigned char)*c;
+        switch (ch) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (ch < 0x20) out << "\\u00" << hex[ch >> 4] << hex[ch & 15];
+            else out << *c;
+        }
+    }
+    out << '"';
+}
+
+static void writeStatsJson(std::ofstream& out, const FrameStats& s) {
+    out << "{\"mean\": " << s.mean << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+        << ", \"min\": " << s.min << ", \"max\": " << s.max << "}";
+}
+
+int C3DViewer::runBenchmark(const BatchJob& job) {
+    PROFILE_FUNCTION();
+    const BenchmarkJob& bench = job.benchmark;
+    std::vector<CameraKey> path;
+    if (!buildCameraPath(bench.path, bench.frames, glm::vec3(0.0f, 0.0f, -3.0f), path)) {
+        std::cerr << "Camino de camara invalido: " << bench.path << std::endl;
+        return 1;
+    }
+    // Medir el costo real de cada frame: sin vsync, sin cache y sin hilo de render
+    if (m_window) glfwSwapInterval(0);
+    m_useSceneCache = false;
+    m_useRenderThread = false;
+    m_gpuProfiling = true;
+    m_checkAllocations = job.checkAllocations;
+    m_textureBudgetMB = job.textureBudgetMB;
+    m_shadows = job.shadows;
+    m_spotEnabled = job.spot;
+    struct BenchCase { std::string name; bool wireframe, normals, vertices, culling; int lights, ssao; };
+    const int lights = job.lightCounts.empty() ? 0 : job.lightCounts.front();
+    const int ssao = job.ssaoPreset;
+    std::vector<BenchCase> cases = {
+        { "base", false, false, false, true, lights, ssao },
+        { "wireframe", true, false, false, true, lights, ssao },
+        { "normales", false, true, false, true, lights, ssao },
+        { "vertices", false, false, true, true, lights, ssao },
+        { "sin_culling", false, false, false, false, lights, ssao },
+    };
+    // Mismo camino con cada cantidad de luces: el tiempo de frame deberia quedar plano
+    if (job.lightCounts.size() > 1) {
+        for (int n : job.lightCounts) cases.push_back({ "luces_" + std::to_string(n), false, false, false, true, n, ssao });
+    }
+    // Costo de cada preajuste de SSAO (pasada "ssao" del desglose GPU)
+    for (int p = 0; p < kSsaoPresets; p++) cases.push_back({ std::string("ssao_") + ssaoPresetName(p), false, false, false, true, lights, p });
+    const int warmup = 10;
+    std::ofstream json(bench.jsonPath);
+    if (!json.is_open()) {
+        std::cerr << "No se pudo abrir " << bench.jsonPath << std::endl;
+        return 1;
+    }
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    json << "{\n  \"renderer\": ";
+    writeJsonString(json, renderer ? renderer : "?");
+    json << ",\n";
+    json << "  \"width\": " << width << ", \"height\": " << height << ", \"headless\": " << (m_headless ? "true" : "false") << ",\n";
+    json << "  \"path\": ";
+    writeJsonString(json, bench.path.c_str());
+    json << ", \"frames\": " << bench.frames << ", \"budget_ms\": " << bench.budgetMs << ",\n";
+    json << "  \"runs\": [";
+    int failures = 0;
+    bool overBudget = false;
+    bool firstRun = true;
+    for (const auto& modelName : job.models) {
+        if (!loadOBJ(modelName)) {
+            std::cerr << "Error al cargar: " << modelName << std::endl;
+            failures++;
+            continue;
+        }
+        // Se mide el estado estable: todas las texturas ya en la GPU (y agrupadas)
+        m_textures.finish();
+        buildSnapshot(m_snapshots.back());
+        while (m_textures.busy()) {
+            m_textures.finish();
+            buildSnapshot(m_snapshots.back());
+        }
+        for (const BenchCase& c : cases) {
+            m_showTriangles = true;
+            m_showWireframe = c.wireframe;
+            m_showNormals = c.normals;
+            m_showVertices = c.vertices;
+            m_enableCulling = c.culling;
+            m_ssao = c.ssao >= 0;
+            m_ssaoPreset = std::max(c.ssao, 0);
+            if (m_lightCount != c.lights) {
+                m_lightCount = c.lights;
+                m_lightsDirty = true;
+            }
+            std::vector<float> frameMs, snapshotMs, submitMs, gpuWaitMs, lightMs;
+            // Reservados de antemano: el bucle medido no deberia asignar nada
+            for (auto* v : { &frameMs, &snapshotMs, &submitMs, &gpuWaitMs, &lightMs }) v->reserve(bench.frames);
+            FrameAllocStats allocs;
+            // Cada caso calienta de nuevo: el driver compila variantes para el estado nuevo
+            m_renderCalls = 0;
+            m_gpuProfiler.flush();
+            m_gpuProfiler.resetHistory();
+            unsigned long long firstFrameId = 0;
+            int shadowUpdates = 0;
+            for (int i = -warmup; i < bench.frames; i++) {
+                PROFILE_SCOPE("Frame de benchmark");
+                applyCameraKey(path[std::max(i, 0)]);
+                if (i == 0) shadowUpdates = m_shadowUpdates;
+                double t0 = benchNow();
+                AllocCounters allocsBefore = threadAllocCounters();
+                RenderSnapshot& snap = m_snapshots.back();
+                buildSnapshot(snap);
+                double t1 = benchNow();
+                uploadTextures(snap);
+                render(snap);
+                double t2 = benchNow();
+                if (m_window) glfwSwapBuffers(m_window);
+                glFinish();
+                double t3 = benchNow();
+                allocs.add(allocsBefore, threadAllocCounters(), i >= 0);
+                if (m_window) glfwPollEvents();
+                if (i < 0) continue;
+                if (i == 0) firstFrameId = snap.frameId;
+                frameMs.push_back((float)((t3 - t0) * 1000.0));
+                snapshotMs.push_back((float)((t1 - t0) * 1000.0));
+                submitMs.push_back((float)((t2 - t1) * 1000.0));
+                gpuWaitMs.push_back((float)((t3 - t2) * 1000.0));
+                lightMs.push_back(m_lightAssignMs);
+            }
+            // Tiempos GPU por pasada de los frames medidos (el historial guarda los ultimos 240)
+            m_gpuProfiler.flush();
+            GpuTimingHistory h;
+            m_gpuProfiler.copyHistory(h);
+            double passSum[GpuTimingHistory::kPasses] = {};
+            double gpuSum = 0.0;
+            int gpuFrames = 0;
+            for (int k = 0; k < h.count; k++) {
+                if (h.frameIds[k] < firstFrameId) continue;
+                for (int p = 0; p < GpuTimingHistory::kPasses; p++) passSum[p] += h.passMs[p][k];
+                gpuSum += h.frameMs[k];
+                gpuFrames++;
+            }
+            FrameStats frame = computeFrameStats(frameMs);
+            bool over = bench.budgetMs > 0.0f && frame.p95 > bench.budgetMs;
+            overBudget = overBudget || over;
+            json << (firstRun ? "\n" : ",\n") << "    {\"model\": ";
+            writeJsonString(json, modelName.c_str());
+            json << ", \"case\": ";
+            writeJsonString(json, c.name.c_str());
+            json << ",\n";
+            json << "     \"frame_ms\": ";
+            writeStatsJson(json, frame);
+            json << ",\n     \"phases_ms\": {\"snapshot\": ";
+            writeStatsJson(json, computeFrameStats(snapshotMs));
+            json << ", \"render_submit\": ";
+            writeStatsJson(json, computeFrameStats(submitMs));
+            json << ", \"gpu_wait\": ";
+            writeStatsJson(json, computeFrameStats(gpuWaitMs));
+            json << "},\n     \"gpu_passes_mean_ms\": {";
+            for (int p = 0; p < GpuTimingHistory::kPasses; p++) {
+                json << "\"" << GpuProfiler::passName((GpuPass)p) << "\": " << (gpuFrames ? passSum[p] / gpuFrames : 0.0) << ", ";
+            }
+            json << "\"total\": " << (gpuFrames ? gpuSum / gpuFrames : 0.0) << ", \"samples\": " << gpuFrames << "},\n";
+            json << "     \"lights\": {\"count\": " << m_lights.size() << ", \"indices\": " << m_lightIndices << ", \"dropped\": " << m_lightsDropped
+                << ", \"assign_ms\": ";
+            writeStatsJson(json, computeFrameStats(lightMs));
+            json << "},\n";
+            json << "     \"shadows\": {\"casters\": [" << m_shadowCasters[0] << ", " << m_shadowCasters[1] << "], \"map_updates\": "
+                << m_shadowUpdates - shadowUpdates << "},\n";
+            json << "     \"allocations\": {\"max_per_frame\": " << allocs.max << ", \"frames_with_allocations\": " << allocs.framesWithAllocations << "},\n";
+            json << "     \"over_budget\": " << (over ? "true" : "false") << "}";
+            firstRun = false;
+            printf("%-20s %-16s media %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f ms  asig. max %llu/frame%s\n", modelName.c_str(), c.name.c_str(),
+                frame.mean, frame.p50, frame.p95, frame.p99, allocs.max, over ? "  [FUERA DE PRESUPUESTO]" : "");
+        }
+    }
+    json << "\n  ],\n  \"failures\": " << failures << ", \"over_budget\": " << (overBudget ? "true" : "false")
+        << ", \"alloc_violations\": " << allocViolations() << "\n}\n";
+    if (m_checkAllocations) std::cout << "Asignaciones dentro de render(): " << allocViolations() << std::endl;
+    std::cout << "Resultados en " << bench.jsonPath << std::endl;
+    if (failures > 0) return 1;
+    return overBudget ? 3 : 0;
+}
+
+bool C3DViewer::saveFrame(const std::string& path) {
+    PROFILE_FUNCTION();
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_outputFbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    // Imagen opaca aunque el shader escriba alfa
+    for (size_t i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+    return writePNG(path, width, height, pixels.data(), true);
+}
+
+int C3DViewer::runBatch(const BatchJob& job) {
+    PROFILE_FUNCTION();
+    std::error_code ec;
+    std::filesystem::create_directories(job.outputDir, ec);
+    m_showWireframe = job.wireframe;
+    m_showNormals = job.normals;
+    m_showVertices = job.vertices;
+    // Cada captura se dibuja completa: la cache de escena no aporta nada
+    m_useSceneCache = false;
+    m_checkAllocations = job.checkAllocations;
+    m_textureBudgetMB = job.textureBudgetMB;
+    m_lightCount = job.lightCounts.empty() ? 0 : job.lightCounts.front();
+    m_lightsDirty = true;
+    m_shadows = job.shadows;
+    m_spotEnabled = job.spot;
+    m_ssao = job.ssaoPreset >= 0;
+    m_ssaoPreset = std::max(job.ssaoPreset, 0);
+    int failures = 0;
+    for (const auto& modelName : job.models) {
+        double loadStart = benchNow();
+        if (!loadOBJ(modelName)) {
+            std::cerr << "Error al cargar: " << modelName << std::endl;
+            failures++;
+            continue;
+        }
+        // La captura tiene que salir con las texturas completas
+        m_textures.finish();
+        TextureStats ts = m_textures.stats();
+        if (ts.requested > 0) {
+            printf("Texturas: %d en GPU (%d de la cache, %d comprimidas) a %.0f ms de empezar la carga, %.1f MB (%.1f MB sin comprimir)\n", ts.uploaded,
+                ts.cacheHits, ts.encoded, (benchNow() - loadStart) * 1000.0, ts.gpuBytes / (1024.0 * 1024.0), ts.rawBytes / (1024.0 * 1024.0));
+        }
+        if (job.smoothAngle >= 0.0f) {
+            m_normalSettings.smooth = true;
+            m_normalSettings.creaseAngle = job.smoothAngle;
+            regenerateNormals();
+        }
+        std::string stem = std::filesystem::path(modelName).stem().string();
+        int shadowUpdates = m_shadowUpdates;
+        for (const auto& cameraName : job.cameras) {
+            const CameraPreset* preset = findCameraPreset(cameraName);
+            if (!preset) { failures++; continue; }
+            applyCameraPreset(*preset);
+            // Mismo camino que el visor interactivo
+            RenderSnapshot& snap = m_snapshots.back();
+            buildSnapshot(snap);
+            // La camara nueva puede pedir niveles mas finos (o agrupar texturas): se leen y suben antes de capturar
+            while (m_textures.busy()) {
+                m_textures.finish();
+                buildSnapshot(snap);
+            }
+            render(snap);
+            std::string out = (std::filesystem::path(job.outputDir) / (stem + "_" + cameraName + ".png")).string();
+            if (saveFrame(out)) std::cout << "Render: " << out << std::endl;
+            else { std::cerr << "Error al escribir: " << out << std::endl; failures++; }
+        }
+        if (m_shadows) {
+            printf("Sombras: %d sub-mallados proyectan (direccional), %d (foco); mapas dibujados %d veces para %zu camaras\n",
+                m_shadowCasters[0], m_shadowCasters[1], m_shadowUpdates - shadowUpdates, job.cameras.size());
+        }
+        ts = m_textures.stats();
+        if (ts.requested > 0) {
+            printf("Texturas tras las capturas: %.1f MB residentes (la vista pide %.1f MB, presupuesto %.0f MB), %llu niveles leidos, %llu descartados, %d agrupadas (%d arrays, %d atlas), %d llamadas de relleno\n",
+                ts.gpuBytes / (1024.0 * 1024.0), ts.wantedBytes / (1024.0 * 1024.0), ts.budgetBytes / (1024.0 * 1024.0),
+                ts.streamedLevels, ts.evictedLevels, ts.grouped, ts.arrays, ts.atlases, m_fillDrawCalls.load());
+        }
+    }
+    return failures;
+}
+
 bool C3DViewer::setup() {
     if (!glfwInit()) return false;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -32,30 +424,44 @@ bool C3DViewer::setup() {
     glEnable(GL_LINE_SMOOTH);
     // ImGui Setup
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(imguiAlloc, imguiFree);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     ImGui::StyleColorsDark();
     ImGui_ImplGlfw_InitForOpenGL(m_window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
+    // Crea los objetos GL del backend ahora, mientras el contexto es de este hilo
+    ImGui_ImplOpenGL3_NewFrame();
     glfwSetWindowUserPointer(m_window, this);
     glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* w, int width, int height) {
-        auto p = (C3DViewer*)glfwGetWindowUserPointer(w); if (p) p->resize(width, height);
+        auto p = (C3DViewer*)glfwGetWindowUserPointer(w); if (p) { p->resize(width, height); p->requestRedraw(); }
+        });
+    glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* w) {
+        auto p = (C3DViewer*)glfwGetWindowUserPointer(w); if (p) p->requestRedraw();
         });
     if (!setupShader()) return false;
+    m_gpuProfiler.init();
+    m_textures.init();
     // Cargar Modelo
     //if (!loadOBJ("Blender_2.obj")) std::cout << "Error cargando OBJ." << std::endl;
     // Callbacks
     glfwSetKeyCallback(m_window, keyCallbackStatic);
     glfwSetMouseButtonCallback(m_window, mouseButtonCallbackStatic);
     glfwSetCursorPosCallback(m_window, cursorPosCallbackStatic);
+    glfwSetScrollCallback(m_window, scrollCallbackStatic);
+    glfwSetCharCallback(m_window, charCallbackStatic);
     return true;
 }
 
-void C3DViewer::update() {
-    // Grados por segundo
-    float cameraSpeed = 2.5f * 0.016f;
-    float rotateSpeed = 100.0f * 0.016f; 
+void C3DViewer::update(float dt) {
+    PROFILE_FUNCTION();
+    m_prevCameraPos = m_cameraPos;
+    m_prevCameraYaw = m_cameraYaw;
+    m_prevCameraPitch = m_cameraPitch;
+    // Unidades y grados por segundo
+    float cameraSpeed = 2.5f * dt;
+    float rotateSpeed = 100.0f * dt; 
     // MOVERSE ADELANTE/ATRAS 
     if (glfwGetKey(m_window, GLFW_KEY_UP) == GLFW_PRESS)
         m_cameraPos += cameraSpeed * m_cameraFront;
@@ -66,26 +472,458 @@ void C3DViewer::update() {
         m_cameraYaw -= rotateSpeed;
     if (glfwGetKey(m_window, GLFW_KEY_RIGHT) == GLFW_PRESS)
         m_cameraYaw += rotateSpeed;
+    // Mientras se mantenga una flecha la camara sigue moviendose
+    if (glfwGetKey(m_window, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(m_window, GLFW_KEY_DOWN) == GLFW_PRESS ||
+        glfwGetKey(m_window, GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(m_window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+        requestRedraw();
     // Recalcular vector Front
-    glm::vec3 front;
-    front.x = cos(glm::radians(m_cameraYaw)) * cos(glm::radians(m_cameraPitch));
-    front.y = sin(glm::radians(m_cameraPitch));
-    front.z = sin(glm::radians(m_cameraYaw)) * cos(glm::radians(m_cameraPitch));
-    m_cameraFront = glm::normalize(front);
+    m_cameraFront = frontFromAngles(m_cameraYaw, m_cameraPitch);
+    if (m_recordingPath) {
+        CameraKey key;
+        key.position = m_cameraPos;
+        key.yaw = m_cameraYaw;
+        key.pitch = m_cameraPitch;
+        m_recordedPath.push_back(key);
+    }
+    // Animaciones
+    for (auto& m : m_models) {
+        m.prevSpinAngle = m.spinAngle;
+        if (!m.spinning) continue;
+        m.spinAngle += m_spinSpeed * dt;
+        requestRedraw();
+    }
+    if (m_animateLights && !m_lights.empty()) {
+        m_lightTime += dt;
+        requestRedraw();
+    }
+}
+
+void C3DViewer::interpolateState(float alpha) {
+    PROFILE_FUNCTION();
+    m_viewPos = glm::mix(m_prevCameraPos, m_cameraPos, alpha);
+    m_viewFront = frontFromAngles(glm::mix(m_prevCameraYaw, m_cameraYaw, alpha), glm::mix(m_prevCameraPitch, m_cameraPitch, alpha));
+    for (const auto& m : m_models) {
+        if (m.spinAngle == m.prevSpinAngle && !m.spinning) continue;
+        float angle = glm::mix(m.prevSpinAngle, m.spinAngle, alpha);
+        m_scene.node(m.normalizeNode).rotation = glm::angleAxis(glm::radians(angle), glm::vec3(0, 1, 0));
+        m_scene.markDirty(m.normalizeNode);
+    }
 }
 
 void C3DViewer::mainLoop() {
+    PROFILE_THREAD_NAME("Principal");
+    m_lastFrame = glfwGetTime();
     while (!glfwWindowShouldClose(m_window)) {
-        float currentFrame = glfwGetTime();
-        float deltaTime = currentFrame - m_lastFrame;
+        // Cambio de modo entre frames, nunca a mitad de uno
+        if (m_useRenderThread && !m_renderThreadRunning) startRenderThread();
+        else if (!m_useRenderThread && m_renderThreadRunning) stopRenderThread();
+        beginFrameArena();
+        // Resultado de un picking resuelto por el render en un frame anterior
+        int picked = -1;
+        bool hasPick = false;
+        {
+            std::lock_guard<std::mutex> lock(m_pickMutex);
+            if (m_pickResultReady) { picked = m_pickResult; m_pickResultReady = false; hasPick = true; }
+        }
+        if (hasPick) applyPickResult(picked);
+        if (m_onDemandRendering && m_redrawFrames <= 0) {
+            // Nada cambio: bloquear hasta el proximo evento (o timeout)
+            PROFILE_SCOPE("Reposo (esperando eventos)");
+            glfwWaitEventsTimeout(m_idleTimeout);
+            if (m_redrawFrames <= 0) continue;
+            // El tiempo en reposo no se simula
+            m_lastFrame = glfwGetTime();
+            m_simAccumulator = 0.0;
+        }
+        else {
+            PROFILE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        double currentFrame = glfwGetTime();
+        double deltaTime = currentFrame - m_lastFrame;
         m_lastFrame = currentFrame;
-        glfwPollEvents();
-        // Procesa movimiento cmara continuo
-        update(); 
-        // Render
-        render();
-        glfwSwapBuffers(m_window);
+        AllocCounters frameAllocs = threadAllocCounters();
+        // Evitar la espiral de la muerte tras un frame muy lento
+        m_simAccumulator += std::min(deltaTime, 0.25);
+        // Procesa movimiento de camara y animaciones a paso fijo
+        m_ticksThisFrame = 0;
+        while (m_simAccumulator >= m_simStep) {
+            update((float)m_simStep);
+            m_simAccumulator -= m_simStep;
+            m_ticksThisFrame++;
+        }
+        interpolateState((float)(m_simAccumulator / m_simStep));
+        double updateEnd = glfwGetTime();
+        // UI + snapshot: a partir de aqui el render no toca el estado de la escena
+        RenderSnapshot& snap = m_snapshots.back();
+        buildSnapshot(snap);
+        double buildEnd = glfwGetTime();
+        if (m_renderThreadRunning) {
+            m_snapshots.publish();
+            // Como mucho un frame por delante del render
+            PROFILE_SCOPE("Esperar al render");
+            m_snapshots.waitConsumed(m_simStep);
+        }
+        else {
+            executeRenderCommands(snap.frameId);
+            uploadTextures(snap);
+            render(snap);
+            {
+                PROFILE_SCOPE("glfwSwapBuffers");
+                glfwSwapBuffers(m_window);
+            }
+            recordPresent(snap, buildEnd);
+        }
+        m_updateTimeMs = (float)((updateEnd - currentFrame) * 1000.0);
+        m_buildTimeMs = (float)((buildEnd - updateEnd) * 1000.0);
+        m_frameTimeMs = (float)(deltaTime * 1000.0);
+        // Sin hilo de render incluye lo que asigne render()
+        m_mainAllocs.add(frameAllocs, threadAllocCounters(), m_renderedFrames >= kAllocWarmupFrames);
+        m_renderedFrames++;
+        if (m_redrawFrames > 0) m_redrawFrames--;
+    }
+    stopRenderThread();
+}
+
+void C3DViewer::buildSnapshot(RenderSnapshot& snap) {
+    PROFILE_FUNCTION();
+    beginFrameArena();
+    // La UI va primero para que sus cambios entren en este mismo frame
+    if (!m_headless) {
+        drawInterface();
+        snap.ui.copyFrom(ImGui::GetDrawData());
+    }
+    else {
+        snap.ui.copyFrom(nullptr);
+    }
+    // Matrices de mundo cacheadas (solo se recalculan los nodos sucios)
+    m_scene.update();
+    snap.frameId = ++m_snapshotCounter;
+    snap.width = std::max(width, 1);
+    snap.height = std::max(height, 1);
+    snap.viewPos = m_viewPos;
+    snap.view = glm::lookAt(m_viewPos, m_viewPos + m_viewFront, m_cameraUp);
+    snap.projection = glm::perspective(glm::radians(45.0f), (float)snap.width / snap.height, 0.1f, 100.0f);
+    RenderOptions& o = snap.options;
+    o.showTriangles = m_showTriangles;
+    o.showWireframe = m_showWireframe;
+    o.showVertices = m_showVertices;
+    o.showNormals = m_showNormals;
+    o.showBoundingBox = m_showBoundingBox;
+    o.enableZBuffer = m_enableZBuffer;
+    o.enableCulling = m_enableCulling;
+    o.enableAntiAliasing = m_enableAntiAliasing;
+    o.useSceneCache = m_useSceneCache;
+    o.gpuProfiling = m_gpuProfiling;
+    o.checkAllocations = m_checkAllocations;
+    o.textureUploadBytes = (size_t)std::max(m_textureUploadMB, 1) << 20;
+    o.batchDraws = m_batchDraws;
+    o.pcfRadius = m_pcfRadius;
+    o.ssao = ssaoPreset(m_ssaoPreset);
+    o.ssao.enabled = m_ssao;
+    o.ssao.radius = m_ssaoRadius;
+    o.ssao.strength = m_ssaoStrength;
+    o.pointSize = m_pointSize;
+    o.bgColor = m_bgColor;
+    o.wireframeColor = m_wireframeColor;
+    o.vertexColor = m_vertexColor;
+    o.normalsColor = m_normalsColor;
+    o.boundingBoxColor = m_boundingBoxColor;
+    // clear() conserva la capacidad: sin reservas en estado estable
+    snap.items.clear();
+    snap.ranges.clear();
+    snap.selectedItem = -1;
+    m_itemOfSubMesh.assign(m_subMeshes.size(), -1);
+    for (int i = 0; i < (int)m_subMeshes.size(); i++) {
+        const SubMesh& sub = m_subMeshes[i];
+        if (!sub.visible) continue;
+        m_itemOfSubMesh[i] = (int)snap.items.size();
+        DrawItem item;
+        item.model = m_scene.world(sub.node);
+        item.normalMatrix = m_scene.normalMatrix(sub.node);
+        item.firstVertex = sub.firstVertex;
+        item.vertexCount = sub.indexCount;
+        item.subMesh = i;
+        if (i == m_selectedSubMeshIndex) {
+            snap.selectedItem = (int)snap.items.size();
+            if (m_showBoundingBox) snap.selectedBox = selectedBoxTransform();
+        }
+        snap.items.push_back(item);
     }
+    // Rangos visibles en orden de material
+    m_materialSwitches = 0;
+    for (unsigned int r : m_drawOrder) {
+        const MaterialRange& range = m_materialRanges[r];
+        int item = m_itemOfSubMesh[range.subMesh];
+        if (item < 0) continue;
+        if (snap.ranges.empty() || snap.ranges.back().material != range.material) m_materialSwitches++;
+        DrawRange dr;
+        dr.item = item;
+        dr.material = range.material;
+        dr.range = (int)r;
+        dr.color = m_materials[range.material].diffuseColor;
+        dr.texture = m_useTextures ? m_materials[range.material].diffuseTexture : -1;
+        dr.normalTexture = m_useTextures && m_useNormalMaps ? m_materials[range.material].normalTexture : -1;
+        dr.firstVertex = range.firstVertex;
+        dr.vertexCount = range.vertexCount;
+        snap.ranges.push_back(dr);
+    }
+    updateTextureResidency(snap);
+    updateLights(snap);
+    updateShadows(snap);
+    // Mientras haya texturas en camino se sigue dibujando para subirlas
+    if (m_textures.busy()) requestRedraw();
+    snap.sceneKey = computeSceneKey();
+    snap.pickRequested = m_pickPending;
+    snap.pickX = m_pickX;
+    snap.pickY = m_pickY;
+    m_pickPending = false;
+    snap.inputTime = m_pendingInputTime;
+    m_pendingInputTime = 0.0;
+}
+
+void C3DViewer::startRenderThread() {
+    // El contexto solo puede estar activo en un hilo a la vez
+    glfwMakeContextCurrent(nullptr);
+    m_renderThreadStop = false;
+    // El hilo nuevo vuelve a calentar antes de vigilar asignaciones
+    m_renderCalls = 0;
+    m_renderThreadRunning = true;
+    m_renderThread = std::thread(&C3DViewer::renderThreadMain, this);
+    std::cout << "Hilo de render iniciado." << std::endl;
+}
+
+void C3DViewer::stopRenderThread() {
+    if (!m_renderThreadRunning) return;
+    m_renderThreadStop = true;
+    m_snapshots.wake();
+    m_renderThread.join();
+    m_renderThreadRunning = false;
+    glfwMakeContextCurrent(m_window);
+    // Trabajo GL encolado que el render no llego a ejecutar (todo es de frames <= el siguiente)
+    executeRenderCommands(m_snapshotCounter + 1);
+    std::cout << "Hilo de render detenido." << std::endl;
+}
+
+void C3DViewer::renderThreadMain() {
+    PROFILE_THREAD_NAME("Render");
+    glfwMakeContextCurrent(m_window);
+    while (!m_renderThreadStop) {
+        {
+            PROFILE_SCOPE("Esperar snapshot");
+            m_snapshots.waitFresh();
+        }
+        if (!m_snapshots.acquire(m_renderSnapshot)) continue;
+        double start = glfwGetTime();
+        executeRenderCommands(m_renderSnapshot.frameId);
+        uploadTextures(m_renderSnapshot);
+        render(m_renderSnapshot);
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(m_window);
+        }
+        recordPresent(m_renderSnapshot, start);
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+void C3DViewer::runOnRenderThread(std::function<void()> fn) {
+    if (!m_renderThreadRunning) {
+        // Sin hilo dedicado el contexto es nuestro: ejecutar ya
+        fn();
+        return;
+    }
+    // Se ejecuta antes de dibujar el snapshot que se esta armando
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    m_renderCommands.emplace_back(m_snapshotCounter + 1, std::move(fn));
+}
+
+void C3DViewer::executeRenderCommands(unsigned long long upToFrame) {
+    PROFILE_FUNCTION();
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        // Los comandos de snapshots posteriores esperan a su frame. Particion estable a
+        // mano: std::stable_partition pide un buffer temporal al heap en cada llamada
+        size_t keep = 0;
+        for (size_t i = 0; i < m_renderCommands.size(); i++) {
+            if (m_renderCommands[i].first <= upToFrame) m_executingCommands.push_back(std::move(m_renderCommands[i]));
+            else if (keep++ != i) m_renderCommands[keep - 1] = std::move(m_renderCommands[i]);
+        }
+        m_renderCommands.erase(m_renderCommands.begin() + keep, m_renderCommands.end());
+    }
+    for (auto& c : m_executingCommands) c.second();
+    m_executingCommands.clear();
+    {
+        // Lo que esos comandos leian de m_frameArena ya se puede reutilizar
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_retiredFrame = std::max(m_retiredFrame, upToFrame);
+    }
+    m_commandsDone.notify_all();
+}
+
+void C3DViewer::uploadTextures(const RenderSnapshot& snap) {
+    // Un nivel nuevo cambia la imagen: la capa de escena cacheada ya no sirve
+    if (m_textures.upload(snap.options.textureUploadBytes)) m_sceneCacheValid = false;
+}
+
+void C3DViewer::updateTextureResidency(const RenderSnapshot& snap) {
+    PROFILE_FUNCTION();
+    // Pixeles por unidad de mundo a distancia 1 (fov vertical de 45 grados)
+    const float pixelsPerUnit = snap.height / (2.0f * std::tan(glm::radians(22.5f)));
+    m_textureUses.clear();
+    for (const DrawRange& dr : snap.ranges) {
+        if (dr.texture < 0 && dr.normalTexture < 0) continue;
+        // Esfera que envuelve la caja del sub-mallado; la textura ocupa a lo sumo su diametro
+        const DrawItem& item = snap.items[dr.item];
+        const SubMesh& sub = m_subMeshes[item.subMesh];
+        glm::vec3 center = glm::vec3(item.model * glm::vec4((sub.min + sub.max) * 0.5f, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(item.model[0])),
+            std::max(glm::length(glm::vec3(item.model[1])), glm::length(glm::vec3(item.model[2]))));
+        float radius = glm::length(sub.max - sub.min) * 0.5f * scale;
+        float distance = std::max(glm::length(center - snap.viewPos) - radius, 0.1f);
+        TextureUse use;
+        use.pixels = std::min(2.0f * radius / distance * pixelsPerUnit, 16384.0f);
+        // El mapa de normales cubre la misma superficie que la textura difusa
+        for (int id : { dr.texture, dr.normalTexture }) {
+            if (id < 0) continue;
+            use.id = id;
+            m_textureUses.push_back(use);
+        }
+    }
+    m_textures.updateResidency(m_textureUses, (size_t)std::max(m_textureBudgetMB, 1) << 20);
+}
+
+void C3DViewer::updateLights(RenderSnapshot& snap) {
+    PROFILE_FUNCTION();
+    // Una carga nueva cambia la caja de la escena
+    if (m_lightsGeometry != m_geometryVersion) m_lightsDirty = true;
+    if (m_lightsDirty) {
+        m_lightsDirty = false;
+        m_lightsGeometry = m_geometryVersion;
+        m_lightsVersion++;
+        m_lights.clear();
+        m_lightBase.clear();
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        for (const SubMesh& sub : m_subMeshes) {
+            const glm::mat4& world = m_scene.world(sub.node);
+            for (int k = 0; k < 8; k++) {
+                glm::vec3 corner((k & 1) ? sub.max.x : sub.min.x, (k & 2) ? sub.max.y : sub.min.y, (k & 4) ? sub.max.z : sub.min.z);
+                glm::vec3 p = glm::vec3(world * glm::vec4(corner, 1.0f));
+                lo = glm::min(lo, p);
+                hi = glm::max(hi, p);
+            }
+        }
+        if (!m_subMeshes.empty()) {
+            // Algo mas grande que la escena para que tambien haya luces alrededor
+            glm::vec3 center = (lo + hi) * 0.5f, half = (hi - lo) * 0.6f;
+            float radius = std::max(glm::length(hi - lo) * m_lightRadiusPercent, 1e-3f);
+            // Volumen proporcional a la cantidad: cada punto recibe en promedio las mismas luces
+            if (m_lightConstantDensity) half *= std::cbrt(std::max(m_lightCount, 64) / 64.0f);
+            std::mt19937 rng((unsigned)m_lightSeed);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f), hue(0.0f, 1.0f);
+            for (int i = 0; i < m_lightCount; i++) {
+                PointLight light;
+                light.position = center + half * glm::vec3(unit(rng), unit(rng), unit(rng));
+                light.radius = radius;
+                // Color saturado de tono al azar
+                glm::vec3 h = glm::abs(glm::fract(glm::vec3(hue(rng)) + glm::vec3(0.0f, 2.0f / 3.0f, 1.0f / 3.0f)) * 6.0f - 3.0f) - 1.0f;
+                light.color = glm::clamp(h, 0.0f, 1.0f);
+                light.intensity = m_lightIntensity;
+                m_lights.push_back(light);
+                m_lightBase.push_back(light.position);
+            }
+        }
+        m_lightPoseTime = -1.0f;
+    }
+    if (m_lightPoseTime != m_lightTime) {
+        // Cada luz gira alrededor de su posicion base, con fase y sentido segun su indice
+        m_lightPoseTime = m_lightTime;
+        for (size_t i = 0; i < m_lights.size(); i++) {
+            float angle = (i & 1 ? m_lightTime : -m_lightTime) + 2.4f * (float)i;
+            float orbit = m_lights[i].radius * 0.5f;
+            m_lights[i].position = m_lightBase[i] + orbit * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+        }
+        m_lightsVersion++;
+    }
+    auto start = std::chrono::steady_clock::now();
+    m_lightClusters.build(m_lights, snap.view, snap.projection, snap.lights);
+    m_lightAssignMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_lightIndices = snap.lights.indices.size();
+    m_lightsDropped = snap.lights.dropped;
+}
+
+void C3DViewer::bindLights(const RenderSnapshot& snap) {
+    const LightClusters& lc = snap.lights;
+    const int count = (int)lc.lightCount();
+    glUniform1i(m_uniforms.lightCount, count);
+    if (count == 0) return;
+    if (!m_lightBuffers[0]) {
+        glGenBuffers(3, m_lightBuffers);
+        glGenTextures(3, m_lightTextures);
+        const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for (int k = 0; k < 3; k++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffers[k]);
+            glBindTexture(GL_TEXTURE_BUFFER, m_lightTextures[k]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[k], m_lightBuffers[k]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+    const void* data[3] = { lc.lights.data(), lc.grid.data(), lc.indices.data() };
+    const size_t bytes[3] = { lc.lights.size() * sizeof(glm::vec4), lc.grid.size() * sizeof(uint32_t), lc.indices.size() * sizeof(uint32_t) };
+    for (int k = 0; k < 3; k++) {
+        // Huerfano como drawData; nunca vacio (un buffer de 0 bytes no se puede enlazar)
+        glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffers[k]);
+        m_lightBufferBytes[k] = std::max(m_lightBufferBytes[k], std::max(bytes[k], sizeof(glm::vec4)));
+        glBufferData(GL_TEXTURE_BUFFER, m_lightBufferBytes[k], nullptr, GL_STREAM_DRAW);
+        if (bytes[k]) glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes[k], data[k]);
+        glActiveTexture(GL_TEXTURE5 + k);
+        glBindTexture(GL_TEXTURE_BUFFER, m_lightTextures[k]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform3i(m_uniforms.clusterDims, LightClusters::kTilesX, LightClusters::kTilesY, LightClusters::kSlices);
+    glUniform2f(m_uniforms.clusterTileScale, (float)LightClusters::kTilesX / snap.width, (float)LightClusters::kTilesY / snap.height);
+    glUniform2f(m_uniforms.clusterZ, lc.zScale, lc.zBias);
+}
+
+void C3DViewer::beginFrameArena() {
+    // Lo que se encole desde aqui se ejecuta antes del snapshot m_snapshotCounter + 1
+    unsigned long long frame = m_snapshotCounter + 1;
+    if (frame == m_frameArena.frame()) return;
+    if (m_renderThreadRunning) {
+        // El bloque es de hace kSlots frames; se pide un frame mas por si se encolo
+        // algo despues de que buildSnapshot avanzara el contador
+        unsigned long long needed = m_frameArena.slotFrame(frame) + 1;
+        std::unique_lock<std::mutex> lock(m_commandMutex);
+        if (m_retiredFrame < needed) {
+            PROFILE_SCOPE("Esperar arena de frame");
+            m_commandsDone.wait(lock, [&]() { return m_retiredFrame >= needed; });
+        }
+    }
+    m_frameArena.beginFrame(frame);
+}
+
+void C3DViewer::recordPresent(const RenderSnapshot& snap, double renderStart) {
+    double now = glfwGetTime();
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_presentStats.renderTimeMs = (float)((now - renderStart) * 1000.0);
+    // Las pausas del render bajo demanda no cuentan como ritmo de frames
+    double interval = now - m_lastPresentTime;
+    if (m_lastPresentTime > 0.0 && interval < 0.25) m_presentStats.addInterval((float)(interval * 1000.0));
+    m_lastPresentTime = now;
+    if (snap.inputTime > 0.0) m_presentStats.addLatency((float)((now - snap.inputTime) * 1000.0));
+    m_presentStats.presentedFrames++;
+}
+
+void C3DViewer::noteInput() {
+    // Se guarda la entrada mas antigua aun no mostrada
+    if (m_pendingInputTime == 0.0) m_pendingInputTime = glfwGetTime();
+}
+
+void C3DViewer::requestRedraw(int frames) {
+    // ImGui necesita un par de frames extra para asentar hover/animaciones
+    m_redrawFrames = std::max(m_redrawFrames, frames);
 }
 
 void C3DViewer::onKey(int key, int scancode, int action, int mods) {
@@ -101,17 +939,10 @@ void C3DViewer::onMouseButton(int button, int action, int mods) {
         glfwGetCursorPos(m_window, &x, &y);
         lastMouseX = x; lastMouseY = y;
         if (button == GLFW_MOUSE_BUTTON_LEFT) {
-            int picked = pickObject(x, y);
-            if (picked != -1) {
-                m_selectedSubMeshIndex = picked;
-                m_showBoundingBox = true;
-                isDragging = false;
-            }
-            else {
-                m_selectedSubMeshIndex = -1;
-                m_showBoundingBox = false;
-                isDragging = true;
-            }
+            // Se resuelve en el lado render con el snapshot de este frame
+            m_pickPending = true;
+            m_pickX = x; m_pickY = y;
+            isDragging = false;
         }
     }
     else if (action == GLFW_RELEASE) {
@@ -119,15 +950,34 @@ void C3DViewer::onMouseButton(int button, int action, int mods) {
     }
 }
 
+void C3DViewer::applyPickResult(int picked) {
+    // La escena pudo cambiar mientras el picking estaba en vuelo
+    if (picked >= 0 && picked < (int)m_subMeshes.size()) {
+        m_selectedSubMeshIndex = picked;
+        m_activeModel = m_subMeshes[picked].model;
+        m_showBoundingBox = true;
+        isDragging = false;
+    }
+    else {
+        m_selectedSubMeshIndex = -1;
+        m_showBoundingBox = false;
+        // Clic en el fondo: arrastrar rota el modelo activo mientras siga pulsado
+        isDragging = glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    }
+    requestRedraw();
+}
+
 void C3DViewer::onCursorPos(double xpos, double ypos) {
-    if (isDragging) {
+    if (isDragging && m_activeModel != -1) {
         float dx = (float)(xpos - lastMouseX);
         float dy = (float)(ypos - lastMouseY);
         float sensitivity = 0.005f;
         glm::quat rotY = glm::angleAxis(dx * sensitivity, glm::vec3(0, 1, 0));
         glm::quat rotX = glm::angleAxis(dy * sensitivity, glm::vec3(1, 0, 0));
-        m_globalRotation = rotY * rotX * m_globalRotation;
-        m_globalRotation = glm::normalize(m_globalRotation);
+        int node = m_models[m_activeModel].node;
+        SceneNode& n = m_scene.node(node);
+        n.rotation = glm::normalize(rotY * rotX * n.rotation);
+        m_scene.markDirty(node);
     }
     else if (glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
         float xoffset = (float)(xpos - lastMouseX);
@@ -137,270 +987,770 @@ void C3DViewer::onCursorPos(double xpos, double ypos) {
         m_cameraPitch += yoffset * sensitivity;
         if (m_cameraPitch > 89.0f) m_cameraPitch = 89.0f;
         if (m_cameraPitch < -89.0f) m_cameraPitch = -89.0f;
-        glm::vec3 front;
-        front.x = cos(glm::radians(m_cameraYaw)) * cos(glm::radians(m_cameraPitch));
-        front.y = sin(glm::radians(m_cameraPitch));
-        front.z = sin(glm::radians(m_cameraYaw)) * cos(glm::radians(m_cameraPitch));
-        m_cameraFront = glm::normalize(front);
+        m_cameraFront = frontFromAngles(m_cameraYaw, m_cameraPitch);
+        // El raton mueve la camara directamente, sin interpolar
+        m_prevCameraYaw = m_cameraYaw;
+        m_prevCameraPitch = m_cameraPitch;
+        m_viewFront = m_cameraFront;
     }
     lastMouseX = xpos;
     lastMouseY = ypos;
 }
 
-bool C3DViewer::loadOBJ(const std::string& filename) {
+bool C3DViewer::loadOBJ(const std::string& filename, bool append) {
+    PROFILE_FUNCTION();
     std::string modelsDir = "objetos3D/";
     std::string fullPath = modelsDir + filename;
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
+    // Asignaciones de este hilo y memoria durante la carga
+    AllocCounters allocsBefore = threadAllocCounters();
+    LoadArena& arena = LoadArena::instance();
+    arena.resetPeak();
+    // Lo leido del OBJ vive en la arena hasta que flattenOBJ lo copia
+    std::optional<ObjData> obj(std::in_place, &arena);
     std::string warn, err;
-    std::string baseDir = fullPath.substr(0, fullPath.find_last_of("/\\") + 1);
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, fullPath.c_str(), baseDir.c_str());
+    bool ret = parseOBJ(fullPath, *obj, warn, err);
     if (!warn.empty()) std::cout << "OBJ Warning: " << warn << std::endl;
     if (!err.empty()) std::cerr << "OBJ Error: " << err << std::endl;
-    if (!ret) return false;
-        if (materials.empty()) {
+    if (!ret) {
+        obj.reset();
+        arena.rewind();
+        return false;
+    }
+        if (obj->materials.empty()) {
             std::cout << "[AVISO] No se encontr MTL. Se usar gris por defecto." << std::endl;
         }
-    m_vertices.clear();
-    m_subMeshes.clear();
-    for (const auto& shape : shapes) {
-        SubMesh subMesh;
-        subMesh.name = shape.name;
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex;
-            //Lectura de Posicion, Normal, TexCoords, etc
-            vertex.Position = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            // Actualizar limites
-            subMesh.min = glm::min(subMesh.min, vertex.Position);
-            subMesh.max = glm::max(subMesh.max, vertex.Position);
-        }
-            if (!shape.mesh.material_ids.empty() && shape.mesh.material_ids[0] >= 0) {
-                int matId = shape.mesh.material_ids[0];
-                if (matId < materials.size()) {
-                    subMesh.diffuseColor = glm::vec3(
-                        materials[matId].diffuse[0],
-                        materials[matId].diffuse[1],
-                        materials[matId].diffuse[2]
-                    );
-                }
-            }
-            else {
-                // Gris default
-                subMesh.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f); 
-            }
-        // Aplanado de vrtices 
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex;
-            // Posicin
-            vertex.Position = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            // Normales
-            if (index.normal_index >= 0) {
-                vertex.Normal = {
-                    attrib.normals[3 * index.normal_index + 0],
-                    attrib.normals[3 * index.normal_index + 1],
-                    attrib.normals[3 * index.normal_index + 2]
-                };
-            }
-            else {
-                vertex.Normal = glm::vec3(0.0f);
-            }
-            if (index.texcoord_index >= 0) {
-                vertex.TexCoords = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    attrib.texcoords[2 * index.texcoord_index + 1]
-                };
-            }
-            else {
-                vertex.TexCoords = glm::vec2(0.0f);
-            }
-            m_vertices.push_back(vertex);
-            subMesh.indices.push_back(m_vertices.size() - 1);
-        }
-        subMesh.indexCount = subMesh.indices.size();
-        m_subMeshes.push_back(subMesh);
+    if (!append) clearScene();
+    Model model;
+    model.name = filename;
+    model.firstSubMesh = m_subMeshes.size();
+    model.firstVertex = m_vertices.size();
+    model.firstMaterial = m_materials.size();
+    int modelIndex = (int)m_models.size();
+    flattenOBJ(*obj, modelIndex, m_vertices, m_subMeshes, m_materials, m_materialRanges, &m_smoothingGroups);
+    // Los datos del OBJ ya estan copiados: la arena vuelve al inicio antes de subir a la GPU
+    obj.reset();
+    arena.rewind();
+    model.subMeshCount = m_subMeshes.size() - model.firstSubMesh;
+    model.vertexCount = m_vertices.size() - model.firstVertex;
+    model.materialCount = m_materials.size() - model.firstMaterial;
+    // map_Kd es relativo al MTL (junto al OBJ); la decodificacion sigue en segundo plano
+    std::filesystem::path objDir = std::filesystem::path(fullPath).parent_path();
+    for (unsigned int i = model.firstMaterial; i < m_materials.size(); i++) {
+        Material& mat = m_materials[i];
+        if (mat.diffuseMap.empty()) continue;
+        std::string texturePath = (objDir / mat.diffuseMap).lexically_normal().string();
+        mat.diffuseMap = texturePath;
+        mat.diffuseTexture = m_textures.request(texturePath);
+        if (mat.diffuseTexture < 0) std::cout << "[AVISO] No se encontro la textura " << texturePath << " (" << mat.name << "): se usa el color." << std::endl;
+    }
+    for (unsigned int i = model.firstMaterial; i < m_materials.size(); i++) {
+        Material& mat = m_materials[i];
+        if (mat.normalMap.empty()) continue;
+        std::string texturePath = (objDir / mat.normalMap).lexically_normal().string();
+        mat.normalMap = texturePath;
+        mat.normalTexture = m_textures.request(texturePath, TextureKind::Normal);
+        if (mat.normalTexture < 0) std::cout << "[AVISO] No se encontro el mapa de normales " << texturePath << " (" << mat.name << "): se usa la normal interpolada." << std::endl;
     }
-    calculateBoundingBox();
+    calculateBoundingBox(model);
+    // Nodos: Escena -> Modelo (TRS del usuario) -> Normalizacion -> Sub-mallados
+    // Los modelos agregados se colocan a la derecha de los anteriores
+    model.homePosition = glm::vec3(2.5f * modelIndex, 0.0f, -3.0f);
+    model.node = m_scene.addNode(SceneNodeType::Model, model.name, m_scene.root(), modelIndex);
+    m_scene.node(model.node).position = model.homePosition;
+    model.normalizeNode = m_scene.addNode(SceneNodeType::Group, "Normalizacion", model.node);
+    m_scene.node(model.normalizeNode).scale = glm::vec3(model.scaleFactor);
+    m_scene.node(model.normalizeNode).pivot = -model.center;
+    for (unsigned int i = model.firstSubMesh; i < m_subMeshes.size(); i++) {
+        m_subMeshes[i].node = m_scene.addNode(SceneNodeType::SubMesh, m_subMeshes[i].name, model.normalizeNode, i);
+    }
+    m_models.push_back(model);
+    m_activeModel = modelIndex;
+    buildDrawOrder();
     computeNormals();
+    computeTangents(model.firstSubMesh);
     setupMeshBuffers();
     updateNormalBuffers();
-    resetView();
+    if (!append) resetView();
+    requestRedraw();
+    AllocCounters allocsAfter = threadAllocCounters();
+    m_loadAllocations = allocsAfter.allocations - allocsBefore.allocations;
+    m_loadArenaAllocations = allocsAfter.arenaAllocations - allocsBefore.arenaAllocations;
+    m_loadArenaBytes = arena.peakUsed();
+    m_loadMemory = processMemoryUsage();
+    std::cout << "Memoria de carga: " << m_loadAllocations << " asignaciones en el heap, " << m_loadArenaAllocations
+        << " en la arena (" << m_loadArenaBytes / (1024 * 1024) << " MB), RSS " << m_loadMemory.rssBytes / (1024 * 1024)
+        << " MB (pico " << m_loadMemory.peakRssBytes / (1024 * 1024) << " MB)" << std::endl;
     return true;
 }
 
-void C3DViewer::calculateBoundingBox() {
-    if (m_vertices.empty()) return;
-    glm::vec3 minV(1e9), maxV(-1e9);
-    for (const auto& v : m_vertices) {
-        minV = glm::min(minV, v.Position);
-        maxV = glm::max(maxV, v.Position);
+void C3DViewer::startGenerator() {
+    if (m_generatorRunning) return;
+    if (m_generatorThread.joinable()) m_generatorThread.join();
+    m_generatorParams.triangles = (unsigned long long)std::max(m_generatorTrisK, 1) * 1000ull;
+    m_generatorFile = std::string("generado_") + shapeName(m_generatorParams.shape) + "_" + std::to_string(m_generatorParams.seed) + ".obj";
+    m_generatorRunning = true;
+    GeneratorParams params = m_generatorParams;
+    std::string path = "objetos3D/" + m_generatorFile;
+    m_generatorThread = std::thread([this, params, path]() {
+        PROFILE_THREAD_NAME("Generador");
+        std::string error;
+        GeneratorStats stats;
+        bool ok = generateOBJ(path, params, &stats, error);
+        m_generatorOk = ok;
+        m_generatorError = error;
+        m_generatorResult = stats;
+        m_generatorDone = true;
+    });
+}
+
+void C3DViewer::finishGenerator() {
+    m_generatorThread.join();
+    m_generatorDone = false;
+    m_generatorRunning = false;
+    if (!m_generatorOk) {
+        std::cerr << "Error al generar: " << m_generatorError << std::endl;
+        return;
     }
-    m_center = (minV + maxV) * 0.5f; 
-    glm::vec3 size = maxV - minV;
-    // Escala para cubo unitario
-    float maxDim = std::max({ size.x, size.y, size.z });
-    m_scaleFactor = (maxDim > 0) ? (2.0f / maxDim) : 1.0f;
-    std::cout << "Modelo Normalizado. Escala: " << m_scaleFactor << std::endl;
-    m_boundingBoxDiagonal = glm::length(maxV - minV);
-    // Si m_boundingBoxDiagonal es 0 (punto), evitar errores
-    if (m_boundingBoxDiagonal < 0.0001f) m_boundingBoxDiagonal = 1.0f;
+    m_generatorStats = m_generatorResult;
+    std::cout << "Generado " << m_generatorFile << ": " << m_generatorStats.triangles << " triangulos, "
+        << m_generatorStats.groups << " grupos en " << m_generatorStats.seconds << " s" << std::endl;
+    snprintf(m_objFileName, sizeof(m_objFileName), "%s", m_generatorFile.c_str());
+    if (!loadOBJ(m_generatorFile)) std::cerr << "Error al cargar: " << m_generatorFile << std::endl;
+}
+
+void C3DViewer::clearScene() {
+    PROFILE_FUNCTION();
+    m_vertices.clear();
+    m_smoothingGroups.clear();
+    m_subMeshes.clear();
+    m_models.clear();
+    m_materials.clear();
+    m_materialRanges.clear();
+    m_drawOrder.clear();
+    // Las texturas de los materiales: el render las borra en su proximo upload()
+    m_textures.clear();
+    m_scene.clear();
+    m_activeModel = -1;
+    m_selectedSubMeshIndex = -1;
+    m_obbSubMesh = -1;
+    requestRedraw();
+}
+
+void C3DViewer::buildDrawOrder() {
+    m_drawOrder.resize(m_materialRanges.size());
+    for (unsigned int i = 0; i < m_drawOrder.size(); i++) m_drawOrder[i] = i;
+    // Los rangos de un sub-mallado ya vienen por material: ordenar solo junta sub-mallados
+    std::stable_sort(m_drawOrder.begin(), m_drawOrder.end(), [this](unsigned int a, unsigned int b) {
+        return m_materialRanges[a].material < m_materialRanges[b].material;
+    });
+    std::cout << "Materiales: " << m_materials.size() << ", rangos de dibujo: " << m_materialRanges.size() << std::endl;
+}
+
+void C3DViewer::calculateBoundingBox(Model& model) {
+    LoadArena& arena = LoadArena::instance();
+    computeBounds(m_vertices, m_subMeshes, model, &arena);
+    arena.rewind();
+    std::cout << "Modelo Normalizado. Escala: " << model.scaleFactor << std::endl;
 }
 
 void C3DViewer::computeNormals() {
-    for (size_t i = 0; i < m_vertices.size(); i += 3) {
-        // Verificar que no nos salimos del vector 
-        if (i + 2 >= m_vertices.size()) break;
-        Vertex& v0 = m_vertices[i];
-        Vertex& v1 = m_vertices[i + 1];
-        Vertex& v2 = m_vertices[i + 2];
-        // Si la normal ya existe. Si es cero, calculamos.
-        if (glm::length(v0.Normal) < 0.01f) {
-            glm::vec3 edge1 = v1.Position - v0.Position;
-            glm::vec3 edge2 = v2.Position - v0.Position;
-            glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
-            v0.Normal = normal;
-            v1.Normal = normal;
-            v2.Normal = normal;
+    computeFlatNormals(m_vertices);
+}
+
+void C3DViewer::regenerateNormals() {
+    PROFILE_FUNCTION();
+    NormalStats total;
+    LoadArena& arena = LoadArena::instance();
+    for (const auto& m : m_models) {
+        // Cada modelo por separado: no se sueldan vertices de modelos distintos
+        NormalStats stats;
+        generateNormals(m_vertices, m.firstVertex, m.vertexCount, m_smoothingGroups.data() + m.firstVertex / 3, m_normalSettings, &stats, &arena);
+        arena.rewind();
+        total.triangles += stats.triangles;
+        total.weldedPositions += stats.weldedPositions;
+        total.milliseconds += stats.milliseconds;
+    }
+    m_normalStats = total;
+    std::cout << "Normales regeneradas: " << total.triangles << " triangulos en " << total.milliseconds << " ms" << std::endl;
+    // Las tangentes se proyectan sobre las normales: cambian con ellas
+    computeTangents(0);
+    setupMeshBuffers();
+    updateNormalBuffers();
+    requestRedraw();
+}
+
+void C3DViewer::computeTangents(unsigned int firstSubMesh) {
+    PROFILE_FUNCTION();
+    // Solo los sub-mallados con algun rango normal-mapeado; el resto queda sin tangente
+    std::vector<VertexSpan> spans;
+    for (unsigned int i = firstSubMesh; i < m_subMeshes.size(); i++) {
+        const SubMesh& sub = m_subMeshes[i];
+        bool mapped = false;
+        for (unsigned int r = sub.firstRange; r < sub.firstRange + sub.rangeCount && !mapped; r++) {
+            mapped = m_materials[m_materialRanges[r].material].normalTexture >= 0;
         }
+        if (mapped) spans.push_back(VertexSpan{ sub.firstVertex, sub.indexCount });
     }
+    m_tangentStats = TangentStats();
+    if (spans.empty()) return;
+    LoadArena& arena = LoadArena::instance();
+    generateTangents(m_vertices, spans, &m_tangentStats, &arena);
+    arena.rewind();
+    std::cout << "Tangentes: " << spans.size() << " sub-mallados, " << m_tangentStats.triangles << " triangulos ("
+        << m_tangentStats.weldedVertices << " vertices soldados, " << m_tangentStats.degenerate << " sin area UV) en "
+        << m_tangentStats.milliseconds << " ms" << std::endl;
 }
 
 void C3DViewer::setupMeshBuffers() {
-    if (m_vao) glDeleteVertexArrays(1, &m_vao);
-    if (m_vbo) glDeleteBuffers(1, &m_vbo);
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_STATIC_DRAW);
-    // Location 0: Posicin
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
-    glEnableVertexAttribArray(0);
-    // Location 1: Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    glEnableVertexAttribArray(1);
-    glBindVertexArray(0);
+    PROFILE_FUNCTION();
+    auto upload = [this](const Vertex* data, size_t count, const int* drawIds) {
+        if (m_vao) glDeleteVertexArrays(1, &m_vao);
+        if (m_vbo) glDeleteBuffers(1, &m_vbo);
+        if (m_drawIdVbo) glDeleteBuffers(1, &m_drawIdVbo);
+        glGenVertexArrays(1, &m_vao);
+        glGenBuffers(1, &m_vbo);
+        glGenBuffers(1, &m_drawIdVbo);
+        glBindVertexArray(m_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(Vertex), data, GL_STATIC_DRAW);
+        // Location 0: Posicin
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
+        glEnableVertexAttribArray(0);
+        // Location 1: Normal
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(1);
+        // Location 2: Coordenadas de textura
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(2);
+        // Location 3: rango de material (entero, en un buffer aparte)
+        glBindBuffer(GL_ARRAY_BUFFER, m_drawIdVbo);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(int), drawIds, GL_STATIC_DRAW);
+        glVertexAttribIPointer(3, 1, GL_INT, sizeof(int), (void*)0);
+        glEnableVertexAttribArray(3);
+        // Location 4: Tangente (2_10_10_10 normalizado, vuelve al VBO intercalado)
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glVertexAttribPointer(4, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glBindVertexArray(0);
+    };
+    // m_vertices guarda un arreglo por componente: se intercala solo para el VBO.
+    // El render sube esta copia, asi el hilo principal puede seguir modificando m_vertices
+    auto interleaved = std::make_shared<std::vector<Vertex>>(m_vertices.size());
+    parallelFor(m_vertices.size(), 65536, [&](size_t begin, size_t end) {
+        m_vertices.interleave(begin, end - begin, interleaved->data() + begin);
+    });
+    // Los rangos de material cubren todos los vertices de su sub-mallado
+    auto drawIds = std::make_shared<std::vector<int>>(m_vertices.size(), 0);
+    for (size_t r = 0; r < m_materialRanges.size(); r++) {
+        const MaterialRange& range = m_materialRanges[r];
+        std::fill_n(drawIds->begin() + range.firstVertex, range.vertexCount, (int)r);
+    }
+    if (!m_renderThreadRunning) {
+        upload(interleaved->data(), interleaved->size(), drawIds->data());
+    }
+    else {
+        runOnRenderThread([upload, interleaved, drawIds]() { upload(interleaved->data(), interleaved->size(), drawIds->data()); });
+    }
+    m_geometryVersion++;
 }
 
-int C3DViewer::pickObject(double mouseX, double mouseY) {
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+int C3DViewer::pickObject(const RenderSnapshot& snap, double mouseX, double mouseY) {
+    PROFILE_FUNCTION();
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glUseProgram(m_shaderProgram);
-    glm::mat4 view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp);
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
-    glm::mat4 globalModel = glm::mat4(1.0f);
-    globalModel = glm::translate(globalModel, m_globalPos);
-    globalModel = globalModel * glm::toMat4(m_globalRotation);
-    globalModel = glm::scale(globalModel, m_globalScale * m_scaleFactor);
-    globalModel = glm::translate(globalModel, -m_center);
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "isPicking"), 1);
-    unsigned int offset = 0;
-    for (int i = 0; i < m_subMeshes.size(); i++) {
-        SubMesh& sub = m_subMeshes[i];
-        if (!sub.visible) { offset += sub.indices.size(); continue; }
-        glm::mat4 localModel = glm::translate(globalModel, sub.localPosition);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(localModel));
-        // Color ID
-        float r = (float)i / 255.0f;
-        glUniform3f(glGetUniformLocation(m_shaderProgram, "uColor"), r, 0.0f, 0.0f);
-        glBindVertexArray(m_vao);
-        glDrawArrays(GL_TRIANGLES, offset, sub.indices.size());
-        offset += sub.indices.size();
+    glUniformMatrix4fv(m_uniforms.view, 1, GL_FALSE, glm::value_ptr(snap.view));
+    glUniformMatrix4fv(m_uniforms.projection, 1, GL_FALSE, glm::value_ptr(snap.projection));
+    glUniform1i(m_uniforms.isPicking, 1);
+    glBindVertexArray(m_vao);
+    for (const DrawItem& item : snap.items) {
+        setModelUniforms(item);
+        // Color ID (24 bits, 0 = fondo)
+        unsigned int id = (unsigned int)item.subMesh + 1;
+        glUniform3f(m_uniforms.uColor,
+            (id & 0xFF) / 255.0f, ((id >> 8) & 0xFF) / 255.0f, ((id >> 16) & 0xFF) / 255.0f);
+        glDrawArrays(GL_TRIANGLES, item.firstVertex, item.vertexCount);
     }
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "isPicking"), 0);
+    glBindVertexArray(0);
+    glUniform1i(m_uniforms.isPicking, 0);
     unsigned char data[4];
-    glReadPixels((int)mouseX, height - (int)mouseY, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    int id = (int)data[0];
-    if (id == 255 || id >= m_subMeshes.size()) return -1;
-    return id;
+    glReadPixels((int)mouseX, snap.height - (int)mouseY, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    int id = (int)data[0] | ((int)data[1] << 8) | ((int)data[2] << 16);
+    return id - 1;
+}
+
+void C3DViewer::setModelUniforms(const DrawItem& item) {
+    glUniformMatrix4fv(m_uniforms.model, 1, GL_FALSE, glm::value_ptr(item.model));
+    glUniformMatrix3fv(m_uniforms.normalMatrix, 1, GL_FALSE, glm::value_ptr(item.normalMatrix));
+}
+
+// Unidad y destino de cada lugar de FillBatch: difusa, array difuso, normales, array de normales
+static const GLenum kBatchUnits[4] = { GL_TEXTURE0, GL_TEXTURE1, GL_TEXTURE3, GL_TEXTURE4 };
+static const GLenum kBatchTargets[4] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY };
+
+// Lugares de FillBatch que ocupa un binding: el 2D (sola o atlas) o el array
+static void batchSlots(const TextureBinding& b, GLuint& texture, GLuint& array) {
+    texture = b.mode == TextureBinding::Single || b.mode == TextureBinding::Atlas ? b.texture : 0;
+    array = b.mode == TextureBinding::Array ? b.texture : 0;
+}
+
+static void unbindBatchUnits() {
+    for (int k = 3; k >= 0; k--) {
+        glActiveTexture(kBatchUnits[k]);
+        glBindTexture(kBatchTargets[k], 0);
+    }
+}
+
+void C3DViewer::drawFillRanges(const RenderSnapshot& snap) {
+    // Rangos por material: el color se sube al cambiar de material y las matrices al cambiar de item
+    int lastMaterial = -1, lastItem = -1, calls = 0;
+    for (const DrawRange& range : snap.ranges) {
+        if (range.item != lastItem) {
+            setModelUniforms(snap.items[range.item]);
+            lastItem = range.item;
+        }
+        if (range.material != lastMaterial) {
+            glUniform3fv(m_uniforms.uColor, 1, glm::value_ptr(range.color));
+            // Sin textura (o aun sin ningun nivel subido) queda solo el color
+            TextureBinding b = m_textures.binding(range.texture);
+            glUniform1i(m_uniforms.textureMode, b.mode);
+            glUniform1f(m_uniforms.textureLayer, (float)b.layer);
+            glUniform4f(m_uniforms.uvTransform, b.uvScale[0], b.uvScale[1], b.uvOffset[0], b.uvOffset[1]);
+            TextureBinding nb = m_textures.binding(range.normalTexture);
+            glUniform1i(m_uniforms.normalMode, nb.mode);
+            glUniform1f(m_uniforms.normalLayer, (float)nb.layer);
+            glUniform4f(m_uniforms.normalUvTransform, nb.uvScale[0], nb.uvScale[1], nb.uvOffset[0], nb.uvOffset[1]);
+            GLuint slots[4];
+            batchSlots(b, slots[0], slots[1]);
+            batchSlots(nb, slots[2], slots[3]);
+            for (int k = 0; k < 4; k++) {
+                if (!slots[k]) continue;
+                glActiveTexture(kBatchUnits[k]);
+                glBindTexture(kBatchTargets[k], slots[k]);
+            }
+            glActiveTexture(GL_TEXTURE0);
+            lastMaterial = range.material;
+        }
+        glDrawArrays(GL_TRIANGLES, range.firstVertex, range.vertexCount);
+        calls++;
+    }
+    glUniform1i(m_uniforms.textureMode, 0);
+    glUniform1i(m_uniforms.normalMode, 0);
+    unbindBatchUnits();
+    m_fillDrawCalls = calls;
 }
 
-void C3DViewer::render() {
+bool C3DViewer::drawFillBatched(const RenderSnapshot& snap) {
+    if (!m_drawDataTex) {
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxDrawDataTexels);
+        glGenBuffers(1, &m_drawDataBuffer);
+        glGenTextures(1, &m_drawDataTex);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_drawDataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, m_drawDataTex);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_drawDataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+    int rows = 0;
+    for (const DrawRange& range : snap.ranges) rows = std::max(rows, range.range + 1);
+    const size_t texels = (size_t)rows * kDrawDataTexels;
+    // Sin lugar en el texture buffer se dibuja rango por rango
+    if (texels > (size_t)m_maxDrawDataTexels) return false;
+    // Los vectores solo crecen: sin reservas en estado estable
+    if (m_drawData.size() < texels) m_drawData.resize(texels);
+    if (m_rangeBatch.size() < snap.ranges.size()) m_rangeBatch.resize(snap.ranges.size());
+    m_fillBatches.clear();
+    for (size_t i = 0; i < snap.ranges.size(); i++) {
+        const DrawRange& range = snap.ranges[i];
+        const DrawItem& item = snap.items[range.item];
+        glm::vec4* row = &m_drawData[(size_t)range.range * kDrawDataTexels];
+        for (int c = 0; c < 4; c++) row[c] = item.model[c];
+        for (int c = 0; c < 3; c++) row[4 + c] = glm::vec4(item.normalMatrix[c], 0.0f);
+        TextureBinding b = m_textures.binding(range.texture);
+        TextureBinding nb = m_textures.binding(range.normalTexture);
+        row[7] = glm::vec4(range.color, (float)b.mode);
+        row[8] = glm::vec4(b.uvScale[0], b.uvScale[1], b.uvOffset[0], b.uvOffset[1]);
+        row[9] = glm::vec4((float)b.layer, (float)nb.mode, (float)nb.layer, 0.0f);
+        row[10] = glm::vec4(nb.uvScale[0], nb.uvScale[1], nb.uvOffset[0], nb.uvOffset[1]);
+        // Un lote admite una textura por unidad; un lugar libre acepta cualquiera
+        GLuint slots[4];
+        batchSlots(b, slots[0], slots[1]);
+        batchSlots(nb, slots[2], slots[3]);
+        int batch = -1;
+        for (int k = 0; k < (int)m_fillBatches.size() && batch < 0; k++) {
+            const FillBatch& fb = m_fillBatches[k];
+            bool fits = true;
+            for (int s = 0; s < 4 && fits; s++) fits = !slots[s] || !fb.textures[s] || fb.textures[s] == slots[s];
+            if (fits) batch = k;
+        }
+        if (batch < 0) {
+            batch = (int)m_fillBatches.size();
+            m_fillBatches.push_back(FillBatch());
+        }
+        for (int s = 0; s < 4; s++) {
+            if (slots[s]) m_fillBatches[batch].textures[s] = slots[s];
+        }
+        m_rangeBatch[i] = batch;
+    }
+    // Buffer huerfano cada frame: no se espera a que la GPU termine con el anterior
+    glBindBuffer(GL_TEXTURE_BUFFER, m_drawDataBuffer);
+    m_drawDataCapacity = std::max(m_drawDataCapacity, texels);
+    glBufferData(GL_TEXTURE_BUFFER, m_drawDataCapacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, texels * sizeof(glm::vec4), m_drawData.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_drawDataTex);
+    glUniform1i(m_uniforms.batched, 1);
+    for (int k = 0; k < (int)m_fillBatches.size(); k++) {
+        m_batchFirst.clear();
+        m_batchCount.clear();
+        for (size_t i = 0; i < snap.ranges.size(); i++) {
+            if (m_rangeBatch[i] != k) continue;
+            m_batchFirst.push_back((GLint)snap.ranges[i].firstVertex);
+            m_batchCount.push_back((GLsizei)snap.ranges[i].vertexCount);
+        }
+        for (int s = 0; s < 4; s++) {
+            glActiveTexture(kBatchUnits[s]);
+            glBindTexture(kBatchTargets[s], m_fillBatches[k].textures[s]);
+        }
+        glMultiDrawArrays(GL_TRIANGLES, m_batchFirst.data(), m_batchCount.data(), (GLsizei)m_batchFirst.size());
+    }
+    glUniform1i(m_uniforms.batched, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    unbindBatchUnits();
+    m_fillDrawCalls = (int)m_fillBatches.size();
+    return true;
+}
+
+void C3DViewer::render(const RenderSnapshot& snap) {
+    PROFILE_FUNCTION();
+    AllocCounters allocsBefore = threadAllocCounters();
+    bool warm = ++m_renderCalls > kAllocWarmupFrames;
+    // Pasado el calentamiento render() no deberia tocar el heap
+    NoAllocScope noAlloc("render()", snap.options.checkAllocations && warm);
+    if (snap.options.gpuProfiling) m_gpuProfiler.beginFrame(snap.frameId);
+    renderShadows(snap);
+    glViewport(0, 0, snap.width, snap.height);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_outputFbo);
+    if (snap.pickRequested) {
+        m_gpuProfiler.begin(GpuPass::Picking);
+        int picked = pickObject(snap, snap.pickX, snap.pickY);
+        m_gpuProfiler.end(GpuPass::Picking);
+        {
+            std::lock_guard<std::mutex> lock(m_pickMutex);
+            m_pickResult = picked;
+            m_pickResultReady = true;
+        }
+        // Despierta al hilo principal si esta esperando eventos
+        if (m_renderThreadRunning) glfwPostEmptyEvent();
+    }
+    bool useCache = snap.options.useSceneCache && !m_sceneTargetFailed;
+    bool reused = false;
+    if (!useCache) {
+        if (m_sceneFbo) destroySceneTarget();
+        renderScene(snap, m_outputFbo);
+    }
+    else if (ensureSceneTarget(snap.width, snap.height)) {
+        reused = m_sceneCacheValid && snap.sceneKey == m_sceneCacheKey;
+        if (!reused) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+            renderScene(snap, m_sceneFbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, m_outputFbo);
+            m_sceneCacheKey = snap.sceneKey;
+            m_sceneCacheValid = true;
+        }
+        // Componer: copiar la escena cacheada y dibujar la UI encima
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_sceneFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_outputFbo);
+        glBlitFramebuffer(0, 0, m_sceneFboWidth, m_sceneFboHeight, 0, 0, snap.width, snap.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_outputFbo);
+    }
+    else {
+        renderScene(snap, m_outputFbo);
+    }
+    // Copia propia de las listas de ImGui (el hilo principal ya esta en otro frame)
+    ImDrawData* ui = const_cast<RenderSnapshot&>(snap).ui.get();
+    if (ui) {
+        m_gpuProfiler.begin(GpuPass::Interface);
+        ImGui_ImplOpenGL3_RenderDrawData(ui);
+        m_gpuProfiler.end(GpuPass::Interface);
+    }
+    m_gpuProfiler.endFrame();
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_presentStats.renderAllocs.add(allocsBefore, threadAllocCounters(), warm);
+    if (useCache) {
+        m_presentStats.sceneReused = reused;
+        if (reused) m_presentStats.sceneHits++; else m_presentStats.sceneMisses++;
+    }
+}
+
+void C3DViewer::renderScene(const RenderSnapshot& snap, GLuint target) {
+    PROFILE_FUNCTION();
+    const RenderOptions& o = snap.options;
+    // Con SSAO el relleno va al FBO de la pasada, que despues compone en target
+    const bool ssao = o.ssao.enabled && o.showTriangles && m_ssaoReady && m_ssaoPass.beginScene(snap.width, snap.height);
     // Configuracin de Estados
-    glClearColor(m_bgColor.r, m_bgColor.g, m_bgColor.b, 1.0f);
+    glClearColor(o.bgColor.r, o.bgColor.g, o.bgColor.b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    if (m_enableZBuffer) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
-    if (m_enableCulling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
-    if (m_enableAntiAliasing) glEnable(GL_LINE_SMOOTH); else glDisable(GL_LINE_SMOOTH);
+    if (o.enableZBuffer) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    if (o.enableCulling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    if (o.enableAntiAliasing) glEnable(GL_LINE_SMOOTH); else glDisable(GL_LINE_SMOOTH);
     glUseProgram(m_shaderProgram);
-    // Matrices
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
-    glm::mat4 view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp);
-    // Matriz Global del Objeto
-    glm::mat4 globalModel = glm::mat4(1.0f);
-    globalModel = glm::translate(globalModel, m_globalPos);
-    globalModel = globalModel * glm::toMat4(m_globalRotation);
-    globalModel = glm::scale(globalModel, m_globalScale * m_scaleFactor);
-    globalModel = glm::translate(globalModel, -m_center);
+    const glm::mat4& view = snap.view;
+    const glm::mat4& projection = snap.projection;
     // Uniforms bsicos
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "isPicking"), 0);
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 0);
-    //glBindVertexArray(m_vao);
-    unsigned int offset = 0;
-    // SubMesh
-    for (int i = 0; i < m_subMeshes.size(); i++) {
+    glUniformMatrix4fv(m_uniforms.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uniforms.projection, 1, GL_FALSE, glm::value_ptr(projection));
+    bindLights(snap);
+    bindShadows(snap);
+    glUniform1i(m_uniforms.isPicking, 0);
+    glUniform1i(m_uniforms.useFlatColor, 0);
+    glUniform1i(m_uniforms.ambientInAlpha, ssao ? 1 : 0);
+    glBindVertexArray(m_vao);
+    // Una pasada por tipo de primitiva, cada una medida por separado
+    if (o.showTriangles) {
+        m_gpuProfiler.begin(GpuPass::Fill);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        if (!o.batchDraws || !drawFillBatched(snap)) drawFillRanges(snap);
+        m_gpuProfiler.end(GpuPass::Fill);
+    }
+    if (ssao) {
+        // Las lineas, puntos y cajas se dibujan despues: la oclusion no las oscurece
+        m_gpuProfiler.begin(GpuPass::Ssao);
+        m_ssaoPass.apply(target, projection, o.ssao);
+        m_gpuProfiler.end(GpuPass::Ssao);
+        if (o.enableZBuffer) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+        if (o.enableCulling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+        glUseProgram(m_shaderProgram);
         glBindVertexArray(m_vao);
-        SubMesh& sub = m_subMeshes[i];
-        if (!sub.visible) { offset += sub.indices.size(); continue; }
-        glm::mat4 localModel = globalModel;
-        localModel = glm::translate(localModel, sub.localPosition);
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(localModel));
-        // Color
-        glm::vec3 color = sub.diffuseColor;
-        // Resaltar seleccin 
-        //if (i == m_selectedSubMeshIndex && !m_showWireframe) color = glm::vec3(1.0f, 0.2f, 0.2f);
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uColor"), 1, glm::value_ptr(color));
-        // Dibujar Relleno
-        if (m_showTriangles) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glDrawArrays(GL_TRIANGLES, offset, sub.indices.size());
+    }
+    if (o.showWireframe) {
+        m_gpuProfiler.begin(GpuPass::Wireframe);
+        glUniform1i(m_uniforms.useFlatColor, 1);
+        glUniform3fv(m_uniforms.uColor, 1, glm::value_ptr(o.wireframeColor));
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glEnable(GL_POLYGON_OFFSET_LINE);
+        glPolygonOffset(-1.0, -1.0); 
+        for (const DrawItem& item : snap.items) {
+            setModelUniforms(item);
+            glDrawArrays(GL_TRIANGLES, item.firstVertex, item.vertexCount);
         }
-        if (m_showWireframe) {
-            glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 1);
-            glUniform3fv(glGetUniformLocation(m_shaderProgram, "uColor"), 1, glm::value_ptr(m_wireframeColor));
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glEnable(GL_POLYGON_OFFSET_LINE);
-            glPolygonOffset(-1.0, -1.0); 
-                glDrawArrays(GL_TRIANGLES, offset, sub.indices.size());
-            glDisable(GL_POLYGON_OFFSET_LINE);
-            glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 0);
+        glDisable(GL_POLYGON_OFFSET_LINE);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glUniform1i(m_uniforms.useFlatColor, 0);
+        m_gpuProfiler.end(GpuPass::Wireframe);
+    }
+    if (o.showVertices) {
+        m_gpuProfiler.begin(GpuPass::Vertices);
+        glUniform1i(m_uniforms.useFlatColor, 1);
+        glUniform3fv(m_uniforms.uColor, 1, glm::value_ptr(o.vertexColor));
+        glPointSize(o.pointSize);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        glEnable(GL_POLYGON_OFFSET_POINT);
+        glPolygonOffset(-1.0, -1.0);
+        for (const DrawItem& item : snap.items) {
+            setModelUniforms(item);
+            glDrawArrays(GL_POINTS, item.firstVertex, item.vertexCount);
         }
-        if (m_showVertices) {
-            glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 1);
-            glUniform3fv(glGetUniformLocation(m_shaderProgram, "uColor"), 1, glm::value_ptr(m_vertexColor));
-            glPointSize(m_pointSize);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-            glEnable(GL_POLYGON_OFFSET_POINT);
-            glPolygonOffset(-1.0, -1.0);
-            glDrawArrays(GL_POINTS, offset, sub.indices.size());
-            glDisable(GL_POLYGON_OFFSET_POINT);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 0);
+        glDisable(GL_POLYGON_OFFSET_POINT);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glUniform1i(m_uniforms.useFlatColor, 0);
+        m_gpuProfiler.end(GpuPass::Vertices);
+    }
+    if (o.showNormals) {
+        m_gpuProfiler.begin(GpuPass::Normals);
+        for (const DrawItem& item : snap.items) {
+            drawNormals(item, item.model, view, projection, o.normalsColor);
         }
-        if (m_showNormals) {
-            drawNormals(localModel, view, projection);
+        m_gpuProfiler.end(GpuPass::Normals);
+    }
+    if (snap.selectedItem >= 0 && o.showBoundingBox) {
+        m_gpuProfiler.begin(GpuPass::BoundingBox);
+        const DrawItem& item = snap.items[snap.selectedItem];
+        drawBoundingBox(snap.selectedBox, item.model, view, projection, o.boundingBoxColor);
+        m_gpuProfiler.end(GpuPass::BoundingBox);
+    }
+    glBindVertexArray(0);
+}
+
+bool C3DViewer::ensureSceneTarget(int w, int h) {
+    if (m_sceneFbo && w == m_sceneFboWidth && h == m_sceneFboHeight) return true;
+    destroySceneTarget();
+    m_sceneFboWidth = std::max(w, 1);
+    m_sceneFboHeight = std::max(h, 1);
+    glGenFramebuffers(1, &m_sceneFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+    glGenTextures(1, &m_sceneColorTex);
+    glBindTexture(GL_TEXTURE_2D, m_sceneColorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_sceneFboWidth, m_sceneFboHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_sceneColorTex, 0);
+    glGenRenderbuffers(1, &m_sceneDepthRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_sceneDepthRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_sceneFboWidth, m_sceneFboHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_sceneDepthRbo);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_sceneCacheValid = false;
+    if (!complete) {
+        fprintf(stderr, "ERROR::FRAMEBUFFER:: Capa de escena incompleta, se desactiva la cache\n");
+        destroySceneTarget();
+        m_sceneTargetFailed = true;
+    }
+    return complete;
+}
+
+void C3DViewer::destroySceneTarget() {
+    if (m_sceneColorTex) glDeleteTextures(1, &m_sceneColorTex);
+    if (m_sceneDepthRbo) glDeleteRenderbuffers(1, &m_sceneDepthRbo);
+    if (m_sceneFbo) glDeleteFramebuffers(1, &m_sceneFbo);
+    m_sceneFbo = m_sceneColorTex = m_sceneDepthRbo = 0;
+    m_sceneCacheValid = false;
+}
+
+// FNV-1a sobre todo lo que afecta a la imagen 3D
+static unsigned long long hashBytes(unsigned long long h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) { h ^= p[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+unsigned long long C3DViewer::computeSceneKey() const {
+    unsigned long long h = 14695981039346656037ULL;
+    unsigned long long sceneVersion = m_scene.version();
+    h = hashBytes(h, &sceneVersion, sizeof(sceneVersion));
+    h = hashBytes(h, &m_geometryVersion, sizeof(m_geometryVersion));
+    int w = std::max(width, 1), hgt = std::max(height, 1);
+    h = hashBytes(h, &w, sizeof(w));
+    h = hashBytes(h, &hgt, sizeof(hgt));
+    h = hashBytes(h, &m_viewPos, sizeof(m_viewPos));
+    h = hashBytes(h, &m_viewFront, sizeof(m_viewFront));
+    h = hashBytes(h, &m_cameraUp, sizeof(m_cameraUp));
+    bool flags[] = { m_showWireframe, m_showNormals, m_showBoundingBox, m_enableZBuffer, m_enableCulling,
+        m_enableAntiAliasing, m_showTriangles, m_showVertices, m_orientedBoundingBox, m_useTextures, m_useNormalMaps };
+    h = hashBytes(h, flags, sizeof(flags));
+    h = hashBytes(h, &m_bgColor, sizeof(m_bgColor));
+    h = hashBytes(h, &m_wireframeColor, sizeof(m_wireframeColor));
+    h = hashBytes(h, &m_normalsColor, sizeof(m_normalsColor));
+    h = hashBytes(h, &m_vertexColor, sizeof(m_vertexColor));
+    h = hashBytes(h, &m_boundingBoxColor, sizeof(m_boundingBoxColor));
+    h = hashBytes(h, &m_pointSize, sizeof(m_pointSize));
+    h = hashBytes(h, &m_lightsVersion, sizeof(m_lightsVersion));
+    h = hashBytes(h, &m_shadowKey, sizeof(m_shadowKey));
+    h = hashBytes(h, &m_pcfRadius, sizeof(m_pcfRadius));
+    h = hashBytes(h, &m_spotColor, sizeof(m_spotColor));
+    h = hashBytes(h, &m_spotIntensity, sizeof(m_spotIntensity));
+    float ssao[] = { m_ssao ? 1.0f : 0.0f, (float)m_ssaoPreset, m_ssaoRadius, m_ssaoStrength };
+    h = hashBytes(h, ssao, sizeof(ssao));
+    h = hashBytes(h, &m_selectedSubMeshIndex, sizeof(m_selectedSubMeshIndex));
+    for (const auto& mat : m_materials) h = hashBytes(h, &mat.diffuseColor, sizeof(mat.diffuseColor));
+    for (const auto& sub : m_subMeshes) h = hashBytes(h, &sub.visible, sizeof(sub.visible));
+    return h;
+}
+
+void C3DViewer::updateShadows(RenderSnapshot& snap) {
+    PROFILE_FUNCTION();
+    // Cajas de mundo de los items y de la escena visible
+    m_itemBoxMin.resize(snap.items.size());
+    m_itemBoxMax.resize(snap.items.size());
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < snap.items.size(); i++) {
+        const DrawItem& item = snap.items[i];
+        const SubMesh& sub = m_subMeshes[item.subMesh];
+        transformBox(item.model, sub.min, sub.max, m_itemBoxMin[i], m_itemBoxMax[i]);
+        lo = glm::min(lo, m_itemBoxMin[i]);
+        hi = glm::max(hi, m_itemBoxMax[i]);
+    }
+    const bool empty = snap.items.empty();
+    SpotLight& spot = snap.spot;
+    spot.enabled = m_spotEnabled && !empty;
+    if (spot.enabled) {
+        glm::vec3 center = (lo + hi) * 0.5f;
+        float yaw = glm::radians(m_spotYaw), pitch = glm::radians(m_spotPitch);
+        glm::vec3 dir(std::cos(pitch) * std::cos(yaw), std::sin(pitch), std::cos(pitch) * std::sin(yaw));
+        spot.position = center + dir * std::max(glm::length(hi - lo) * m_spotDistance, 1e-3f);
+        spot.direction = -dir;
+        spot.cosOuter = std::cos(glm::radians(m_spotAngle));
+        spot.cosInner = std::cos(glm::radians(m_spotAngle * 0.8f));
+        spot.color = m_spotColor * m_spotIntensity;
+    }
+    ShadowView& sun = snap.shadows[ShadowMaps::Directional];
+    ShadowView& spotView = snap.shadows[ShadowMaps::Spot];
+    sun.enabled = m_shadows && !empty;
+    spotView.enabled = m_shadows && spot.enabled;
+    if (sun.enabled) sun.viewProjection = directionalShadowMatrix(kSunDirection, lo, hi);
+    if (spotView.enabled) spotView.viewProjection = spotShadowMatrix(spot, lo, hi);
+    // Solo proyecta sombra lo que toca el frustum de la luz
+    for (int k = 0; k < ShadowMaps::Count; k++) {
+        ShadowView& view = snap.shadows[k];
+        view.size = m_shadowMapSize;
+        view.items.clear();
+        if (view.enabled) {
+            for (int i = 0; i < (int)snap.items.size(); i++) {
+                if (boxInFrustum(view.viewProjection, m_itemBoxMin[i], m_itemBoxMax[i])) view.items.push_back(i);
+            }
         }
-        if (i == m_selectedSubMeshIndex && m_showBoundingBox) {
-            drawBoundingBox(sub.min, sub.max, localModel, view, projection, m_boundingBoxColor);
+        m_shadowCasters[k] = (int)view.items.size();
+    }
+    // La camara no entra: moverla reutiliza los mapas
+    unsigned long long h = 14695981039346656037ULL;
+    unsigned long long sceneVersion = m_scene.version();
+    h = hashBytes(h, &sceneVersion, sizeof(sceneVersion));
+    h = hashBytes(h, &m_geometryVersion, sizeof(m_geometryVersion));
+    for (const ShadowView& view : snap.shadows) {
+        h = hashBytes(h, &view.enabled, sizeof(view.enabled));
+        h = hashBytes(h, &view.size, sizeof(view.size));
+        h = hashBytes(h, &view.viewProjection, sizeof(view.viewProjection));
+        if (!view.items.empty()) h = hashBytes(h, view.items.data(), view.items.size() * sizeof(int));
+    }
+    for (const DrawItem& item : snap.items) h = hashBytes(h, &item.subMesh, sizeof(item.subMesh));
+    m_shadowKey = h;
+    snap.shadowKey = h;
+}
+
+void C3DViewer::renderShadows(const RenderSnapshot& snap) {
+    bool any = false;
+    for (const ShadowView& view : snap.shadows) any = any || view.enabled;
+    if (!any || !m_shadowMapsReady || (m_shadowCacheValid && snap.shadowKey == m_shadowCacheKey)) return;
+    PROFILE_FUNCTION();
+    m_gpuProfiler.begin(GpuPass::Shadows);
+    for (int k = 0; k < ShadowMaps::Count; k++) {
+        if (snap.shadows[k].enabled) m_shadowMaps.render(k, snap.shadows[k], snap.items, m_vao);
+    }
+    m_gpuProfiler.end(GpuPass::Shadows);
+    m_shadowCacheKey = snap.shadowKey;
+    m_shadowCacheValid = true;
+    m_shadowUpdates++;
+}
+
+void C3DViewer::bindShadows(const RenderSnapshot& snap) {
+    int mask = 0;
+    if (m_shadowMapsReady && m_shadowCacheValid && snap.shadowKey == m_shadowCacheKey) {
+        for (int k = 0; k < ShadowMaps::Count; k++) {
+            if (!snap.shadows[k].enabled) continue;
+            mask |= 1 << k;
+            glActiveTexture(GL_TEXTURE8 + k);
+            glBindTexture(GL_TEXTURE_2D, m_shadowMaps.texture(k));
         }
-        offset += sub.indices.size();
+        glActiveTexture(GL_TEXTURE0);
     }
-    glBindVertexArray(0);
-    drawInterface();
+    glUniform1i(m_uniforms.shadowMask, mask);
+    glUniform1i(m_uniforms.pcfRadius, snap.options.pcfRadius);
+    glUniformMatrix4fv(m_uniforms.sunShadowMatrix, 1, GL_FALSE, glm::value_ptr(snap.shadows[ShadowMaps::Directional].viewProjection));
+    glUniformMatrix4fv(m_uniforms.spotShadowMatrix, 1, GL_FALSE, glm::value_ptr(snap.shadows[ShadowMaps::Spot].viewProjection));
+    const SpotLight& spot = snap.spot;
+    glUniform1i(m_uniforms.spotEnabled, spot.enabled ? 1 : 0);
+    if (!spot.enabled) return;
+    glUniform3fv(m_uniforms.spotPosition, 1, glm::value_ptr(spot.position));
+    glUniform3fv(m_uniforms.spotDirection, 1, glm::value_ptr(spot.direction));
+    glUniform2f(m_uniforms.spotCone, spot.cosOuter, spot.cosInner);
+    glUniform3fv(m_uniforms.spotColor, 1, glm::value_ptr(spot.color));
 }
 void C3DViewer::drawInterface() {
+    PROFILE_FUNCTION();
     // Inicio de Frame ImGui
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -408,6 +1758,7 @@ void C3DViewer::drawInterface() {
     // Configuracin de la Ventana Principal
     ImGui::SetNextWindowSize(ImVec2(350, 500), ImGuiCond_FirstUseEver);
     ImGui::Begin("Panel de Control - Proyecto 2 UCV");
+    if (m_generatorDone) finishGenerator();
     if (ImGui::CollapsingHeader("Cargar Modelo", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::InputText("Archivo (.obj)", m_objFileName, sizeof(m_objFileName));
         // Botn de Cargar
@@ -419,30 +1770,192 @@ void C3DViewer::drawInterface() {
                 std::cerr << "Error al cargar: " << m_objFileName << std::endl;
             }
         }
+        ImGui::SameLine();
+        // Agrega el modelo sin descartar los ya cargados
+        if (ImGui::Button("AGREGAR A ESCENA")) {
+            if (loadOBJ(m_objFileName, true)) {
+                std::cout << "Modelo agregado: " << m_objFileName << std::endl;
+            }
+            else {
+                std::cerr << "Error al cargar: " << m_objFileName << std::endl;
+            }
+        }
         // Mensaje de estado
         if (m_subMeshes.empty()) {
             ImGui::TextColored(ImVec4(1, 1, 0, 1), "Estado: Esperando carga...");
         }
         else {
-            ImGui::TextColored(ImVec4(0, 1, 0, 1), "Estado: Modelo cargado (%d partes)", (int)m_subMeshes.size());
+            ImGui::TextColored(ImVec4(0, 1, 0, 1), "Estado: %d modelo(s) cargado(s) (%d partes)", (int)m_models.size(), (int)m_subMeshes.size());
+            ImGui::Text("Materiales: %d | rangos: %d | cambios de color por frame: %d | llamadas de relleno: %d", (int)m_materials.size(),
+                (int)m_materialRanges.size(), m_materialSwitches, m_fillDrawCalls.load());
+            TextureStats ts = m_textures.stats();
+            ImGui::Text("Texturas: %d pedidas | %d decodificadas | %d en GPU | %d con error", ts.requested, ts.decoded,
+                ts.uploaded, ts.failed);
+            ImGui::Text("Carga: %.0f ms (suma de hilos), %d de la cache en disco, %d comprimidas (%.0f ms)", ts.decodeMs,
+                ts.cacheHits, ts.encoded, ts.encodeMs);
+            ImGui::Text("GPU: %.1f MB (%.1f MB sin comprimir)", ts.gpuBytes / (1024.0 * 1024.0), ts.rawBytes / (1024.0 * 1024.0));
+            ImGui::Text("Agrupadas: %d texturas en %d array(s) y %d atlas", ts.grouped, ts.arrays, ts.atlases);
+            ImGui::Text("Pedidas por la vista: %.1f MB (presupuesto %.0f MB) | niveles leidos %llu, descartados %llu",
+                ts.wantedBytes / (1024.0 * 1024.0), ts.budgetBytes / (1024.0 * 1024.0),
+                ts.streamedLevels, ts.evictedLevels);
+            ImGui::Text("Ultima carga: %llu asig. heap, %llu en arena (%.1f MB)", m_loadAllocations, m_loadArenaAllocations,
+                m_loadArenaBytes / (1024.0 * 1024.0));
+            ImGui::Text("RSS: %.0f MB (pico %.0f MB)", m_loadMemory.rssBytes / (1024.0 * 1024.0), m_loadMemory.peakRssBytes / (1024.0 * 1024.0));
+        }
+        // Modelo activo (destino de las transformaciones globales)
+        for (int i = 0; i < (int)m_models.size(); i++) {
+            ImGui::PushID(i);
+            if (ImGui::Selectable(m_models[i].name.c_str(), i == m_activeModel)) {
+                m_activeModel = i;
+            }
+            ImGui::PopID();
+        }
+        if (!m_models.empty() && ImGui::Button("Limpiar Escena")) {
+            clearScene();
+        }
+        if (ImGui::TreeNode("Generar malla sintetica")) {
+            const char* shapes[] = { "esfera", "terreno", "ensamblado" };
+            int shape = (int)m_generatorParams.shape;
+            if (ImGui::Combo("Forma", &shape, shapes, IM_ARRAYSIZE(shapes))) m_generatorParams.shape = (GeneratedShape)shape;
+            ImGui::InputInt("Triangulos (miles)", &m_generatorTrisK, 100, 1000);
+            ImGui::InputInt("Grupos", &m_generatorParams.groups, 1, 100);
+            ImGui::InputInt("Materiales", &m_generatorParams.materials, 1, 10);
+            ImGui::InputScalar("Semilla", ImGuiDataType_U32, &m_generatorParams.seed);
+            ImGui::Checkbox("Normales (vn)", &m_generatorParams.normals);
+            ImGui::SameLine();
+            ImGui::Checkbox("Coordenadas UV (vt)", &m_generatorParams.texcoords);
+            if (m_generatorRunning) {
+                ImGui::TextColored(ImVec4(1, 0.6f, 0, 1), "Generando %s...", m_generatorFile.c_str());
+                // Seguir dibujando para ver cuando termina
+                requestRedraw();
+            }
+            else if (ImGui::Button("GENERAR Y CARGAR")) {
+                startGenerator();
+            }
+            if (m_generatorStats.triangles > 0) {
+                ImGui::Text("Ultimo: %llu tri, %d grupos, %.1f MB en %.2f s", m_generatorStats.triangles,
+                    m_generatorStats.groups, m_generatorStats.bytes / (1024.0 * 1024.0), m_generatorStats.seconds);
+            }
+            ImGui::TreePop();
         }
     }
     ImGui::Separator();
     //  SISTEMA Y ESTADSTICAS 
     ImGui::Text("Rendimiento: %.1f FPS", ImGui::GetIO().Framerate);
+    if (ImGui::Checkbox("Render bajo demanda", &m_onDemandRendering)) requestRedraw();
+    if (m_onDemandRendering) {
+        ImGui::SameLine();
+        // Este es el ultimo frame pendiente: el loop pasa a esperar eventos
+        if (m_redrawFrames <= 1) ImGui::TextColored(ImVec4(0, 1, 0, 1), "[REPOSO]");
+        else ImGui::TextColored(ImVec4(1, 0.6f, 0, 1), "[ACTIVO]");
+    }
+    // Copia de las medidas del lado render
+    PresentStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        stats = m_presentStats;
+    }
+    ImGui::Text("Frames dibujados: %llu (presentados %llu)", m_renderedFrames, stats.presentedFrames);
+    ImGui::Text("Frame: %.2f ms | Update: %.2f ms (%d ticks) | UI: %.2f ms | Render: %.2f ms",
+        m_frameTimeMs, m_updateTimeMs, m_ticksThisFrame, m_buildTimeMs, stats.renderTimeMs);
+    if (ImGui::Checkbox("Hilo de render dedicado", &m_useRenderThread)) requestRedraw();
+    ImGui::Text("Latencia entrada->pantalla: %.1f ms (media %.1f ms)", stats.lastLatencyMs, stats.avgLatencyMs);
+    ImGui::Text("Ritmo: media %.2f ms | jitter %.2f ms | max %.2f ms", stats.avgIntervalMs, stats.jitterMs, stats.maxIntervalMs);
+    if (stats.intervalCount > 0) {
+        ImGui::PlotLines("Intervalos (ms)", stats.intervalsMs, stats.intervalCount,
+            stats.intervalCount == PresentStats::kHistory ? stats.intervalIndex : 0, nullptr, 0.0f, 50.0f, ImVec2(0, 40));
+    }
+    // Asignaciones del heap por frame (AllocTracker); en estado estable son 0
+    ImGui::Text("Asignaciones/frame: principal %llu (max %llu) | render() %llu (max %llu)",
+        m_mainAllocs.last, m_mainAllocs.max, stats.renderAllocs.last, stats.renderAllocs.max);
+    ImGui::Text("Frames con asignaciones: principal %llu | render() %llu | arena de frame %.1f KB (pico %.1f KB)",
+        m_mainAllocs.framesWithAllocations, stats.renderAllocs.framesWithAllocations,
+        m_frameArena.used() / 1024.0, m_frameArena.peakUsed() / 1024.0);
+    if (ImGui::Checkbox("Detectar asignaciones en render()", &m_checkAllocations)) requestRedraw();
+    ImGui::SameLine();
+    ImGui::Text("%llu violaciones", allocViolations());
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reiniciar##asignaciones")) {
+        m_mainAllocs = FrameAllocStats();
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_presentStats.renderAllocs = FrameAllocStats();
+    }
+    // Ruta para reproducir con --benchmark --path ruta_camara.txt (una pose por tick)
+    if (ImGui::Checkbox("Grabar ruta de camara", &m_recordingPath)) {
+        if (m_recordingPath) {
+            m_recordedPath.clear();
+        }
+        else if (saveCameraPath("ruta_camara.txt", m_recordedPath)) {
+            std::cout << "Ruta de camara guardada: ruta_camara.txt (" << m_recordedPath.size() << " poses)" << std::endl;
+        }
+    }
+    if (m_recordingPath) {
+        ImGui::SameLine();
+        ImGui::Text("%d poses", (int)m_recordedPath.size());
+        // Sin frames no hay ticks: la grabacion necesita el loop activo
+        requestRedraw();
+    }
+    ImGui::Checkbox("Cachear escena 3D (solo redibujar UI)", &m_useSceneCache);
+    if (m_useSceneCache) {
+        ImGui::Text("Capa de escena: %s (reusos %llu / redibujos %llu)",
+            stats.sceneReused ? "reutilizada" : "redibujada", stats.sceneHits, stats.sceneMisses);
+    }
     ImGui::ColorEdit3("Color de Fondo", glm::value_ptr(m_bgColor));
+#if PROFILER_ENABLED
+    bool capturing = Profiler::capturing();
+    if (ImGui::Checkbox("Capturar zonas CPU", &capturing)) PROFILE_CAPTURE(capturing);
+    ImGui::SameLine();
+    // Guardar vacia la captura: la siguiente empieza de cero
+    if (ImGui::Button("Guardar traza CPU (Chrome)")) {
+        if (PROFILE_DUMP("traza_cpu.json")) std::cout << "Traza CPU guardada en traza_cpu.json" << std::endl;
+        else std::cerr << "Error al guardar traza_cpu.json" << std::endl;
+        Profiler::reset();
+    }
+    ImGui::Text("%zu zonas registradas", Profiler::eventCount());
+#endif
+    // PERFIL GPU POR PASADA
+    if (ImGui::CollapsingHeader("Perfil GPU")) {
+        ImGui::Checkbox("Medir pasadas (timer queries)", &m_gpuProfiling);
+        GpuTimingHistory& h = m_gpuTimings;
+        m_gpuProfiler.copyHistory(h);
+        int offset = (h.count == GpuTimingHistory::kHistory) ? h.index : 0;
+        int last = (h.index + GpuTimingHistory::kHistory - 1) % GpuTimingHistory::kHistory;
+        ImGui::Text("Total GPU: %.3f ms (media %.3f ms)", h.count ? h.frameMs[last] : 0.0f, h.avgFrameMs);
+        for (int p = 0; p < GpuTimingHistory::kPasses; p++) {
+            char label[64];
+            // El sufijo ### mantiene el ID estable aunque cambie el texto
+            snprintf(label, sizeof(label), "%s %.3f ms###gpu%d", GpuProfiler::passName((GpuPass)p), h.count ? h.passMs[p][last] : 0.0f, p);
+            ImGui::PlotLines(label, h.passMs[p], h.count, offset, nullptr, 0.0f, std::max(h.avgPassMs[p] * 3.0f, 0.1f), ImVec2(0, 30));
+        }
+        ImGui::TextDisabled("0 ms = pasada no ejecutada (o escena reutilizada)");
+        if (ImGui::Button("Exportar CSV")) {
+            if (m_gpuProfiler.exportCSV("perfil_gpu.csv")) std::cout << "Perfil GPU exportado: perfil_gpu.csv" << std::endl;
+            else std::cerr << "Error al exportar perfil_gpu.csv" << std::endl;
+        }
+    }
     ImGui::Separator();
     // TRANSFORMACIONES GLOBALES 
     if (ImGui::CollapsingHeader("Transformacion Global", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::DragFloat3("Posicion Mundo", glm::value_ptr(m_globalPos), 0.05f);
-        ImGui::DragFloat3("Escala (XYZ)", glm::value_ptr(m_globalScale), 0.01f, 0.01f, 100.0f);
+        if (m_activeModel != -1) {
+            int node = m_models[m_activeModel].node;
+            SceneNode& n = m_scene.node(node);
+            ImGui::Text("Modelo activo: %s", m_models[m_activeModel].name.c_str());
+            if (ImGui::DragFloat3("Posicion Mundo", glm::value_ptr(n.position), 0.05f)) m_scene.markDirty(node);
+            if (ImGui::DragFloat3("Escala (XYZ)", glm::value_ptr(n.scale), 0.01f, 0.01f, 100.0f)) m_scene.markDirty(node);
+            if (ImGui::Checkbox("Auto-rotacion", &m_models[m_activeModel].spinning)) requestRedraw();
+            ImGui::SameLine();
+            ImGui::SliderFloat("Grados/s", &m_spinSpeed, -180.0f, 180.0f, "%.0f");
+        }
         if (ImGui::Button("CENTRAR VISTA Y OBJETO")) {
             resetView();
         }
-        if (ImGui::Button("Centrar Objeto en (0,0,-3)")) {
-            m_globalPos = glm::vec3(0.0f, 0.0f, -3.0f);
-            m_globalRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-            m_globalScale = glm::vec3(1.0f);
+        if (ImGui::Button("Centrar Objeto en (0,0,-3)") && m_activeModel != -1) {
+            int node = m_models[m_activeModel].node;
+            SceneNode& n = m_scene.node(node);
+            n.position = glm::vec3(0.0f, 0.0f, -3.0f);
+            n.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            n.scale = glm::vec3(1.0f);
+            m_scene.markDirty(node);
         }
         ImGui::SameLine();
         if (ImGui::Button("Exportar OBJ")) {
@@ -459,6 +1972,21 @@ void C3DViewer::drawInterface() {
         ImGui::Checkbox("Back-Face Culling", &m_enableCulling); 
         ImGui::SameLine();
         ImGui::Checkbox("Antialiasing", &m_enableAntiAliasing); 
+        ImGui::Checkbox("Texturas (map_Kd)", &m_useTextures);
+        ImGui::SameLine();
+        ImGui::Checkbox("Mapas de normales", &m_useNormalMaps);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("norm / map_Bump del MTL en espacio tangente (tangentes tipo MikkTSpace)");
+        ImGui::Checkbox("Relleno por lotes", &m_batchDraws);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Un glMultiDrawArrays por textura enlazada (arrays y atlas) en lugar de un draw por rango");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(100);
+        ImGui::SliderInt("MB subidos por frame", &m_textureUploadMB, 1, 4);
+        ImGui::SetNextItemWidth(160);
+        ImGui::SliderInt("Presupuesto de texturas (MB)", &m_textureBudgetMB, 8, 2048);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Memoria de GPU para texturas: al pasarse se descartan los mips mas finos");
+        bool compression = m_textures.compression();
+        if (ImGui::Checkbox("Comprimir texturas (BC1/BC3/BC5, cache en disco)", &compression)) m_textures.setCompression(compression);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Vale para las texturas que se carguen despues");
         ImGui::Separator();
         ImGui::Checkbox("Mostrar Wireframe", &m_showWireframe);
         if (m_showWireframe) {
@@ -481,10 +2009,96 @@ void C3DViewer::drawInterface() {
             ImGui::ColorEdit3("Color Normales", glm::value_ptr(m_normalsColor));
             // Slider para longitud 
             if (ImGui::SliderFloat("Largo (%)", &m_normalLengthPercent, 0.01f, 0.5f, "%.2f")) {
-                updateNormalBuffers(); 
+                updateNormalBuffers(true);
             }
             ImGui::Unindent();
         }
+        if (ImGui::TreeNode("Generar Normales")) {
+            int mode = m_normalSettings.smooth ? 1 : 0;
+            ImGui::RadioButton("Planas", &mode, 0);
+            ImGui::SameLine();
+            ImGui::RadioButton("Suaves", &mode, 1);
+            m_normalSettings.smooth = mode == 1;
+            if (m_normalSettings.smooth) {
+                ImGui::SliderFloat("Angulo de pliegue", &m_normalSettings.creaseAngle, 0.0f, 180.0f, "%.0f grados");
+                ImGui::Checkbox("Grupos de suavizado (s)", &m_normalSettings.useSmoothingGroups);
+                ImGui::Checkbox("Ponderar por area", &m_normalSettings.weightByArea);
+                ImGui::SameLine();
+                ImGui::Checkbox("Ponderar por angulo", &m_normalSettings.weightByAngle);
+            }
+            if (ImGui::Button("REGENERAR NORMALES") && !m_models.empty()) {
+                regenerateNormals();
+            }
+            if (m_normalStats.triangles > 0) {
+                ImGui::Text("%zu triangulos, %zu posiciones soldadas, %.1f ms (%u hilos)",
+                    m_normalStats.triangles, m_normalStats.weldedPositions, m_normalStats.milliseconds, ThreadPool::instance().size());
+            }
+            if (m_tangentStats.triangles > 0) {
+                ImGui::Text("Tangentes: %zu triangulos, %zu vertices soldados, %.1f ms", m_tangentStats.triangles,
+                    m_tangentStats.weldedVertices, m_tangentStats.milliseconds);
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Luces puntuales")) {
+            if (ImGui::SliderInt("Cantidad", &m_lightCount, 0, LightClusters::kMaxLights)) m_lightsDirty = true;
+            if (ImGui::SliderFloat("Radio (% de la escena)", &m_lightRadiusPercent, 0.01f, 1.0f, "%.2f")) m_lightsDirty = true;
+            if (ImGui::SliderFloat("Intensidad", &m_lightIntensity, 0.0f, 4.0f, "%.2f")) m_lightsDirty = true;
+            if (ImGui::InputInt("Semilla", &m_lightSeed)) m_lightsDirty = true;
+            if (ImGui::Checkbox("Densidad constante", &m_lightConstantDensity)) m_lightsDirty = true;
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Pasadas las 64 luces la region crece: cada punto recibe las mismas luces en promedio");
+            ImGui::SameLine();
+            ImGui::Checkbox("Animar luces", &m_animateLights);
+            ImGui::Text("%zu luces, %zu indices en %d clusters, asignacion %.2f ms", m_lights.size(), m_lightIndices,
+                LightClusters::kClusters, m_lightAssignMs);
+            if (m_lightsDropped > 0) ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "%zu pares luz-cluster descartados (max %d por cluster)", m_lightsDropped, LightClusters::kMaxPerCluster);
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Sombras")) {
+            ImGui::Checkbox("Sombras (luz direccional y foco)", &m_shadows);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Los mapas se vuelven a dibujar solo si cambian las luces, las transformaciones o la geometria");
+            const int sizes[] = { 1024, 2048, 4096 };
+            const char* sizeNames[] = { "1024", "2048", "4096" };
+            int sizeIndex = m_shadowMapSize >= 4096 ? 2 : (m_shadowMapSize >= 2048 ? 1 : 0);
+            ImGui::SetNextItemWidth(100);
+            if (ImGui::Combo("Resolucion", &sizeIndex, sizeNames, 3)) m_shadowMapSize = sizes[sizeIndex];
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(80);
+            ImGui::SliderInt("PCF (radio)", &m_pcfRadius, 0, 2);
+            ImGui::Checkbox("Foco", &m_spotEnabled);
+            if (m_spotEnabled) {
+                ImGui::Indent();
+                ImGui::SliderFloat("Azimut", &m_spotYaw, -180.0f, 180.0f, "%.0f grados");
+                ImGui::SliderFloat("Elevacion", &m_spotPitch, -89.0f, 89.0f, "%.0f grados");
+                ImGui::SliderFloat("Distancia (diagonales)", &m_spotDistance, 0.3f, 3.0f, "%.2f");
+                ImGui::SliderFloat("Apertura", &m_spotAngle, 5.0f, 80.0f, "%.0f grados");
+                ImGui::ColorEdit3("Color foco", glm::value_ptr(m_spotColor));
+                ImGui::SliderFloat("Intensidad foco", &m_spotIntensity, 0.0f, 4.0f, "%.2f");
+                ImGui::Unindent();
+            }
+            ImGui::Text("Proyectan sombra: %d (direccional), %d (foco) de %d sub-mallados", m_shadowCasters[0], m_shadowCasters[1],
+                (int)m_itemBoxMin.size());
+            ImGui::Text("Mapas dibujados %d veces", m_shadowUpdates.load());
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Oclusion ambiental (SSAO)")) {
+            ImGui::Checkbox("SSAO a media resolucion", &m_ssao);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Oscurece solo la luz ambiental; lineas, puntos y cajas no se ven afectados");
+            const char* presetNames[] = { "Rendimiento (8 muestras, desenfoque 2)", "Calidad (16 muestras, desenfoque 4)" };
+            ImGui::Combo("Preajuste", &m_ssaoPreset, presetNames, kSsaoPresets);
+            ImGui::SliderFloat("Radio (vista)", &m_ssaoRadius, 0.02f, 1.0f, "%.2f");
+            ImGui::SliderFloat("Intensidad SSAO", &m_ssaoStrength, 0.0f, 2.0f, "%.2f");
+            // Mismo interruptor que "Perfil GPU": las timer queries son de todas las pasadas
+            ImGui::Checkbox("Medir tiempo GPU", &m_gpuProfiling);
+            if (m_gpuProfiling) {
+                GpuTimingHistory& h = m_gpuTimings;
+                m_gpuProfiler.copyHistory(h);
+                int last = (h.index + GpuTimingHistory::kHistory - 1) % GpuTimingHistory::kHistory;
+                const int pass = (int)GpuPass::Ssao;
+                ImGui::Text("SSAO %.3f ms (media %.3f ms, %.0f%% del frame)", h.count ? h.passMs[pass][last] : 0.0f, h.avgPassMs[pass],
+                    h.avgFrameMs > 0.0f ? 100.0f * h.avgPassMs[pass] / h.avgFrameMs : 0.0f);
+            }
+            ImGui::TreePop();
+        }
     }
     // EDICIN DE SUB-MALLADO
     if (ImGui::CollapsingHeader("Edicion Sub-Mallado (Picking)", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -492,12 +2106,24 @@ void C3DViewer::drawInterface() {
             SubMesh& sub = m_subMeshes[m_selectedSubMeshIndex];
             // Mostrar nombre e ID
             ImGui::TextColored(ImVec4(0, 1, 0, 1), "SELECCIONADO: %s (ID: %d)", sub.name.c_str(), m_selectedSubMeshIndex);
-            ImGui::ColorEdit3("Material (Kd)", glm::value_ptr(sub.diffuseColor));
-            ImGui::DragFloat3("Posicion Local", glm::value_ptr(sub.localPosition), 0.05f);
+            // Un color por material del sub-mallado (compartido con las demas partes que lo usen)
+            for (unsigned int r = sub.firstRange; r < sub.firstRange + sub.rangeCount; r++) {
+                Material& mat = m_materials[m_materialRanges[r].material];
+                ImGui::PushID((int)r);
+                ImGui::ColorEdit3("##kd", glm::value_ptr(mat.diffuseColor), ImGuiColorEditFlags_NoInputs);
+                ImGui::SameLine();
+                ImGui::Text("Material (Kd): %s (%u tri)", mat.name.c_str(), m_materialRanges[r].vertexCount / 3);
+                if (mat.diffuseTexture >= 0) ImGui::TextDisabled("  map_Kd: %s", mat.diffuseMap.c_str());
+                ImGui::PopID();
+            }
+            if (ImGui::DragFloat3("Posicion Local", glm::value_ptr(m_scene.node(sub.node).position), 0.05f)) {
+                m_scene.markDirty(sub.node);
+            }
             ImGui::Checkbox("Ver Bounding Box", &m_showBoundingBox);
             if (m_showBoundingBox) {
                 ImGui::SameLine();
                 ImGui::ColorEdit3("Color BB", glm::value_ptr(m_boundingBoxColor), ImGuiColorEditFlags_NoInputs);
+                ImGui::Checkbox("Caja orientada (PCA)", &m_orientedBoundingBox);
             }
             ImGui::Separator();
             // Botn rojo para indicar accin destructiva
@@ -515,19 +2141,24 @@ void C3DViewer::drawInterface() {
         }
     }
     ImGui::End();
+    // Widgets en uso (arrastres, texto, popups) siguen necesitando frames
+    if (ImGui::IsAnyItemActive() || ImGui::IsPopupOpen("", ImGuiPopupFlags_AnyPopupId)) requestRedraw();
+    // Solo se generan las listas: se dibujan en el lado render desde el snapshot
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void C3DViewer::resize(int new_width, int new_height) {
+    // El viewport lo fija el render a partir del snapshot
     width = new_width;
     height = new_height;
-    glViewport(0, 0, width, height);
 }
 
 bool C3DViewer::setupShader() {
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSrc, nullptr);
+    // El paso de drawData sale de la misma constante que usa el C++ al llenarlo
+    const std::string vertexHeader = "#version 330 core\n#define DRAW_DATA_TEXELS " + std::to_string(kDrawDataTexels) + "\n";
+    const char* vertexSources[] = { vertexHeader.c_str(), vertexShaderSrc };
+    glShaderSource(vertexShader, 2, vertexSources, nullptr);
     glCompileShader(vertexShader);
     if (!checkCompileErrors(vertexShader, "VERTEX")) return false;
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -541,6 +2172,65 @@ bool C3DViewer::setupShader() {
     if (!checkCompileErrors(m_shaderProgram, "PROGRAM")) return false;
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    m_uniforms.model = glGetUniformLocation(m_shaderProgram, "model");
+    m_uniforms.normalMatrix = glGetUniformLocation(m_shaderProgram, "normalMatrix");
+    m_uniforms.view = glGetUniformLocation(m_shaderProgram, "view");
+    m_uniforms.projection = glGetUniformLocation(m_shaderProgram, "projection");
+    m_uniforms.uColor = glGetUniformLocation(m_shaderProgram, "uColor");
+    m_uniforms.isPicking = glGetUniformLocation(m_shaderProgram, "isPicking");
+    m_uniforms.useFlatColor = glGetUniformLocation(m_shaderProgram, "useFlatColor");
+    m_uniforms.textureMode = glGetUniformLocation(m_shaderProgram, "textureMode");
+    m_uniforms.textureLayer = glGetUniformLocation(m_shaderProgram, "textureLayer");
+    m_uniforms.uvTransform = glGetUniformLocation(m_shaderProgram, "uvTransform");
+    m_uniforms.diffuseMap = glGetUniformLocation(m_shaderProgram, "diffuseMap");
+    m_uniforms.diffuseArray = glGetUniformLocation(m_shaderProgram, "diffuseArray");
+    m_uniforms.batched = glGetUniformLocation(m_shaderProgram, "batched");
+    m_uniforms.drawData = glGetUniformLocation(m_shaderProgram, "drawData");
+    m_uniforms.normalMode = glGetUniformLocation(m_shaderProgram, "normalMode");
+    m_uniforms.normalLayer = glGetUniformLocation(m_shaderProgram, "normalLayer");
+    m_uniforms.normalUvTransform = glGetUniformLocation(m_shaderProgram, "normalUvTransform");
+    m_uniforms.normalMap = glGetUniformLocation(m_shaderProgram, "normalMap");
+    m_uniforms.normalArray = glGetUniformLocation(m_shaderProgram, "normalArray");
+    m_uniforms.lightCount = glGetUniformLocation(m_shaderProgram, "lightCount");
+    m_uniforms.lightData = glGetUniformLocation(m_shaderProgram, "lightData");
+    m_uniforms.clusterGrid = glGetUniformLocation(m_shaderProgram, "clusterGrid");
+    m_uniforms.clusterLights = glGetUniformLocation(m_shaderProgram, "clusterLights");
+    m_uniforms.clusterDims = glGetUniformLocation(m_shaderProgram, "clusterDims");
+    m_uniforms.clusterTileScale = glGetUniformLocation(m_shaderProgram, "clusterTileScale");
+    m_uniforms.clusterZ = glGetUniformLocation(m_shaderProgram, "clusterZ");
+    m_uniforms.sunDirection = glGetUniformLocation(m_shaderProgram, "sunDirection");
+    m_uniforms.shadowMask = glGetUniformLocation(m_shaderProgram, "shadowMask");
+    m_uniforms.pcfRadius = glGetUniformLocation(m_shaderProgram, "pcfRadius");
+    m_uniforms.sunShadowMatrix = glGetUniformLocation(m_shaderProgram, "sunShadowMatrix");
+    m_uniforms.spotShadowMatrix = glGetUniformLocation(m_shaderProgram, "spotShadowMatrix");
+    m_uniforms.sunShadowMap = glGetUniformLocation(m_shaderProgram, "sunShadowMap");
+    m_uniforms.spotShadowMap = glGetUniformLocation(m_shaderProgram, "spotShadowMap");
+    m_uniforms.spotEnabled = glGetUniformLocation(m_shaderProgram, "spotEnabled");
+    m_uniforms.spotPosition = glGetUniformLocation(m_shaderProgram, "spotPosition");
+    m_uniforms.spotDirection = glGetUniformLocation(m_shaderProgram, "spotDirection");
+    m_uniforms.spotCone = glGetUniformLocation(m_shaderProgram, "spotCone");
+    m_uniforms.spotColor = glGetUniformLocation(m_shaderProgram, "spotColor");
+    m_uniforms.ambientInAlpha = glGetUniformLocation(m_shaderProgram, "ambientInAlpha");
+    // Unidades fijas: 0 textura difusa (o atlas), 1 array de texturas, 2 datos por dibujo,
+    // 3 mapa de normales (o atlas), 4 array de mapas de normales, 5-7 luces por clusters,
+    // 8 y 9 mapas de sombra (10 a 13 son de la pasada SSAO)
+    glUseProgram(m_shaderProgram);
+    glUniform1i(m_uniforms.diffuseMap, 0);
+    glUniform1i(m_uniforms.diffuseArray, 1);
+    glUniform1i(m_uniforms.drawData, 2);
+    glUniform1i(m_uniforms.normalMap, 3);
+    glUniform1i(m_uniforms.normalArray, 4);
+    glUniform1i(m_uniforms.lightData, 5);
+    glUniform1i(m_uniforms.clusterGrid, 6);
+    glUniform1i(m_uniforms.clusterLights, 7);
+    glUniform1i(m_uniforms.sunShadowMap, 8);
+    glUniform1i(m_uniforms.spotShadowMap, 9);
+    glUniform3fv(m_uniforms.sunDirection, 1, glm::value_ptr(kSunDirection));
+    glUseProgram(0);
+    // Sin el programa de profundidad se dibuja sin sombras
+    m_shadowMapsReady = m_shadowMaps.init();
+    // Idem sin oclusion ambiental
+    m_ssaoReady = m_ssaoPass.init();
     return true;
 }
 
@@ -570,19 +2260,31 @@ bool C3DViewer::checkCompileErrors(GLuint shader, const char* type) {
 void C3DViewer::keyCallbackStatic(GLFWwindow* window, int key, int scancode, int action, int mods) {
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
     C3DViewer* self = (C3DViewer*)glfwGetWindowUserPointer(window);
-    if (self) self->onKey(key, scancode, action, mods);
+    if (self) { self->requestRedraw(); self->noteInput(); self->onKey(key, scancode, action, mods); }
 }
 
 void C3DViewer::mouseButtonCallbackStatic(GLFWwindow* window, int button, int action, int mods) {
     ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
     C3DViewer* self = (C3DViewer*)glfwGetWindowUserPointer(window);
-    if (self) self->onMouseButton(button, action, mods);
+    if (self) { self->requestRedraw(); self->noteInput(); self->onMouseButton(button, action, mods); }
 }
 
 void C3DViewer::cursorPosCallbackStatic(GLFWwindow* window, double xpos, double ypos) {
     ImGui_ImplGlfw_CursorPosCallback(window, xpos, ypos);
     C3DViewer* self = (C3DViewer*)glfwGetWindowUserPointer(window);
-    if (self) self->onCursorPos(xpos, ypos);
+    if (self) { self->requestRedraw(); self->noteInput(); self->onCursorPos(xpos, ypos); }
+}
+
+void C3DViewer::scrollCallbackStatic(GLFWwindow* window, double xoffset, double yoffset) {
+    ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
+    C3DViewer* self = (C3DViewer*)glfwGetWindowUserPointer(window);
+    if (self) { self->requestRedraw(); self->noteInput(); }
+}
+
+void C3DViewer::charCallbackStatic(GLFWwindow* window, unsigned int c) {
+    ImGui_ImplGlfw_CharCallback(window, c);
+    C3DViewer* self = (C3DViewer*)glfwGetWindowUserPointer(window);
+    if (self) { self->requestRedraw(); self->noteInput(); }
 }
 
 void C3DViewer::setupBBoxBuffer() {
@@ -613,61 +2315,74 @@ void C3DViewer::setupBBoxBuffer() {
     glBindVertexArray(0);
 }
 
+glm::mat4 C3DViewer::selectedBoxTransform() {
+    const SubMesh& sub = m_subMeshes[m_selectedSubMeshIndex];
+    if (!m_orientedBoundingBox) {
+        glm::mat4 box = glm::translate(glm::mat4(1.0f), (sub.min + sub.max) * 0.5f);
+        return glm::scale(box, sub.max - sub.min);
+    }
+    if (m_obbSubMesh != m_selectedSubMeshIndex) {
+        m_obb = computeOrientedBox(m_vertices, sub.firstVertex, sub.indexCount);
+        m_obbSubMesh = m_selectedSubMeshIndex;
+    }
+    return m_obb.boxTransform();
+}
+
 // Implementacin de la funcin de dibujo
-void C3DViewer::drawBoundingBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& parentModel, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color) {
+void C3DViewer::drawBoundingBox(const glm::mat4& box, const glm::mat4& parentModel, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color) {
     if (m_vao_bbox == 0) setupBBoxBuffer();
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 1);
-    glUniform3fv(glGetUniformLocation(m_shaderProgram, "uColor"), 1, glm::value_ptr(color));
-    glm::vec3 size = max - min;
-    glm::vec3 center = (min + max) * 0.5f;
-    glm::mat4 bboxModel = parentModel;
-    bboxModel = glm::translate(bboxModel, center);
-    bboxModel = glm::scale(bboxModel, size * 1.005f);
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(bboxModel));
+    glUniform1i(m_uniforms.useFlatColor, 1);
+    glUniform3fv(m_uniforms.uColor, 1, glm::value_ptr(color));
+    glm::mat4 bboxModel = parentModel * box;
+    bboxModel = glm::scale(bboxModel, glm::vec3(1.005f));
+    glUniformMatrix4fv(m_uniforms.model, 1, GL_FALSE, glm::value_ptr(bboxModel));
     glBindVertexArray(m_vao_bbox);
     glLineWidth(2.0f);
     glDrawArrays(GL_LINES, 0, 24);
     glLineWidth(1.0f);
     glBindVertexArray(0);
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 0);
-}
-
-void C3DViewer::updateNormalBuffers() {
-    std::vector<float> lineVertices;
-    float len = m_boundingBoxDiagonal * m_normalLengthPercent;
-    for (const auto& v : m_vertices) {
-        // Punto inicio
-        lineVertices.push_back(v.Position.x);
-        lineVertices.push_back(v.Position.y);
-        lineVertices.push_back(v.Position.z);
-        // Punto fin 
-        glm::vec3 end = v.Position + v.Normal * len;
-        lineVertices.push_back(end.x);
-        lineVertices.push_back(end.y);
-        lineVertices.push_back(end.z);
-    }
-    m_normalCount = lineVertices.size() / 3;
-    if (m_vao_normals == 0) {
-        glGenVertexArrays(1, &m_vao_normals);
-        glGenBuffers(1, &m_vbo_normals);
-    }
-    glBindVertexArray(m_vao_normals);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo_normals);
-    glBufferData(GL_ARRAY_BUFFER, lineVertices.size() * sizeof(float), lineVertices.data(), GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
+    glUniform1i(m_uniforms.useFlatColor, 0);
+}
+
+void C3DViewer::updateNormalBuffers(bool perFrame) {
+    PROFILE_FUNCTION();
+    // Desde el slider, en la arena del frame: viven hasta que el render las sube, sin
+    // pasar por el heap. Al cargar (o si no entran) van a un bloque propio del heap
+    size_t floats = normalLineFloats(m_models);
+    size_t bytes = floats * sizeof(float);
+    bool heap = !perFrame || bytes > kMaxFrameUpload;
+    float* lines = static_cast<float*>(heap ? ::operator new(bytes) : m_frameArena.allocate(bytes, alignof(float)));
+    buildNormalLines(m_vertices, m_models, m_normalLengthPercent, lines);
+    m_normalCount = (int)(floats / 3);
+    // Un solo puntero ademas de this: la lambda entra en std::function sin reservar
+    const UploadSpan* upload = new (m_frameArena.allocate(sizeof(UploadSpan), alignof(UploadSpan))) UploadSpan{ lines, bytes, heap };
+    runOnRenderThread([this, upload]() {
+        if (m_vao_normals == 0) {
+            glGenVertexArrays(1, &m_vao_normals);
+            glGenBuffers(1, &m_vbo_normals);
+        }
+        glBindVertexArray(m_vao_normals);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo_normals);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)upload->bytes, upload->data, GL_DYNAMIC_DRAW);
+        if (upload->heap) ::operator delete(const_cast<void*>(upload->data));
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    });
+    m_geometryVersion++;
 }
 
-void C3DViewer::drawNormals(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj) {
-    if (m_vao_normals == 0) updateNormalBuffers();
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 1);
-    glUniform3fv(glGetUniformLocation(m_shaderProgram, "uColor"), 1, glm::value_ptr(m_normalsColor));
-    glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+void C3DViewer::drawNormals(const DrawItem& item, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color) {
+    // Se crean en updateNormalBuffers() al cargar un modelo
+    if (m_vao_normals == 0) return;
+    glUniform1i(m_uniforms.useFlatColor, 1);
+    glUniform3fv(m_uniforms.uColor, 1, glm::value_ptr(color));
+    glUniformMatrix4fv(m_uniforms.model, 1, GL_FALSE, glm::value_ptr(model));
     glBindVertexArray(m_vao_normals);
-    glDrawArrays(GL_LINES, 0, m_normalCount);
+    // Dos vertices de linea por vertice del sub-mallado
+    glDrawArrays(GL_LINES, 2 * item.firstVertex, 2 * item.vertexCount);
     glBindVertexArray(0);
-    glUniform1i(glGetUniformLocation(m_shaderProgram, "useFlatColor"), 0);
+    glUniform1i(m_uniforms.useFlatColor, 0);
 }
 
 void C3DViewer::resetView() {
@@ -677,60 +2392,25 @@ void C3DViewer::resetView() {
     m_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
     m_cameraYaw = -90.0f;
     m_cameraPitch = 0.0f;
-    // Resetear Transformaciones del Objeto
-    m_globalPos = glm::vec3(0.0f, 0.0f, -3.0f); 
-    m_globalScale = glm::vec3(1.0f);
-    m_globalRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); 
+    m_prevCameraPos = m_viewPos = m_cameraPos;
+    m_prevCameraYaw = m_cameraYaw;
+    m_prevCameraPitch = m_cameraPitch;
+    m_viewFront = m_cameraFront;
+    // Resetear Transformaciones de los Modelos
+    for (const auto& m : m_models) {
+        SceneNode& n = m_scene.node(m.node);
+        n.position = m.homePosition;
+        n.scale = glm::vec3(1.0f);
+        n.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        m_scene.markDirty(m.node);
+    }
+    requestRedraw();
     std::cout << "Vista y Objeto centrados." << std::endl;
 }
 
 void C3DViewer::exportOBJ(const std::string& filename) {
-    std::string mtlFilename = filename.substr(0, filename.find_last_of('.')) + ".mtl";
-    std::string mtlNameOnly = mtlFilename.substr(mtlFilename.find_last_of("/\\") + 1);
-    std::ofstream outObj(filename);
-    std::ofstream outMtl(mtlFilename);
-    if (!outObj.is_open() || !outMtl.is_open()) return;
-    outObj << "# Exportado por C3DViewer\n";
-    outObj << "mtllib " << mtlNameOnly << "\n";
-    glm::mat4 globalModel = glm::mat4(1.0f);
-    globalModel = glm::translate(globalModel, m_globalPos);
-    globalModel = globalModel * glm::toMat4(m_globalRotation);
-    globalModel = glm::scale(globalModel, m_globalScale * m_scaleFactor);
-    globalModel = glm::translate(globalModel, -m_center);
-    int vertexOffset = 1;
-    for (const auto& sub : m_subMeshes) {
-        if (!sub.visible) continue;
-        std::string matName = "Mat_" + sub.name;
-        std::replace(matName.begin(), matName.end(), ' ', '_');
-        // Escribir Material
-        outMtl << "newmtl " << matName << "\n";
-        outMtl << "Kd " << sub.diffuseColor.r << " " << sub.diffuseColor.g << " " << sub.diffuseColor.b << "\n";
-        outMtl << "Ka 0.1 0.1 0.1\nKs 0.5 0.5 0.5\nNs 32\nd 1.0\nillum 2\n\n";
-        outObj << "g " << sub.name << "\n";
-        outObj << "usemtl " << matName << "\n";
-        // Matrices
-        glm::mat4 totalMatrix = glm::translate(globalModel, sub.localPosition);
-        // Para normales
-        glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(totalMatrix))); 
-        // Escribir Vrtices y Normales
-        for (unsigned int idx : sub.indices) {
-            Vertex v = m_vertices[idx];
-            // Posicin
-            glm::vec4 pos = totalMatrix * glm::vec4(v.Position, 1.0f);
-            outObj << "v " << pos.x << " " << pos.y << " " << pos.z << "\n";
-            // Normal
-            glm::vec3 norm = glm::normalize(normalMatrix * v.Normal);
-            outObj << "vn " << norm.x << " " << norm.y << " " << norm.z << "\n";
-        }
-        // Escribir Caras
-        int count = sub.indices.size();
-        for (int i = 0; i < count; i += 3) {
-            unsigned int i1 = vertexOffset + i;
-            unsigned int i2 = vertexOffset + i + 1;
-            unsigned int i3 = vertexOffset + i + 2;
-            outObj << "f " << i1 << "//" << i1 << " " << i2 << "//" << i2 << " " << i3 << "//" << i3 << "\n";
-        }
-        vertexOffset += count;
-    }
+    PROFILE_FUNCTION();
+    m_scene.update();
+    if (!writeOBJ(filename, m_vertices, m_subMeshes, m_materials, m_materialRanges, m_models.size(), m_scene)) return;
     std::cout << "Exportado correctamente con normales." << std::endl;
 }
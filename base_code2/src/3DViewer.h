@@ -7,6 +7,10 @@
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -17,29 +21,31 @@
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
-
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
-};
-
-struct SubMesh {
-    std::string name;
-    std::vector<unsigned int> indices;
-    unsigned int indexCount = 0;
-    glm::vec3 diffuseColor = glm::vec3(0.7f);
-    glm::vec3 localPosition = glm::vec3(0.0f);
-    bool visible = true;
-    glm::vec3 min = glm::vec3(FLT_MAX);
-    glm::vec3 max = glm::vec3(-FLT_MAX);
-};
+#include "SceneGraph.h"
+#include "MeshPipeline.h"
+#include "AllocTracker.h"
+#include "Bounds.h"
+#include "MeshGenerator.h"
+#include "NormalGenerator.h"
+#include "TangentGenerator.h"
+#include "RenderSnapshot.h"
+#include "TextureCache.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "Headless.h"
 
 class C3DViewer {
 public:
     C3DViewer();
     virtual ~C3DViewer();
     bool setup();
+    // Sin ventana: contexto EGL (o ventana oculta) y FBO de salida w x h
+    bool setupHeadless(int w, int h);
+    // Renderiza cada modelo con cada camara a PNG; devuelve el numero de fallos
+    int runBatch(const BatchJob& job);
+    // Recorre el camino de camara con cada opcion de render y escribe JSON.
+    // Devuelve 0, 1 (error) o 3 (presupuesto superado)
+    int runBenchmark(const BatchJob& job);
     void mainLoop();
     void exportOBJ(const std::string& filename);
     void resetView();
@@ -48,61 +54,289 @@ private:
     virtual void onKey(int key, int scancode, int action, int mods);
     virtual void onMouseButton(int button, int action, int mods);
     virtual void onCursorPos(double xpos, double ypos);
-    virtual void update();
-    virtual void render();
+    virtual void update(float dt);
+    // Interpola el estado de la simulacion entre los dos ultimos ticks
+    void interpolateState(float alpha);
+    // Hilo principal: arma el snapshot inmutable del frame (incluida la UI)
+    void buildSnapshot(RenderSnapshot& snap);
+    // Lado render: solo lee el snapshot y el estado GL propio
+    virtual void render(const RenderSnapshot& snap);
+    // Dibuja en target (el FBO ya enlazado); con SSAO el relleno pasa antes por el FBO de m_ssaoPass
+    void renderScene(const RenderSnapshot& snap, GLuint target);
+    // Capa de escena cacheada (FBO color+profundidad)
+    bool ensureSceneTarget(int w, int h);
+    void destroySceneTarget();
+    unsigned long long computeSceneKey() const;
     virtual void drawInterface();
+    // Hilo de render dedicado
+    void startRenderThread();
+    void stopRenderThread();
+    void renderThreadMain();
+    // Ejecuta trabajo GL en el hilo que posee el contexto
+    void runOnRenderThread(std::function<void()> fn);
+    void executeRenderCommands(unsigned long long upToFrame);
+    // Sube texturas ya decodificadas (hasta snap.options.textureUploadBytes) antes de dibujar
+    void uploadTextures(const RenderSnapshot& snap);
+    // Hilo principal: pixeles en pantalla de cada textura visible -> niveles residentes
+    void updateTextureResidency(const RenderSnapshot& snap);
+    // Abre el bloque de m_frameArena del frame en curso (espera si el render aun lo usa)
+    void beginFrameArena();
+    void recordPresent(const RenderSnapshot& snap, double renderStart);
+    void noteInput();
+    void applyCameraPreset(const CameraPreset& preset);
+    void applyCameraKey(const CameraKey& key);
+    // Generador de mallas sinteticas: escribe en un hilo aparte y carga al terminar
+    void startGenerator();
+    void finishGenerator();
+    bool saveFrame(const std::string& path);
     void setupBBoxBuffer();
+    // Hilo principal: regenera o anima m_lights y las asigna a los clusters de la vista
+    void updateLights(RenderSnapshot& snap);
+    // Lado render: sube las listas de luces del snapshot y deja listos sus uniforms
+    void bindLights(const RenderSnapshot& snap);
+    // Hilo principal: foco, matrices de las luces con sombra y sub-mallados dentro de su frustum
+    void updateShadows(RenderSnapshot& snap);
+    // Lado render: vuelve a dibujar los mapas si cambio snap.shadowKey; bindShadows los
+    // enlaza (unidades 8 y 9) para la pasada de relleno
+    void renderShadows(const RenderSnapshot& snap);
+    void bindShadows(const RenderSnapshot& snap);
     // Helpers
     void resize(int new_width, int new_height);
     bool setupShader();
     bool checkCompileErrors(GLuint shader, const char* type);
-    bool loadOBJ(const std::string& path);
-    void calculateBoundingBox();
+    bool loadOBJ(const std::string& path, bool append = false);
+    void clearScene();
+    void calculateBoundingBox(Model& model);
     void computeNormals(); 
+    // Reemplaza las normales de todos los modelos segun m_normalSettings
+    void regenerateNormals();
+    // Tangentes de los sub-mallados con mapa de normales desde firstSubMesh (tras las normales)
+    void computeTangents(unsigned int firstSubMesh);
     void setupMeshBuffers();
-    // Picking
-    int pickObject(double x, double y); 
+    // Ordena los rangos de material para dibujar juntos los del mismo material
+    void buildDrawOrder();
+    // Picking (se resuelve en el lado render y se aplica en el hilo principal)
+    int pickObject(const RenderSnapshot& snap, double x, double y); 
+    void applyPickResult(int picked);
     // Dibujo auxiliar
-    void drawNormals(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj);
-    void drawBoundingBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color);
+    void drawNormals(const DrawItem& item, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color);
+    void drawBoundingBox(const glm::mat4& box, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, glm::vec3 color);
+    // Caja del sub-mallado seleccionado (alineada u orientada) como transformacion del cubo unitario
+    glm::mat4 selectedBoxTransform();
     static void keyCallbackStatic(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void mouseButtonCallbackStatic(GLFWwindow* window, int button, int action, int mods);
     static void cursorPosCallbackStatic(GLFWwindow* window, double xpos, double ypos);
-    void updateNormalBuffers();
+    static void scrollCallbackStatic(GLFWwindow* window, double xoffset, double yoffset);
+    static void charCallbackStatic(GLFWwindow* window, unsigned int c);
+    // perFrame: lo pide la UI en medio de un frame (slider); solo entonces las lineas
+    // salen de m_frameArena
+    void updateNormalBuffers(bool perFrame = false);
+    // Render bajo demanda: pide dibujar los proximos frames
+    void requestRedraw(int frames = 3);
+    void setModelUniforms(const DrawItem& item);
+    // Pasada de relleno: un draw por rango, o por lotes si hay texture buffer
+    void drawFillRanges(const RenderSnapshot& snap);
+    bool drawFillBatched(const RenderSnapshot& snap);
 protected:
     char m_objFileName[128] = "pig.obj";
     int width = 1280;
     int height = 720;
     GLFWwindow* m_window = nullptr;
+    // Modo headless: se dibuja en m_outputFbo en lugar del framebuffer por defecto
+    bool m_headless = false;
+    HeadlessContext m_headlessContext;
+    GLuint m_outputFbo = 0, m_outputColorRbo = 0, m_outputDepthRbo = 0;
     // OpenGL handles
     GLuint m_vao = 0, m_vbo = 0;
+    // Rango de material de cada vertice (atributo 3)
+    GLuint m_drawIdVbo = 0;
     GLuint m_shaderProgram = 0;
-    // Datos del Modelo
-    std::vector<Vertex> m_vertices;
+    // Ubicaciones de los uniforms: se buscan una vez al enlazar, no por nombre en cada draw
+    struct ShaderUniforms {
+        GLint model = -1, normalMatrix = -1, view = -1, projection = -1;
+        GLint uColor = -1, isPicking = -1, useFlatColor = -1;
+        GLint textureMode = -1, textureLayer = -1, uvTransform = -1, diffuseMap = -1, diffuseArray = -1;
+        GLint normalMode = -1, normalLayer = -1, normalUvTransform = -1, normalMap = -1, normalArray = -1;
+        GLint batched = -1, drawData = -1;
+        GLint lightCount = -1, lightData = -1, clusterGrid = -1, clusterLights = -1;
+        GLint clusterDims = -1, clusterTileScale = -1, clusterZ = -1;
+        GLint sunDirection = -1, shadowMask = -1, pcfRadius = -1;
+        GLint sunShadowMatrix = -1, spotShadowMatrix = -1, sunShadowMap = -1, spotShadowMap = -1;
+        GLint spotEnabled = -1, spotPosition = -1, spotDirection = -1, spotCone = -1, spotColor = -1;
+        GLint ambientInAlpha = -1;
+    } m_uniforms;
+    // Datos de la Escena (todos los modelos comparten m_vertices)
+    VertexStreams m_vertices;
     std::vector<SubMesh> m_subMeshes;
-    glm::vec3 m_center = glm::vec3(0.0f);
-    float m_scaleFactor = 1.0f;
-    // Para longitud de normales
-    float m_boundingBoxDiagonal = 1.0f; 
+    std::vector<Model> m_models;
+    // Materiales de todos los modelos y rangos por material de cada sub-mallado
+    std::vector<Material> m_materials;
+    std::vector<MaterialRange> m_materialRanges;
+    // Indices de m_materialRanges ordenados por (material, sub-mallado); se arma al cargar
+    std::vector<unsigned int> m_drawOrder;
+    // Texturas de los MTL (decodificacion en segundo plano, subida por frames)
+    TextureCache m_textures;
+    bool m_useTextures = true;
+    bool m_useNormalMaps = true;
+    int m_textureUploadMB = 4;
+    // Memoria de texturas en la GPU; m_textureUses se reutiliza cada frame
+    int m_textureBudgetMB = 256;
+    std::vector<TextureUse> m_textureUses;
+    // Relleno por lotes: kDrawDataTexels texeles RGBA32F por rango de material (matriz
+    // de modelo, de normales, color y modo, transformacion de UV, capa y lo mismo del
+    // mapa de normales) en un texture buffer, y glMultiDrawArrays por cada combinacion
+    // de texturas enlazadas (solo lado render)
+    static const int kDrawDataTexels = 11;
+    bool m_batchDraws = true;
+    GLuint m_drawDataBuffer = 0, m_drawDataTex = 0;
+    size_t m_drawDataCapacity = 0;
+    GLint m_maxDrawDataTexels = 0;
+    std::vector<glm::vec4> m_drawData;
+    // Texturas de un lote en las unidades 0 (difusa o atlas), 1 (array difuso),
+    // 3 (normales o atlas) y 4 (array de normales); 0 = libre
+    struct FillBatch {
+        GLuint textures[4] = { 0, 0, 0, 0 };
+    };
+    std::vector<FillBatch> m_fillBatches;
+    std::vector<int> m_rangeBatch;
+    std::vector<GLint> m_batchFirst;
+    std::vector<GLsizei> m_batchCount;
+    // Llamadas de dibujo de la ultima pasada de relleno
+    std::atomic<int> m_fillDrawCalls{ 0 };
+    // Item del snapshot de cada sub-mallado en el frame en curso (-1 = oculto)
+    std::vector<int> m_itemOfSubMesh;
+    // Cambios de color de la pasada de relleno en el ultimo snapshot
+    int m_materialSwitches = 0;
+    // Grupo de suavizado ('s' del OBJ) de cada triangulo de m_vertices
+    std::vector<unsigned int> m_smoothingGroups;
+    NormalSettings m_normalSettings;
+    NormalStats m_normalStats;
+    // Ultima generacion de tangentes (carga o regeneracion de normales)
+    TangentStats m_tangentStats;
+    // Luces puntuales repartidas al azar (con semilla) en la caja de la escena; el
+    // radio es una fraccion de su diagonal. Con densidad constante, pasadas las 64
+    // luces la region crece con la cantidad. m_lightBase es la posicion sin animar
+    std::vector<PointLight> m_lights;
+    std::vector<glm::vec3> m_lightBase;
+    int m_lightCount = 0;
+    float m_lightRadiusPercent = 0.15f;
+    float m_lightIntensity = 1.0f;
+    int m_lightSeed = 1;
+    bool m_lightConstantDensity = true;
+    bool m_animateLights = false;
+    // Reloj de la animacion (avanza en update) y el instante de las posiciones actuales
+    float m_lightTime = 0.0f;
+    float m_lightPoseTime = 0.0f;
+    bool m_lightsDirty = true;
+    unsigned long long m_lightsGeometry = ~0ull;
+    // Cambia con cada movimiento de las luces (entra en la clave de la capa de escena)
+    unsigned long long m_lightsVersion = 0;
+    LightClusterBuilder m_lightClusters;
+    // Ultima asignacion: tiempo, indices y pares descartados por el tope por cluster
+    float m_lightAssignMs = 0.0f;
+    size_t m_lightIndices = 0;
+    size_t m_lightsDropped = 0;
+    // Lado render: luces (RGBA32F), rejilla (RG32UI) e indices (R32UI) en texture
+    // buffers en las unidades 5, 6 y 7
+    GLuint m_lightBuffers[3] = { 0, 0, 0 };
+    GLuint m_lightTextures[3] = { 0, 0, 0 };
+    size_t m_lightBufferBytes[3] = { 0, 0, 0 };
+    // Sombras de la luz direccional y de un foco que apunta al centro de la escena
+    // desde los angulos dados, a m_spotDistance diagonales. Los mapas se guardan entre
+    // frames: la clave cubre luces, matrices de mundo, geometria y visibilidad, no la camara
+    bool m_shadows = true;
+    int m_shadowMapSize = 2048;
+    int m_pcfRadius = 1;
+    bool m_spotEnabled = false;
+    float m_spotYaw = 45.0f;
+    float m_spotPitch = 50.0f;
+    float m_spotDistance = 0.8f;
+    float m_spotAngle = 25.0f;
+    glm::vec3 m_spotColor = glm::vec3(1.0f, 0.9f, 0.75f);
+    float m_spotIntensity = 1.0f;
+    unsigned long long m_shadowKey = 0;
+    // Cajas de mundo de los items del snapshot en armado
+    std::vector<glm::vec3> m_itemBoxMin;
+    std::vector<glm::vec3> m_itemBoxMax;
+    // Sub-mallados que proyectan sombra en cada mapa (el resto queda fuera del frustum)
+    int m_shadowCasters[2] = { 0, 0 };
+    // Lado render
+    ShadowMaps m_shadowMaps;
+    bool m_shadowMapsReady = false;
+    bool m_shadowCacheValid = false;
+    unsigned long long m_shadowCacheKey = 0;
+    std::atomic<int> m_shadowUpdates{ 0 };
+    // Oclusion ambiental: preajuste (0 rendimiento, 1 calidad) mas radio e intensidad
+    bool m_ssao = false;
+    int m_ssaoPreset = 0;
+    float m_ssaoRadius = 0.3f;
+    float m_ssaoStrength = 1.0f;
+    // Lado render
+    SsaoPass m_ssaoPass;
+    bool m_ssaoReady = false;
+    // Memoria de la ultima carga (hilo principal) y del proceso al terminarla
+    unsigned long long m_loadAllocations = 0;
+    unsigned long long m_loadArenaAllocations = 0;
+    size_t m_loadArenaBytes = 0;
+    MemoryUsage m_loadMemory;
+    SceneGraph m_scene;
+    int m_activeModel = -1;
     // Seleccin y Edicin
     int m_selectedSubMeshIndex = -1;
     bool isDragging = false;
     double lastMouseX = 0, lastMouseY = 0;
-    // Transformaciones Globales
-    glm::vec3 m_globalPos = glm::vec3(0.0f, 0.0f, -3.0f);
-    glm::vec3 m_globalScale = glm::vec3(1.0f);
-    glm::quat m_globalRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
     // Cmara FPS
     glm::vec3 m_cameraPos = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 m_cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
     glm::vec3 m_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
     float m_cameraYaw = -90.0f;
     float m_cameraPitch = 0.0f;
-    float m_lastFrame = 0.0f;
+    // Estado del tick anterior y camara interpolada que se usa al dibujar
+    glm::vec3 m_prevCameraPos = glm::vec3(0.0f, 0.0f, 0.0f);
+    float m_prevCameraYaw = -90.0f;
+    float m_prevCameraPitch = 0.0f;
+    glm::vec3 m_viewPos = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 m_viewFront = glm::vec3(0.0f, 0.0f, -1.0f);
+    double m_lastFrame = 0.0;
+    // Simulacion a paso fijo, independiente del costo de render
+    double m_simStep = 1.0 / 120.0;
+    double m_simAccumulator = 0.0;
+    float m_spinSpeed = 45.0f;
+    // Generador de mallas (los archivos van a objetos3D/generado_*.obj)
+    GeneratorParams m_generatorParams;
+    int m_generatorTrisK = 1000;
+    std::thread m_generatorThread;
+    std::atomic<bool> m_generatorRunning{ false };
+    std::atomic<bool> m_generatorDone{ false };
+    std::string m_generatorFile;
+    // Los escribe el hilo del generador antes de publicar m_generatorDone; la UI
+    // no los lee hasta finishGenerator()
+    bool m_generatorOk = false;
+    std::string m_generatorError;
+    GeneratorStats m_generatorResult;
+    // Copia del ultimo resultado para la UI (solo hilo principal)
+    GeneratorStats m_generatorStats;
+    // Grabacion de la camara (una pose por tick) para el benchmark
+    bool m_recordingPath = false;
+    std::vector<CameraKey> m_recordedPath;
+    // Tiempos para perfilado (ms)
+    float m_frameTimeMs = 0.0f;
+    float m_updateTimeMs = 0.0f;
+    float m_buildTimeMs = 0.0f;
+    int m_ticksThisFrame = 0;
+    // Render bajo demanda (bloquea en glfwWaitEventsTimeout si no hay cambios)
+    bool m_onDemandRendering = true;
+    int m_redrawFrames = 3;
+    double m_idleTimeout = 0.5;
+    unsigned long long m_renderedFrames = 0;
     // Opciones de Visualizacin
     bool m_showWireframe = false;
     bool m_showNormals = false;
     bool m_showBoundingBox = false;
+    // Caja orientada por PCA; se calcula al seleccionar y queda en cache
+    bool m_orientedBoundingBox = false;
+    int m_obbSubMesh = -1;
+    OrientedBox m_obb;
     bool m_enableZBuffer = true;
     bool m_enableCulling = true;
     bool m_enableAntiAliasing = true;
@@ -113,44 +347,256 @@ protected:
     GLuint m_vao_bbox = 0, m_vbo_bbox = 0;
     GLuint m_vao_normals = 0, m_vbo_normals = 0;
     int m_normalCount = 0;
+    // Capa de escena: se reutiliza mientras camara, transformaciones, opciones y geometria no cambien
+    bool m_useSceneCache = true;
+    GLuint m_sceneFbo = 0, m_sceneColorTex = 0, m_sceneDepthRbo = 0;
+    int m_sceneFboWidth = 0, m_sceneFboHeight = 0;
+    bool m_sceneCacheValid = false;
+    unsigned long long m_sceneCacheKey = 0;
+    // Si el FBO no esta completo se dibuja directo (lo decide el lado render)
+    bool m_sceneTargetFailed = false;
+    unsigned long long m_geometryVersion = 0;
+    // Tiempos GPU por pasada (se escriben en el lado render)
+    bool m_gpuProfiling = true;
+    GpuProfiler m_gpuProfiler;
+    GpuTimingHistory m_gpuTimings;
+    // Hilo de render: consume snapshots del hilo principal
+    bool m_useRenderThread = false;
+    std::thread m_renderThread;
+    std::atomic<bool> m_renderThreadRunning{ false };
+    std::atomic<bool> m_renderThreadStop{ false };
+    SnapshotExchange m_snapshots;
+    RenderSnapshot m_renderSnapshot;
+    unsigned long long m_snapshotCounter = 0;
+    std::mutex m_commandMutex;
+    // Trabajo GL etiquetado con el snapshot que lo necesita
+    std::vector<std::pair<unsigned long long, std::function<void()>>> m_renderCommands;
+    std::vector<std::pair<unsigned long long, std::function<void()>>> m_executingCommands;
+    // Ultimo frame cuyos comandos ya se ejecutaron (protegido por m_commandMutex)
+    unsigned long long m_retiredFrame = 0;
+    std::condition_variable m_commandsDone;
+    // Temporales de cada frame que consumen los comandos GL (p.ej. lineas de normales)
+    FrameArena m_frameArena;
+    // Asignaciones del heap por frame; tras el calentamiento deberian ser 0
+    static const int kAllocWarmupFrames = 120;
+    FrameAllocStats m_mainAllocs;
+    bool m_checkAllocations = false;
+    // Llamadas a render() (lado render) para saber cuando termino el calentamiento
+    unsigned long long m_renderCalls = 0;
+    // Picking asincrono
+    bool m_pickPending = false;
+    double m_pickX = 0.0, m_pickY = 0.0;
+    std::mutex m_pickMutex;
+    bool m_pickResultReady = false;
+    int m_pickResult = -1;
+    // Primera entrada aun no enviada al render (para medir latencia)
+    double m_pendingInputTime = 0.0;
+    // Estadisticas del lado render (latencia entrada-pantalla y ritmo de frames)
+    std::mutex m_statsMutex;
+    PresentStats m_presentStats;
+    double m_lastPresentTime = 0.0;
     bool m_showTriangles = true; 
     bool m_showVertices = false; 
     float m_pointSize = 3.0f; 
     glm::vec3 m_vertexColor = glm::vec3(1.0f, 1.0f, 1.0f); 
     glm::vec3 m_boundingBoxColor = glm::vec3(1.0f, 0.0f, 1.0f); 
     // Shaders Sources
+    // Sin #version: setupShader antepone la version y DRAW_DATA_TEXELS (kDrawDataTexels)
     const char* vertexShaderSrc = R"glsl(
-        #version 330 core
         layout(location = 0) in vec3 aPos;
         layout(location = 1) in vec3 aNormal;
+        layout(location = 2) in vec2 aTexCoord;
+        // Rango de material del vertice: fila de drawData en la pasada por lotes
+        layout(location = 3) in int aDrawId;
+        // Tangente (xyz) y signo de la bitangente (w); 0 sin mapa de normales
+        layout(location = 4) in vec4 aTangent;
         uniform mat4 model;
+        uniform mat3 normalMatrix;
         uniform mat4 view;
         uniform mat4 projection;
+        uniform vec3 uColor;
+        uniform int textureMode;
+        uniform float textureLayer;
+        uniform vec4 uvTransform;
+        uniform int normalMode;
+        uniform float normalLayer;
+        uniform vec4 normalUvTransform;
+        // Por lotes: matrices, color y textura salen de drawData (DRAW_DATA_TEXELS por rango)
+        uniform bool batched;
+        uniform samplerBuffer drawData;
         out vec3 vNormal;
         out vec3 vFragPos;
+        out vec2 vTexCoord;
+        out vec4 vTangent;
+        out float vViewDepth;
+        flat out vec3 vColor;
+        flat out int vTextureMode;
+        flat out float vTextureLayer;
+        flat out vec4 vUvTransform;
+        flat out int vNormalMode;
+        flat out float vNormalLayer;
+        flat out vec4 vNormalUvTransform;
         void main() {
-            vFragPos = vec3(model * vec4(aPos, 1.0));
-            vNormal = mat3(transpose(inverse(model))) * aNormal; 
-            gl_Position = projection * view * vec4(vFragPos, 1.0);
+            mat4 m = model;
+            mat3 n = normalMatrix;
+            vColor = uColor;
+            vTextureMode = textureMode;
+            vTextureLayer = textureLayer;
+            vUvTransform = uvTransform;
+            vNormalMode = normalMode;
+            vNormalLayer = normalLayer;
+            vNormalUvTransform = normalUvTransform;
+            if (batched) {
+                int base = aDrawId * DRAW_DATA_TEXELS;
+                m = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1),
+                         texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+                n = mat3(texelFetch(drawData, base + 4).xyz, texelFetch(drawData, base + 5).xyz,
+                         texelFetch(drawData, base + 6).xyz);
+                vec4 color = texelFetch(drawData, base + 7);
+                vColor = color.rgb;
+                vTextureMode = int(color.a);
+                vUvTransform = texelFetch(drawData, base + 8);
+                vec4 layers = texelFetch(drawData, base + 9);
+                vTextureLayer = layers.x;
+                vNormalMode = int(layers.y);
+                vNormalLayer = layers.z;
+                vNormalUvTransform = texelFetch(drawData, base + 10);
+            }
+            vFragPos = vec3(m * vec4(aPos, 1.0));
+            vTexCoord = aTexCoord;
+            vNormal = n * aNormal;
+            // La tangente sigue a la superficie: matriz de modelo, no la de normales
+            vTangent = vec4(mat3(m) * aTangent.xyz, aTangent.w);
+            vec4 viewPos = view * vec4(vFragPos, 1.0);
+            vViewDepth = -viewPos.z;
+            gl_Position = projection * viewPos;
         }
     )glsl";
     const char* fragmentShaderSrc = R"glsl(
         #version 330 core
         in vec3 vNormal;
         in vec3 vFragPos;
+        in vec2 vTexCoord;
+        in vec4 vTangent;
+        in float vViewDepth;
+        flat in vec3 vColor;
+        flat in int vTextureMode;
+        flat in float vTextureLayer;
+        flat in vec4 vUvTransform;
+        flat in int vNormalMode;
+        flat in float vNormalLayer;
+        flat in vec4 vNormalUvTransform;
         uniform vec3 uColor;
         uniform bool isPicking;
         uniform bool useFlatColor; 
+        // Modo de cada mapa: 0 sin textura, 1 textura sola, 2 parte de un atlas, 3 capa de un array
+        uniform sampler2D diffuseMap;
+        uniform sampler2DArray diffuseArray;
+        uniform sampler2D normalMap;
+        uniform sampler2DArray normalArray;
+        // Luces puntuales por clusters: lightData (posicion y radio, color), clusterGrid
+        // (primer indice y cantidad por cluster) y clusterLights (indices de luces)
+        uniform int lightCount;
+        uniform samplerBuffer lightData;
+        uniform usamplerBuffer clusterGrid;
+        uniform usamplerBuffer clusterLights;
+        uniform ivec3 clusterDims;
+        uniform vec2 clusterTileScale;
+        uniform vec2 clusterZ;
+        // Luz direccional (hacia la luz) y foco; shadowMask: bit 0 sombra de la direccional, bit 1 del foco
+        uniform vec3 sunDirection;
+        uniform int shadowMask;
+        uniform int pcfRadius;
+        uniform mat4 sunShadowMatrix;
+        uniform mat4 spotShadowMatrix;
+        uniform sampler2DShadow sunShadowMap;
+        uniform sampler2DShadow spotShadowMap;
+        uniform bool spotEnabled;
+        uniform vec3 spotPosition;
+        uniform vec3 spotDirection;
+        uniform vec2 spotCone;
+        uniform vec3 spotColor;
+        // Con SSAO el alfa lleva la fraccion ambiental del color (la que se puede ocluir)
+        uniform bool ambientInAlpha;
         out vec4 FragColor;
+        vec4 sampleMap(int mode, sampler2D map, sampler2DArray maps, float layer, vec4 uvTransform) {
+            if (mode == 1) return texture(map, vTexCoord);
+            if (mode == 2) {
+                // fract repite la textura dentro de su lugar; el gradiente sin fract evita
+                // que el salto de la costura elija el mip mas chico
+                vec2 uv = vTexCoord * uvTransform.xy;
+                return textureGrad(map, uvTransform.zw + fract(vTexCoord) * uvTransform.xy, dFdx(uv), dFdy(uv));
+            }
+            if (mode == 3) return texture(maps, vec3(vTexCoord, layer));
+            return vec4(1.0);
+        }
+        // Como MikkTSpace: bitangente por pixel con los vectores interpolados sin normalizar
+        vec3 surfaceNormal() {
+            vec3 n = vNormal;
+            if (vNormalMode == 0 || dot(vTangent.xyz, vTangent.xyz) == 0.0) return normalize(n);
+            // Solo X e Y (BC5 o RGBA); Z se reconstruye
+            vec2 xy = sampleMap(vNormalMode, normalMap, normalArray, vNormalLayer, vNormalUvTransform).rg * 2.0 - 1.0;
+            vec3 tn = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+            vec3 b = (vTangent.w < 0.0 ? -1.0 : 1.0) * cross(n, vTangent.xyz);
+            return normalize(tn.x * vTangent.xyz + tn.y * b + tn.z * n);
+        }
+        // Solo las luces del cluster del fragmento. Atenuacion 1/(1 + 16 (d/r)^2), relativa
+        // al radio para no depender de la escala del modelo, con ventana que llega a 0 en r
+        vec3 pointLights(vec3 n) {
+            if (lightCount == 0) return vec3(0.0);
+            int z = clamp(int(floor(log(max(vViewDepth, 1e-4)) * clusterZ.x + clusterZ.y)), 0, clusterDims.z - 1);
+            ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterTileScale), ivec2(0), clusterDims.xy - 1);
+            uvec2 cell = texelFetch(clusterGrid, tile.x + clusterDims.x * (tile.y + clusterDims.y * z)).xy;
+            vec3 sum = vec3(0.0);
+            for (uint i = 0u; i < cell.y; i++) {
+                int light = int(texelFetch(clusterLights, int(cell.x + i)).r);
+                vec4 posRadius = texelFetch(lightData, 2 * light);
+                vec3 l = posRadius.xyz - vFragPos;
+                float d2 = dot(l, l);
+                float r2 = posRadius.w * posRadius.w;
+                if (d2 >= r2) continue;
+                float f = d2 / r2;
+                float window = (1.0 - f * f) * (1.0 - f * f);
+                float lambert = max(dot(n, l * inversesqrt(max(d2, 1e-8))), 0.0);
+                sum += texelFetch(lightData, 2 * light + 1).rgb * (lambert * window / (d2 / r2 * 16.0 + 1.0));
+            }
+            return sum;
+        }
+        // Fraccion iluminada: (2 pcfRadius + 1)^2 consultas con comparacion, cada una ya
+        // filtrada 2x2 por el muestreador
+        float shadowFactor(sampler2DShadow map, mat4 lightMatrix) {
+            vec4 p = lightMatrix * vec4(vFragPos, 1.0);
+            vec3 c = p.xyz / p.w * 0.5 + 0.5;
+            if (any(lessThan(c, vec3(0.0))) || any(greaterThan(c, vec3(1.0)))) return 1.0;
+            vec2 texel = 1.0 / vec2(textureSize(map, 0));
+            float sum = 0.0;
+            for (int y = -pcfRadius; y <= pcfRadius; y++) {
+                for (int x = -pcfRadius; x <= pcfRadius; x++) sum += texture(map, vec3(c.xy + vec2(x, y) * texel, c.z));
+            }
+            return sum / float((2 * pcfRadius + 1) * (2 * pcfRadius + 1));
+        }
+        vec3 spotLight(vec3 n) {
+            if (!spotEnabled) return vec3(0.0);
+            vec3 l = normalize(spotPosition - vFragPos);
+            float lit = max(dot(n, l), 0.0) * smoothstep(spotCone.x, spotCone.y, dot(-l, spotDirection));
+            if ((shadowMask & 2) != 0 && lit > 0.0) lit *= shadowFactor(spotShadowMap, spotShadowMatrix);
+            return spotColor * lit;
+        }
         void main() {
             if (isPicking || useFlatColor) {
                 FragColor = vec4(uColor, 1.0);
             } else {
-                vec3 norm = normalize(vNormal);
-                vec3 lightDir = normalize(vec3(0.2, 0.5, 0.8));
-                float diff = max(dot(norm, lightDir), 0.3); 
-                vec3 diffuse = diff * uColor;
-                FragColor = vec4(diffuse, 1.0);
+                vec3 norm = surfaceNormal();
+                vec3 lightDir = normalize(sunDirection);
+                float lit = max(dot(norm, lightDir), 0.0);
+                if ((shadowMask & 1) != 0 && lit > 0.0) lit *= shadowFactor(sunShadowMap, sunShadowMatrix);
+                float diff = max(lit, 0.3);
+                vec3 albedo = vColor * sampleMap(vTextureMode, diffuseMap, diffuseArray, vTextureLayer, vUvTransform).rgb;
+                vec3 extra = pointLights(norm) + spotLight(norm);
+                vec3 diffuse = diff * albedo + extra * albedo;
+                // El piso de 0.3 hace de luz ambiental: solo lo que agrega sobre lit
+                float ambient = max(0.3 - lit, 0.0) / max(diff + dot(extra, vec3(1.0 / 3.0)), 1e-4);
+                FragColor = vec4(diffuse, ambientInAlpha ? ambient : 1.0);
             }
         }
     )glsl";
@@ -0,0 +1,333 @@
+#include "AllocTracker.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<unsigned long long> g_allocations{ 0 };
+std::atomic<unsigned long long> g_frees{ 0 };
+std::atomic<unsigned long long> g_bytes{ 0 };
+std::atomic<unsigned long long> g_arenaAllocations{ 0 };
+std::atomic<unsigned long long> g_violations{ 0 };
+thread_local AllocCounters t_counters;
+// Zona sin asignaciones activa en este hilo (NoAllocScope)
+thread_local const char* t_noAllocZone = nullptr;
+thread_local size_t t_firstViolationBytes = 0;
+
+const size_t kDefaultAlignment = alignof(std::max_align_t);
+
+void* heapAlloc(size_t size, size_t alignment) {
+    if (size == 0) size = 1;
+    void* p;
+    if (alignment <= kDefaultAlignment) {
+        p = std::malloc(size);
+    }
+    else {
+#ifdef _MSC_VER
+        p = _aligned_malloc(size, alignment);
+#else
+        p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (p) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+        t_counters.allocations++;
+        t_counters.bytes += size;
+        if (t_noAllocZone) {
+            g_violations.fetch_add(1, std::memory_order_relaxed);
+            if (t_firstViolationBytes == 0) t_firstViolationBytes = size;
+            assert(!"asignacion en el heap dentro de una zona sin asignaciones (NoAllocScope)");
+        }
+    }
+    return p;
+}
+
+void heapFree(void* p, size_t alignment) {
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    t_counters.frees++;
+    if (alignment <= kDefaultAlignment) {
+        std::free(p);
+    }
+    else {
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void* trackedNew(size_t size, size_t alignment) {
+    return heapAlloc(size, alignment);
+}
+
+void trackedDelete(void* p, size_t alignment) {
+    if (p) heapFree(p, alignment);
+}
+
+void* throwingNew(size_t size, size_t alignment) {
+    if (void* p = trackedNew(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+AllocCounters processAllocCounters() {
+    AllocCounters c;
+    c.allocations = g_allocations.load(std::memory_order_relaxed);
+    c.frees = g_frees.load(std::memory_order_relaxed);
+    c.bytes = g_bytes.load(std::memory_order_relaxed);
+    c.arenaAllocations = g_arenaAllocations.load(std::memory_order_relaxed);
+    return c;
+}
+
+AllocCounters threadAllocCounters() {
+    return t_counters;
+}
+
+MemoryUsage processMemoryUsage() {
+    MemoryUsage usage;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        usage.rssBytes = pmc.WorkingSetSize;
+        usage.peakRssBytes = pmc.PeakWorkingSetSize;
+    }
+#else
+    // statm: tamano total y residente, en paginas (se lee sin asignar memoria)
+    int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd >= 0) {
+        char buf[128];
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            char* rest = nullptr;
+            std::strtoull(buf, &rest, 10);
+            usage.rssBytes = (size_t)std::strtoull(rest, nullptr, 10) * (size_t)sysconf(_SC_PAGESIZE);
+        }
+    }
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) usage.peakRssBytes = (size_t)ru.ru_maxrss * 1024;
+#endif
+    return usage;
+}
+
+void FrameAllocStats::add(const AllocCounters& before, const AllocCounters& after, bool warm) {
+    last = after.allocations - before.allocations;
+    lastBytes = after.bytes - before.bytes;
+    frames++;
+    if (!warm) return;
+    if (last > max) max = last;
+    if (last > 0) framesWithAllocations++;
+}
+
+NoAllocScope::NoAllocScope(const char* zone, bool enabled)
+    : m_enabled(enabled), m_previous(t_noAllocZone), m_allocationsBefore(0) {
+    if (!enabled) return;
+    m_allocationsBefore = t_counters.allocations;
+    t_firstViolationBytes = 0;
+    t_noAllocZone = zone;
+}
+
+NoAllocScope::~NoAllocScope() {
+    if (!m_enabled) return;
+    const char* zone = t_noAllocZone;
+    // Sin zona activa mientras se informa: fprintf no debe contar como violacion
+    t_noAllocZone = m_previous;
+    unsigned long long count = t_counters.allocations - m_allocationsBefore;
+    if (count > 0) {
+        fprintf(stderr, "%s: %llu asignaciones en el heap (la primera de %zu bytes)\n", zone, count, t_firstViolationBytes);
+    }
+}
+
+unsigned long long allocViolations() {
+    return g_violations.load(std::memory_order_relaxed);
+}
+
+LoadArena& LoadArena::instance() {
+    // Nunca se destruye: puede haber delete durante la destruccion de estaticos
+    static LoadArena* arena = new LoadArena();
+    return *arena;
+}
+
+size_t LoadArena::used() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used;
+}
+
+size_t LoadArena::peakUsed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peakUsed;
+}
+
+size_t LoadArena::capacity() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (int i = 0; i < m_chunkCount; i++) total += m_end[i] - m_begin[i];
+    return total;
+}
+
+size_t LoadArena::live() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_live;
+}
+
+void LoadArena::resetPeak() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_peakUsed = m_used;
+}
+
+void* LoadArena::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    alignment = alignment < kDefaultAlignment ? kDefaultAlignment : alignment;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (;;) {
+        if (m_current < m_chunkCount) {
+            char* begin = m_begin[m_current];
+            size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+            if (offset + bytes <= (size_t)(m_end[m_current] - begin)) {
+                m_used += offset + bytes - m_offset;
+                if (m_used > m_peakUsed) m_peakUsed = m_used;
+                m_offset = offset + bytes;
+                m_live++;
+                g_arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+                t_counters.arenaAllocations++;
+                return begin + offset;
+            }
+            // El resto del bloque se pierde hasta la proxima vuelta al inicio
+            m_used += (size_t)(m_end[m_current] - begin) - m_offset;
+            m_offset = 0;
+            if (m_current + 1 < m_chunkCount) {
+                m_current++;
+                continue;
+            }
+        }
+        if (m_chunkCount == kMaxChunks) throw std::bad_alloc();
+        // Bloque nuevo del doble que el anterior (o lo que pida la asignacion)
+        size_t size = m_chunkCount == 0 ? kFirstChunk : (size_t)(m_end[m_chunkCount - 1] - m_begin[m_chunkCount - 1]) * 2;
+        while (size < bytes + alignment) size *= 2;
+        char* chunk = static_cast<char*>(heapAlloc(size, kDefaultAlignment));
+        if (!chunk) throw std::bad_alloc();
+        m_begin[m_chunkCount] = chunk;
+        m_end[m_chunkCount] = chunk + size;
+        m_current = m_chunkCount++;
+        m_offset = 0;
+    }
+}
+
+void LoadArena::do_deallocate(void*, size_t, size_t) {
+    // La memoria se recupera en rewind(), cuando no queda nada vivo
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live--;
+}
+
+void LoadArena::rewind() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_live > 0) return;
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+    // Quedarse con los primeros bloques hasta kRetained y devolver el resto
+    size_t kept = 0;
+    int keep = 0;
+    while (keep < m_chunkCount && kept + (size_t)(m_end[keep] - m_begin[keep]) <= kRetained) {
+        kept += (size_t)(m_end[keep] - m_begin[keep]);
+        keep++;
+    }
+    for (int i = keep; i < m_chunkCount; i++) {
+        heapFree(m_begin[i], kDefaultAlignment);
+        m_begin[i] = nullptr;
+        m_end[i] = nullptr;
+    }
+    m_chunkCount = keep;
+}
+
+FrameArena::~FrameArena() {
+    for (Slot& s : m_slots) {
+        for (int i = 0; i < s.oldCount; i++) heapFree(s.old[i], kDefaultAlignment);
+        if (s.data) heapFree(s.data, kDefaultAlignment);
+    }
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Slot& s : m_slots) total += s.size;
+    return total;
+}
+
+void FrameArena::beginFrame(unsigned long long frameId) {
+    if (frameId == m_frame) return;
+    m_frame = frameId;
+    Slot& s = m_slots[frameId % kSlots];
+    // El bloque actual ya tiene el tamano del frame mas grande: los viejos sobran
+    for (int i = 0; i < s.oldCount; i++) heapFree(s.old[i], kDefaultAlignment);
+    s.oldCount = 0;
+    s.offset = 0;
+    s.frame = frameId;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    Slot& s = m_slots[m_frame % kSlots];
+    alignment = alignment < kDefaultAlignment ? kDefaultAlignment : alignment;
+    size_t offset = (s.offset + alignment - 1) & ~(alignment - 1);
+    if (!s.data || offset + bytes > s.size) {
+        // Bloque nuevo que entre lo de este frame; lo ya entregado sigue en el viejo
+        size_t size = std::max(s.size * 2, kFirstBlock);
+        while (size < bytes + alignment) size *= 2;
+        char* block = static_cast<char*>(heapAlloc(size, kDefaultAlignment));
+        if (!block) throw std::bad_alloc();
+        m_heapBlocks++;
+        if (s.data) {
+            if (s.oldCount == kMaxOld) {
+                // No deberia pasar (cada bloque duplica al anterior)
+                heapFree(block, kDefaultAlignment);
+                throw std::bad_alloc();
+            }
+            s.old[s.oldCount++] = s.data;
+        }
+        s.data = block;
+        s.size = size;
+        offset = 0;
+    }
+    s.offset = offset + bytes;
+    if (s.offset > m_peakUsed) m_peakUsed = s.offset;
+    return s.data + offset;
+}
+
+// Reemplazos globales: todo new/delete del ejecutable pasa por aca
+void* operator new(size_t size) { return throwingNew(size, kDefaultAlignment); }
+void* operator new[](size_t size) { return throwingNew(size, kDefaultAlignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedNew(size, kDefaultAlignment); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedNew(size, kDefaultAlignment); }
+void* operator new(size_t size, std::align_val_t a) { return throwingNew(size, (size_t)a); }
+void* operator new[](size_t size, std::align_val_t a) { return throwingNew(size, (size_t)a); }
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return trackedNew(size, (size_t)a); }
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return trackedNew(size, (size_t)a); }
+void operator delete(void* p) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete[](void* p) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete(void* p, size_t) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete[](void* p, size_t) noexcept { trackedDelete(p, kDefaultAlignment); }
+void operator delete(void* p, std::align_val_t a) noexcept { trackedDelete(p, (size_t)a); }
+void operator delete[](void* p, std::align_val_t a) noexcept { trackedDelete(p, (size_t)a); }
+void operator delete(void* p, size_t, std::align_val_t a) noexcept { trackedDelete(p, (size_t)a); }
+void operator delete[](void* p, size_t, std::align_val_t a) noexcept { trackedDelete(p, (size_t)a); }
+void operator delete(void* p, std::align_val_t a, const std::nothrow_t&) noexcept { trackedDelete(p, (size_t)a); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept { trackedDelete(p, (size_t)a); }
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+// Instrumentacion de operator new/delete (reemplazados en AllocTracker.cpp, solo
+// cuentan), arena de carga y arena por frame. Enlazar este archivo reemplaza el new/delete global
+// del ejecutable.
+
+struct AllocCounters {
+    // Asignaciones que llegaron al heap (las de la arena de carga se cuentan aparte)
+    unsigned long long allocations = 0;
+    unsigned long long frees = 0;
+    unsigned long long bytes = 0;
+    unsigned long long arenaAllocations = 0;
+};
+
+// Totales del proceso y del hilo que llama (acumulados desde el inicio)
+AllocCounters processAllocCounters();
+AllocCounters threadAllocCounters();
+
+struct MemoryUsage {
+    size_t rssBytes = 0;
+    // Maximo del proceso desde el inicio
+    size_t peakRssBytes = 0;
+};
+MemoryUsage processMemoryUsage();
+
+// Asignaciones por frame de un hilo (diferencia de threadAllocCounters entre el
+// principio y el fin del frame). Los maximos solo cuentan frames tras el calentamiento.
+struct FrameAllocStats {
+    unsigned long long last = 0;
+    unsigned long long lastBytes = 0;
+    unsigned long long max = 0;
+    // Frames calientes con al menos una asignacion
+    unsigned long long framesWithAllocations = 0;
+    unsigned long long frames = 0;
+    void add(const AllocCounters& before, const AllocCounters& after, bool warm);
+};
+
+// Zona sin asignaciones: mientras vive un NoAllocScope activo, cada asignacion del
+// heap en ese hilo es una violacion. Se cuenta, el destructor informa por stderr y en
+// Debug salta un assert en la asignacion misma (la pila apunta al culpable).
+class NoAllocScope {
+public:
+    NoAllocScope(const char* zone, bool enabled);
+    ~NoAllocScope();
+    NoAllocScope(const NoAllocScope&) = delete;
+    NoAllocScope& operator=(const NoAllocScope&) = delete;
+private:
+    bool m_enabled;
+    const char* m_previous;
+    unsigned long long m_allocationsBefore;
+};
+// Violaciones acumuladas de todos los hilos
+unsigned long long allocViolations();
+
+// Arena monotona para los temporales de una carga (caras, normales, tangentes,
+// cajas). No intercepta new: se pasa como std::pmr::memory_resource a los
+// contenedores que la usan. Los bloques se reservan una vez y se reutilizan en cada
+// carga; quien termino con la arena llama a rewind() y, si ya no queda nada vivo,
+// vuelve al inicio. Asignar y liberar se puede desde cualquier hilo (con un mutex:
+// son pocas asignaciones grandes, no una por cara).
+class LoadArena : public std::pmr::memory_resource {
+public:
+    static LoadArena& instance();
+    // Vuelve al inicio si no queda ninguna asignacion viva (si no, no hace nada) y
+    // devuelve los bloques que pasan de kRetained
+    void rewind();
+    size_t used() const;
+    size_t peakUsed() const;
+    size_t capacity() const;
+    size_t live() const;
+    void resetPeak();
+
+private:
+    static const int kMaxChunks = 32;
+    static const size_t kFirstChunk = 1 << 20;
+    // Lo que queda reservado entre cargas; el resto se devuelve al rebobinar
+    static const size_t kRetained = 64u << 20;
+    LoadArena() {}
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    mutable std::mutex m_mutex;
+    char* m_begin[kMaxChunks] = {};
+    char* m_end[kMaxChunks] = {};
+    int m_chunkCount = 0;
+    int m_current = 0;
+    size_t m_offset = 0;
+    size_t m_used = 0;
+    size_t m_peakUsed = 0;
+    size_t m_live = 0;
+};
+
+// Memoria lineal para los temporales de un frame que arma el hilo principal y consume
+// el render (p.ej. datos a subir a un buffer). Un bloque por frame en un anillo de
+// kSlots: beginFrame() rebobina el bloque que uso el frame kSlots atras, y quien llama
+// debe asegurar que el render ya lo consumio (slotFrame()). Si un frame no entra en su
+// bloque se reserva uno del doble; el viejo se libera al volver a ese frame. Pasado
+// el calentamiento no toca el heap. Solo se usa desde un hilo; liberar no hace nada.
+class FrameArena : public std::pmr::memory_resource {
+public:
+    static const int kSlots = 3;
+    FrameArena() {}
+    ~FrameArena();
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    // Abre el bloque de frameId; si ya es el frame actual no hace nada
+    void beginFrame(unsigned long long frameId);
+    unsigned long long frame() const { return m_frame; }
+    // Ultimo frame que escribio en el bloque que abriria beginFrame(frameId)
+    unsigned long long slotFrame(unsigned long long frameId) const { return m_slots[frameId % kSlots].frame; }
+    size_t used() const { return m_slots[m_frame % kSlots].offset; }
+    size_t peakUsed() const { return m_peakUsed; }
+    size_t capacity() const;
+    // Bloques pedidos al heap desde el inicio (deja de crecer tras el calentamiento)
+    unsigned long long heapBlocks() const { return m_heapBlocks; }
+
+private:
+    static const size_t kFirstBlock = 64 * 1024;
+    static const int kMaxOld = 16;
+    struct Slot {
+        char* data = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+        unsigned long long frame = 0;
+        // Bloques reemplazados en este frame: siguen en uso hasta rebobinar
+        char* old[kMaxOld] = {};
+        int oldCount = 0;
+    };
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    Slot m_slots[kSlots];
+    unsigned long long m_frame = 0;
+    size_t m_peakUsed = 0;
+    unsigned long long m_heapBlocks = 0;
+};
@@ -0,0 +1,103 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+FrameStats computeFrameStats(std::vector<float> samples) {
+    FrameStats s;
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    // Percentil por rango mas cercano
+    auto pct = [&samples](float p) {
+        size_t rank = (size_t)std::ceil(p / 100.0f * samples.size());
+        return samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1];
+    };
+    double sum = 0.0;
+    for (float v : samples) sum += v;
+    s.mean = (float)(sum / samples.size());
+    s.p50 = pct(50.0f);
+    s.p95 = pct(95.0f);
+    s.p99 = pct(99.0f);
+    s.min = samples.front();
+    s.max = samples.back();
+    return s;
+}
+
+static CameraKey lookFrom(const glm::vec3& position, const glm::vec3& at) {
+    CameraKey k;
+    k.position = position;
+    glm::vec3 f = glm::normalize(at - position);
+    k.yaw = glm::degrees(std::atan2(f.z, f.x));
+    k.pitch = glm::degrees(std::asin(glm::clamp(f.y, -1.0f, 1.0f)));
+    return k;
+}
+
+static bool loadCameraPath(const std::string& file, std::vector<CameraKey>& keys) {
+    std::ifstream in(file);
+    if (!in.is_open()) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        CameraKey k;
+        if (ss >> k.position.x >> k.position.y >> k.position.z >> k.yaw >> k.pitch) keys.push_back(k);
+    }
+    return !keys.empty();
+}
+
+bool buildCameraPath(const std::string& path, int frames, const glm::vec3& target, std::vector<CameraKey>& out) {
+    out.clear();
+    const float twoPi = 6.28318530718f;
+    if (path == "orbita" || path == "dolly" || path == "vuelo") {
+        for (int i = 0; i < frames; i++) {
+            float t = (frames > 1) ? (float)i / (frames - 1) : 0.0f;
+            if (path == "orbita") {
+                // Una vuelta completa, ligeramente desde arriba
+                float a = twoPi * t;
+                glm::vec3 offset(4.5f * std::cos(a) * std::cos(0.25f), 4.5f * std::sin(0.25f), 4.5f * std::sin(a) * std::cos(0.25f));
+                out.push_back(lookFrom(target + offset, target));
+            }
+            else if (path == "dolly") {
+                // Acercarse de 8 a 1.5 unidades y volver
+                float d = 8.0f - 6.5f * (1.0f - std::abs(2.0f * t - 1.0f));
+                out.push_back(lookFrom(target + glm::vec3(0.0f, 0.0f, d), target));
+            }
+            else {
+                // Lazo que roza el modelo mirando en la direccion de avance
+                auto at = [&](float u) {
+                    float a = twoPi * u;
+                    return target + glm::vec3(2.2f * std::sin(a), 0.6f * std::sin(2.0f * a), 2.2f * std::cos(a) * std::sin(a) + 1.5f * std::cos(a));
+                };
+                glm::vec3 p = at(t);
+                out.push_back(lookFrom(p, at(t + 0.01f)));
+            }
+        }
+        return true;
+    }
+    std::vector<CameraKey> keys;
+    if (!loadCameraPath(path, keys)) return false;
+    // Remuestrear la grabacion a 'frames' poses
+    for (int i = 0; i < frames; i++) {
+        float x = (frames > 1) ? (float)i * (keys.size() - 1) / (frames - 1) : 0.0f;
+        size_t a = (size_t)x;
+        size_t b = std::min(a + 1, keys.size() - 1);
+        float f = x - a;
+        CameraKey k;
+        k.position = glm::mix(keys[a].position, keys[b].position, f);
+        k.yaw = glm::mix(keys[a].yaw, keys[b].yaw, f);
+        k.pitch = glm::mix(keys[a].pitch, keys[b].pitch, f);
+        out.push_back(k);
+    }
+    return true;
+}
+
+bool saveCameraPath(const std::string& file, const std::vector<CameraKey>& keys) {
+    std::ofstream out(file);
+    if (!out.is_open()) return false;
+    out << "# x y z yaw pitch\n";
+    for (const auto& k : keys) {
+        out << k.position.x << " " << k.position.y << " " << k.position.z << " " << k.yaw << " " << k.pitch << "\n";
+    }
+    return true;
+}
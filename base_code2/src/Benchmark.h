@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+// Pose de camara (mismos angulos que la camara FPS del visor)
+struct CameraKey {
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = -90.0f;
+    float pitch = 0.0f;
+};
+
+struct BenchmarkJob {
+    bool enabled = false;
+    // "orbita", "dolly", "vuelo" o la ruta de un archivo grabado
+    std::string path = "orbita";
+    int frames = 300;
+    std::string jsonPath = "benchmark.json";
+    // 0 = sin presupuesto; si el p95 de algun caso lo supera, sale con error
+    float budgetMs = 0.0f;
+};
+
+// Estadisticas de una serie de tiempos en ms
+struct FrameStats {
+    float mean = 0.0f, p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, min = 0.0f, max = 0.0f;
+};
+FrameStats computeFrameStats(std::vector<float> samples);
+
+// Genera N poses a lo largo del camino alrededor de 'target'.
+// Devuelve false si el archivo grabado no existe o esta vacio.
+bool buildCameraPath(const std::string& path, int frames, const glm::vec3& target, std::vector<CameraKey>& out);
+// Formato del archivo grabado: una pose por linea "x y z yaw pitch"
+bool saveCameraPath(const std::string& file, const std::vector<CameraKey>& keys);
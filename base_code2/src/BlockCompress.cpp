@@ -0,0 +1,158 @@
+#include "BlockCompress.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Un canal de 16 valores en 8 bytes: dos extremos y un indice de 3 bits por texel (BC4)
+void encodeChannelBlock(const unsigned char values[16], unsigned char* out) {
+    unsigned char hi = values[0], lo = values[0];
+    for (int i = 1; i < 16; i++) {
+        hi = std::max(hi, values[i]);
+        lo = std::min(lo, values[i]);
+    }
+    out[0] = hi;
+    out[1] = lo;
+    uint64_t bits = 0;
+    if (hi != lo) {
+        // Con a0 > a1: 0 = a0, 1 = a1 y 2..7 interpolan de a0 hacia a1
+        int palette[8] = { hi, lo };
+        for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * hi + (i - 1) * lo + 3) / 7;
+        for (int t = 0; t < 16; t++) {
+            int best = 0, bestError = 256;
+            for (int i = 0; i < 8; i++) {
+                int error = std::abs(palette[i] - values[t]);
+                if (error < bestError) { bestError = error; best = i; }
+            }
+            bits |= (uint64_t)best << (3 * t);
+        }
+    }
+    for (int b = 0; b < 6; b++) out[2 + b] = (unsigned char)(bits >> (8 * b));
+}
+
+uint16_t pack565(const float c[3]) {
+    int r = (int)std::lround(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t c, int out[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Color de 16 texeles en 8 bytes (BC1, siempre en modo de 4 colores): extremos sobre
+// el eje principal del bloque, recortados 1/16 hacia adentro, y el color mas cercano
+void encodeColorBlock(const unsigned char texels[16][4], unsigned char* out) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; t++)
+        for (int k = 0; k < 3; k++) mean[k] += texels[t][k];
+    for (int k = 0; k < 3; k++) mean[k] /= 16.0f;
+    // Covarianza: xx, xy, xz, yy, yz, zz
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; t++) {
+        float r = texels[t][0] - mean[0], g = texels[t][1] - mean[1], b = texels[t][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    // Eje principal por iteracion de potencia, desde la diagonal de luminancia
+    float axis[3] = { 0.577f, 0.577f, 0.577f };
+    for (int it = 0; it < 8; it++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float len = std::sqrt(x * x + y * y + z * z);
+        if (len < 1e-6f) break;
+        axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+    }
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int t = 0; t < 16; t++) {
+        float p = (texels[t][0] - mean[0]) * axis[0] + (texels[t][1] - mean[1]) * axis[1] + (texels[t][2] - mean[2]) * axis[2];
+        tMin = std::min(tMin, p);
+        tMax = std::max(tMax, p);
+    }
+    float inset = (tMax - tMin) / 16.0f;
+    tMin += inset;
+    tMax -= inset;
+    float e0[3], e1[3];
+    for (int k = 0; k < 3; k++) {
+        e0[k] = mean[k] + axis[k] * tMax;
+        e1[k] = mean[k] + axis[k] * tMin;
+    }
+    uint16_t c0 = pack565(e0), c1 = pack565(e1);
+    // c0 > c1 elige el modo de 4 colores
+    if (c0 < c1) std::swap(c0, c1);
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int k = 0; k < 3; k++) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k] + 1) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k] + 1) / 3;
+        }
+        for (int t = 0; t < 16; t++) {
+            int best = 0, bestError = 1 << 30;
+            for (int i = 0; i < 4; i++) {
+                int dr = palette[i][0] - texels[t][0], dg = palette[i][1] - texels[t][1], db = palette[i][2] - texels[t][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) { bestError = error; best = i; }
+            }
+            indices |= (uint32_t)best << (2 * t);
+        }
+    }
+    out[0] = (unsigned char)(c0 & 0xFF);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF);
+    out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; b++) out[4 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+} // namespace
+
+size_t blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out) {
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    unsigned char texels[16][4];
+    unsigned char channel[16];
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            for (int t = 0; t < 16; t++) {
+                int x = std::min(bx * 4 + (t & 3), width - 1);
+                int y = std::min(by * 4 + (t >> 2), height - 1);
+                memcpy(texels[t], rgba + ((size_t)y * width + x) * 4, 4);
+            }
+            switch (format) {
+            case BlockFormat::BC1:
+                encodeColorBlock(texels, out);
+                out += 8;
+                break;
+            case BlockFormat::BC3:
+                for (int t = 0; t < 16; t++) channel[t] = texels[t][3];
+                encodeChannelBlock(channel, out);
+                encodeColorBlock(texels, out + 8);
+                out += 16;
+                break;
+            case BlockFormat::BC5:
+                for (int c = 0; c < 2; c++) {
+                    for (int t = 0; t < 16; t++) channel[t] = texels[t][c];
+                    encodeChannelBlock(channel, out + 8 * c);
+                }
+                out += 16;
+                break;
+            }
+        }
+    }
+}
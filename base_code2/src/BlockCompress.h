@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Compresion por bloques de 4x4 texeles (formatos BCn de las GPU), sin GL.
+// BC1: color RGB, 8 bytes por bloque (6:1 frente a RGB8, 8:1 frente a RGBA8)
+// BC3: BC1 para el color mas un bloque de alfa de 8 bytes (4:1 frente a RGBA8)
+// BC5: dos canales (R y G) independientes, para mapas de normales (4:1)
+enum class BlockFormat {
+    BC1,
+    BC3,
+    BC5
+};
+
+size_t blockBytes(BlockFormat format);
+// Bytes de una imagen w x h (los bordes se completan a bloques de 4)
+size_t compressedSize(BlockFormat format, int width, int height);
+// Comprime rgba (w x h, RGBA8, filas contiguas) en out (compressedSize bytes).
+// Los bloques del borde repiten el ultimo texel
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out);
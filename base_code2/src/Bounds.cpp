@@ -0,0 +1,274 @@
+#include "Bounds.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BOUNDS_SSE 1
+#else
+#define BOUNDS_SSE 0
+#endif
+
+namespace {
+
+// Vertices por trabajo del pool
+const size_t kChunk = 1 << 16;
+// Minimo y maximo de un arreglo de floats: 8 por iteracion en dos acumuladores SSE
+void axisRange(const float* a, size_t n, float& outMin, float& outMax) {
+    size_t i = 0;
+    float lo = outMin, hi = outMax;
+#if BOUNDS_SSE
+    if (n >= 8) {
+        __m128 min0 = _mm_set1_ps(FLT_MAX), min1 = min0;
+        __m128 max0 = _mm_set1_ps(-FLT_MAX), max1 = max0;
+        for (; i + 8 <= n; i += 8) {
+            __m128 x = _mm_loadu_ps(a + i);
+            __m128 y = _mm_loadu_ps(a + i + 4);
+            min0 = _mm_min_ps(min0, x);
+            max0 = _mm_max_ps(max0, x);
+            min1 = _mm_min_ps(min1, y);
+            max1 = _mm_max_ps(max1, y);
+        }
+        alignas(16) float l[4], h[4];
+        _mm_store_ps(l, _mm_min_ps(min0, min1));
+        _mm_store_ps(h, _mm_max_ps(max0, max1));
+        lo = std::min({ lo, l[0], l[1], l[2], l[3] });
+        hi = std::max({ hi, h[0], h[1], h[2], h[3] });
+    }
+#endif
+    for (; i < n; i++) {
+        lo = std::min(lo, a[i]);
+        hi = std::max(hi, a[i]);
+    }
+    outMin = lo;
+    outMax = hi;
+}
+
+void positionRange(const VertexStreams& v, size_t begin, size_t end, glm::vec3& outMin, glm::vec3& outMax) {
+    axisRange(v.px.data() + begin, end - begin, outMin.x, outMax.x);
+    axisRange(v.py.data() + begin, end - begin, outMin.y, outMax.y);
+    axisRange(v.pz.data() + begin, end - begin, outMin.z, outMax.z);
+}
+
+// Reparte [0, count) en trozos de kChunk, uno por trabajo, con un resultado parcial por trozo
+template <typename T, typename Fn>
+std::vector<T> chunkedPartials(size_t count, const T& init, Fn&& fn) {
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(workerCount(), count / kChunk));
+    std::vector<T> partials(chunks, init);
+    ThreadPool::instance().run(chunks, [&](size_t c) {
+        fn(count * c / chunks, count * (c + 1) / chunks, partials[c]);
+    });
+    return partials;
+}
+
+// Autovectores de una matriz simetrica 3x3 (Jacobi ciclico). Quedan en las columnas de vecs
+void symmetricEigen(double a[3][3], double vecs[3][3]) {
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) vecs[i][j] = i == j ? 1.0 : 0.0;
+    for (int sweep = 0; sweep < 32; sweep++) {
+        double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (off < 1e-30) break;
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (std::abs(a[p][q]) < 1e-300) continue;
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double kp = vecs[k][p], kq = vecs[k][q];
+                    vecs[k][p] = c * kp - s * kq;
+                    vecs[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+}
+
+struct Range {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+};
+
+struct Moments {
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    // xx, xy, xz, yy, yz, zz respecto de la media
+    double cov[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    Range range;
+};
+
+} // namespace
+
+glm::mat4 OrientedBox::boxTransform() const {
+    glm::mat4 m(1.0f);
+    m[0] = glm::vec4(axes[0] * (2.0f * halfExtents.x), 0.0f);
+    m[1] = glm::vec4(axes[1] * (2.0f * halfExtents.y), 0.0f);
+    m[2] = glm::vec4(axes[2] * (2.0f * halfExtents.z), 0.0f);
+    m[3] = glm::vec4(center, 1.0f);
+    return m;
+}
+
+void computeBounds(const VertexStreams& vertices, std::vector<SubMesh>& subMeshes, Model& model,
+    std::pmr::memory_resource* scratch) {
+    PROFILE_FUNCTION();
+    if (model.vertexCount == 0) return;
+    // Trabajos: cada sub-mallado partido en trozos de kChunk vertices
+    struct Piece {
+        unsigned int subMesh;
+        size_t begin, end;
+        Range range;
+    };
+    std::pmr::vector<Piece> pieces(scratch);
+    size_t pieceCount = 0;
+    for (unsigned int s = model.firstSubMesh; s < model.firstSubMesh + model.subMeshCount; s++) {
+        pieceCount += (subMeshes[s].indexCount + kChunk - 1) / kChunk;
+    }
+    pieces.reserve(pieceCount);
+    for (unsigned int s = model.firstSubMesh; s < model.firstSubMesh + model.subMeshCount; s++) {
+        const SubMesh& sub = subMeshes[s];
+        for (size_t b = sub.firstVertex; b < (size_t)sub.firstVertex + sub.indexCount; b += kChunk) {
+            pieces.push_back(Piece{ s, b, std::min<size_t>(b + kChunk, (size_t)sub.firstVertex + sub.indexCount), Range() });
+        }
+    }
+    ThreadPool::instance().run(pieces.size(), [&](size_t i) {
+        Piece& p = pieces[i];
+        positionRange(vertices, p.begin, p.end, p.range.min, p.range.max);
+    });
+    // Reduccion: trozos -> sub-mallado -> modelo
+    for (unsigned int s = model.firstSubMesh; s < model.firstSubMesh + model.subMeshCount; s++) {
+        subMeshes[s].min = glm::vec3(FLT_MAX);
+        subMeshes[s].max = glm::vec3(-FLT_MAX);
+    }
+    Range total;
+    for (const Piece& p : pieces) {
+        SubMesh& sub = subMeshes[p.subMesh];
+        sub.min = glm::min(sub.min, p.range.min);
+        sub.max = glm::max(sub.max, p.range.max);
+        total.min = glm::min(total.min, p.range.min);
+        total.max = glm::max(total.max, p.range.max);
+    }
+    if (pieces.empty()) return;
+    model.center = (total.min + total.max) * 0.5f;
+    glm::vec3 size = total.max - total.min;
+    // Escala para cubo unitario
+    float maxDim = std::max({ size.x, size.y, size.z });
+    model.scaleFactor = (maxDim > 0) ? (2.0f / maxDim) : 1.0f;
+    model.boundingBoxDiagonal = glm::length(size);
+    // Si boundingBoxDiagonal es 0 (punto), evitar errores
+    if (model.boundingBoxDiagonal < 0.0001f) model.boundingBoxDiagonal = 1.0f;
+}
+
+OrientedBox computeOrientedBox(const VertexStreams& vertices, size_t first, size_t count) {
+    PROFILE_FUNCTION();
+    OrientedBox box;
+    if (count == 0) return box;
+    const float* px = vertices.px.data() + first;
+    const float* py = vertices.py.data() + first;
+    const float* pz = vertices.pz.data() + first;
+
+    // 1) Media y caja alineada
+    std::vector<Moments> partials = chunkedPartials(count, Moments(), [&](size_t begin, size_t end, Moments& m) {
+        for (size_t i = begin; i < end; i++) {
+            m.sum[0] += px[i];
+            m.sum[1] += py[i];
+            m.sum[2] += pz[i];
+        }
+        positionRange(vertices, first + begin, first + end, m.range.min, m.range.max);
+    });
+    double mean[3] = { 0.0, 0.0, 0.0 };
+    Range aabb;
+    for (const Moments& m : partials) {
+        for (int k = 0; k < 3; k++) mean[k] += m.sum[k];
+        aabb.min = glm::min(aabb.min, m.range.min);
+        aabb.max = glm::max(aabb.max, m.range.max);
+    }
+    for (int k = 0; k < 3; k++) mean[k] /= (double)count;
+
+    // 2) Covarianza respecto de la media
+    partials = chunkedPartials(count, Moments(), [&](size_t begin, size_t end, Moments& m) {
+        for (size_t i = begin; i < end; i++) {
+            double x = px[i] - mean[0], y = py[i] - mean[1], z = pz[i] - mean[2];
+            m.cov[0] += x * x; m.cov[1] += x * y; m.cov[2] += x * z;
+            m.cov[3] += y * y; m.cov[4] += y * z; m.cov[5] += z * z;
+        }
+    });
+    double cov[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for (const Moments& m : partials)
+        for (int k = 0; k < 6; k++) cov[k] += m.cov[k];
+    double a[3][3] = {
+        { cov[0], cov[1], cov[2] },
+        { cov[1], cov[3], cov[4] },
+        { cov[2], cov[4], cov[5] }
+    };
+    double e[3][3];
+    symmetricEigen(a, e);
+    glm::mat3 axes;
+    for (int c = 0; c < 3; c++) axes[c] = glm::normalize(glm::vec3((float)e[0][c], (float)e[1][c], (float)e[2][c]));
+    // Base de mano derecha (la matriz de la caja no debe reflejar)
+    axes[2] = glm::normalize(glm::cross(axes[0], axes[1]));
+
+    // 3) Extension sobre los ejes de PCA
+    const glm::mat3 toLocal = glm::transpose(axes);
+    std::vector<Range> extents = chunkedPartials(count, Range(), [&](size_t begin, size_t end, Range& r) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 p = toLocal * glm::vec3(px[i], py[i], pz[i]);
+            r.min = glm::min(r.min, p);
+            r.max = glm::max(r.max, p);
+        }
+    });
+    Range local;
+    for (const Range& r : extents) {
+        local.min = glm::min(local.min, r.min);
+        local.max = glm::max(local.max, r.max);
+    }
+
+    // Volumen con un margen minimo para que las cajas planas se puedan comparar
+    auto volume = [](const glm::vec3& size) {
+        float eps = 1e-4f * std::max({ size.x, size.y, size.z, 1e-20f });
+        return (size.x + eps) * (size.y + eps) * (size.z + eps);
+    };
+    if (volume(local.max - local.min) < volume(aabb.max - aabb.min)) {
+        box.axes = axes;
+        box.center = axes * ((local.min + local.max) * 0.5f);
+        box.halfExtents = (local.max - local.min) * 0.5f;
+    }
+    else {
+        box.axes = glm::mat3(1.0f);
+        box.center = (aabb.min + aabb.max) * 0.5f;
+        box.halfExtents = (aabb.max - aabb.min) * 0.5f;
+    }
+    return box;
+}
+
+void transformBox(const glm::mat4& m, const glm::vec3& lo, const glm::vec3& hi, glm::vec3& outLo, glm::vec3& outHi) {
+    // Centro transformado y medio tamano por el valor absoluto de la parte lineal
+    glm::vec3 center = glm::vec3(m * glm::vec4((lo + hi) * 0.5f, 1.0f));
+    glm::vec3 half = (hi - lo) * 0.5f;
+    glm::vec3 extent(0.0f);
+    for (int c = 0; c < 3; c++) extent += glm::abs(glm::vec3(m[c])) * half[c];
+    outLo = center - extent;
+    outHi = center + extent;
+}
+
+bool boxInFrustum(const glm::mat4& viewProjection, const glm::vec3& lo, const glm::vec3& hi) {
+    // Planos de la matriz de proyeccion (Gribb-Hartmann): filas 4 +/- 1, 2, 3
+    const glm::mat4 t = glm::transpose(viewProjection);
+    const glm::vec4 planes[6] = { t[3] + t[0], t[3] - t[0], t[3] + t[1], t[3] - t[1], t[3] + t[2], t[3] - t[2] };
+    for (const glm::vec4& p : planes) {
+        // Esquina mas adentro segun la normal del plano
+        glm::vec3 corner(p.x >= 0.0f ? hi.x : lo.x, p.y >= 0.0f ? hi.y : lo.y, p.z >= 0.0f ? hi.z : lo.z);
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0.0f) return false;
+    }
+    return true;
+}
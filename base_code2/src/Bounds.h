@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include "MeshPipeline.h"
+
+// Caja orientada: centro, ejes (columnas, ortonormales) y medio tamano en cada eje
+struct OrientedBox {
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::mat3 axes = glm::mat3(1.0f);
+    glm::vec3 halfExtents = glm::vec3(0.0f);
+    // Transformacion del cubo unitario [-0.5, 0.5] a la caja
+    glm::mat4 boxTransform() const;
+};
+
+// Caja alineada de cada sub-mallado del modelo y, reducidas, la del modelo (centro,
+// escala a cubo de lado 2 y diagonal). Una sola pasada sobre las posiciones, en el
+// ThreadPool y con min/max SSE por eje; los sub-mallados grandes se parten en trozos.
+// scratch: de donde salen los temporales (la arena de carga en el visor)
+void computeBounds(const VertexStreams& vertices, std::vector<SubMesh>& subMeshes, Model& model,
+    std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+// Caja orientada ajustada a vertices[first, first + count) con ejes de PCA (covarianza
+// de las posiciones). Si la caja alineada es mas chica, devuelve esa.
+OrientedBox computeOrientedBox(const VertexStreams& vertices, size_t first, size_t count);
+
+// Caja alineada (en el espacio de destino) de la caja [lo, hi] transformada por m
+void transformBox(const glm::mat4& m, const glm::vec3& lo, const glm::vec3& hi, glm::vec3& outLo, glm::vec3& outHi);
+
+// false si la caja [lo, hi] queda entera fuera de algun plano del frustum de viewProjection
+bool boxInFrustum(const glm::mat4& viewProjection, const glm::vec3& lo, const glm::vec3& hi);
@@ -0,0 +1,136 @@
+#include "GpuProfiler.h"
+#include <cstdio>
+#include <fstream>
+
+bool GpuProfiler::init() {
+    if (m_ready) return true;
+    glGenQueries(kFrames * GpuTimingHistory::kPasses * 2, &m_queries[0][0][0]);
+    glGenQueries(kFrames * 2, &m_frameQueries[0][0]);
+    m_ready = glGetError() == GL_NO_ERROR;
+    if (!m_ready) fprintf(stderr, "ERROR::GPU_PROFILER:: No se pudieron crear las consultas de tiempo\n");
+    return m_ready;
+}
+
+void GpuProfiler::destroy() {
+    if (!m_ready) return;
+    glDeleteQueries(kFrames * GpuTimingHistory::kPasses * 2, &m_queries[0][0][0]);
+    glDeleteQueries(kFrames * 2, &m_frameQueries[0][0]);
+    m_ready = false;
+}
+
+void GpuProfiler::beginFrame(unsigned long long frameId) {
+    if (!m_ready) return;
+    m_slot = (m_slot + 1) % kFrames;
+    // Este hueco se emitio hace kFrames frames: leerlo antes de reutilizarlo
+    if (m_pending[m_slot]) collect(m_slot);
+    for (int p = 0; p < GpuTimingHistory::kPasses; p++) m_used[m_slot][p] = false;
+    m_slotFrameId[m_slot] = frameId;
+    glQueryCounter(m_frameQueries[m_slot][0], GL_TIMESTAMP);
+    m_inFrame = true;
+}
+
+void GpuProfiler::endFrame() {
+    if (!m_ready || !m_inFrame) return;
+    glQueryCounter(m_frameQueries[m_slot][1], GL_TIMESTAMP);
+    m_pending[m_slot] = true;
+    m_inFrame = false;
+}
+
+void GpuProfiler::begin(GpuPass pass) {
+    if (!m_inFrame) return;
+    glQueryCounter(m_queries[m_slot][(int)pass][0], GL_TIMESTAMP);
+}
+
+void GpuProfiler::end(GpuPass pass) {
+    if (!m_inFrame) return;
+    glQueryCounter(m_queries[m_slot][(int)pass][1], GL_TIMESTAMP);
+    m_used[m_slot][(int)pass] = true;
+}
+
+void GpuProfiler::flush() {
+    if (!m_ready) return;
+    // Del hueco mas antiguo al mas reciente para conservar el orden
+    for (int i = 1; i <= kFrames; i++) {
+        int slot = (m_slot + i) % kFrames;
+        if (m_pending[slot]) collect(slot);
+    }
+}
+
+void GpuProfiler::collect(int slot) {
+    m_pending[slot] = false;
+    // La marca final del frame es la ultima emitida: si ella esta, todas lo estan
+    GLint available = 0;
+    glGetQueryObjectiv(m_frameQueries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+    float passMs[GpuTimingHistory::kPasses];
+    for (int p = 0; p < GpuTimingHistory::kPasses; p++) {
+        passMs[p] = 0.0f;
+        if (!m_used[slot][p]) continue;
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(m_queries[slot][p][0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(m_queries[slot][p][1], GL_QUERY_RESULT, &t1);
+        passMs[p] = (float)((double)(t1 - t0) / 1e6);
+    }
+    GLuint64 f0 = 0, f1 = 0;
+    glGetQueryObjectui64v(m_frameQueries[slot][0], GL_QUERY_RESULT, &f0);
+    glGetQueryObjectui64v(m_frameQueries[slot][1], GL_QUERY_RESULT, &f1);
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    GpuTimingHistory& h = m_history;
+    for (int p = 0; p < GpuTimingHistory::kPasses; p++) h.passMs[p][h.index] = passMs[p];
+    h.frameMs[h.index] = (float)((double)(f1 - f0) / 1e6);
+    h.frameIds[h.index] = m_slotFrameId[slot];
+    h.index = (h.index + 1) % GpuTimingHistory::kHistory;
+    if (h.count < GpuTimingHistory::kHistory) h.count++;
+    for (int p = 0; p < GpuTimingHistory::kPasses; p++) {
+        float sum = 0.0f;
+        for (int i = 0; i < h.count; i++) sum += h.passMs[p][i];
+        h.avgPassMs[p] = sum / h.count;
+    }
+    float sum = 0.0f;
+    for (int i = 0; i < h.count; i++) sum += h.frameMs[i];
+    h.avgFrameMs = sum / h.count;
+}
+
+void GpuProfiler::copyHistory(GpuTimingHistory& out) {
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    out = m_history;
+}
+
+void GpuProfiler::resetHistory() {
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    m_history = GpuTimingHistory();
+}
+
+bool GpuProfiler::exportCSV(const std::string& path) {
+    GpuTimingHistory h;
+    copyHistory(h);
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "frame";
+    for (int p = 0; p < GpuTimingHistory::kPasses; p++) out << "," << passName((GpuPass)p) << "_ms";
+    out << ",total_ms\n";
+    // Del mas antiguo al mas reciente
+    int start = (h.count == GpuTimingHistory::kHistory) ? h.index : 0;
+    for (int n = 0; n < h.count; n++) {
+        int i = (start + n) % GpuTimingHistory::kHistory;
+        out << h.frameIds[i];
+        for (int p = 0; p < GpuTimingHistory::kPasses; p++) out << "," << h.passMs[p][i];
+        out << "," << h.frameMs[i] << "\n";
+    }
+    return true;
+}
+
+const char* GpuProfiler::passName(GpuPass pass) {
+    switch (pass) {
+    case GpuPass::Fill: return "relleno";
+    case GpuPass::Wireframe: return "wireframe";
+    case GpuPass::Vertices: return "vertices";
+    case GpuPass::Normals: return "normales";
+    case GpuPass::BoundingBox: return "bounding_box";
+    case GpuPass::Picking: return "picking";
+    case GpuPass::Interface: return "imgui";
+    case GpuPass::Shadows: return "sombras";
+    case GpuPass::Ssao: return "ssao";
+    default: return "?";
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <mutex>
+
+// Pasadas que se miden por separado
+enum class GpuPass {
+    Fill,
+    Wireframe,
+    Vertices,
+    Normals,
+    BoundingBox,
+    Picking,
+    Interface,
+    Shadows,
+    Ssao,
+    Count
+};
+
+// Historial de tiempos GPU por pasada (ms), copia para la UI
+struct GpuTimingHistory {
+    static const int kHistory = 240;
+    static const int kPasses = (int)GpuPass::Count;
+    float passMs[kPasses][kHistory] = {};
+    float frameMs[kHistory] = {};
+    unsigned long long frameIds[kHistory] = {};
+    int count = 0;
+    // Proxima posicion a escribir (la mas antigua si el anillo esta lleno)
+    int index = 0;
+    // Promedio sobre el historial
+    float avgPassMs[kPasses] = {};
+    float avgFrameMs = 0.0f;
+};
+
+// Perfilador con glQueryCounter(GL_TIMESTAMP): cada pasada escribe una marca al
+// empezar y otra al terminar. Las consultas forman un anillo de kFrames frames,
+// de modo que se leen resultados de hace kFrames-1 frames; si aun no estan
+// disponibles ese frame se descarta en lugar de bloquear la CPU.
+// begin/end/beginFrame/endFrame solo desde el hilo que posee el contexto GL.
+class GpuProfiler {
+public:
+    static const int kFrames = 4;
+
+    bool init();
+    void destroy();
+    void beginFrame(unsigned long long frameId);
+    void endFrame();
+    void begin(GpuPass pass);
+    void end(GpuPass pass);
+    // Lee todo lo pendiente esperando a la GPU (solo benchmark, tras glFinish)
+    void flush();
+
+    // Lado UI (cualquier hilo)
+    void copyHistory(GpuTimingHistory& out);
+    void resetHistory();
+    bool exportCSV(const std::string& path);
+    static const char* passName(GpuPass pass);
+private:
+    void collect(int slot);
+
+    bool m_ready = false;
+    bool m_inFrame = false;
+    int m_slot = 0;
+    // [frame del anillo][pasada][inicio/fin], mas inicio/fin del frame completo
+    GLuint m_queries[kFrames][GpuTimingHistory::kPasses][2] = {};
+    GLuint m_frameQueries[kFrames][2] = {};
+    bool m_used[kFrames][GpuTimingHistory::kPasses] = {};
+    bool m_pending[kFrames] = {};
+    unsigned long long m_slotFrameId[kFrames] = {};
+    std::mutex m_historyMutex;
+    GpuTimingHistory m_history;
+};
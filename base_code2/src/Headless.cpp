@@ -0,0 +1,253 @@
+#include "Headless.h"
+#include "LightClusters.h"
+#include "Ssao.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool HeadlessContext::create() {
+#ifdef _WIN32
+    // Sin EGL en Windows: ventana GLFW que nunca se muestra
+    if (!glfwInit()) return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_window = glfwCreateWindow(16, 16, "Proyecto 2 - Headless", NULL, NULL);
+    if (!m_window) { glfwTerminate(); return false; }
+    glfwMakeContextCurrent(m_window);
+    return true;
+#else
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExts && strstr(clientExts, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        fprintf(stderr, "ERROR::HEADLESS:: No se pudo inicializar EGL\n");
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "ERROR::HEADLESS:: EGL sin soporte para OpenGL de escritorio\n");
+        eglTerminate(display);
+        return false;
+    }
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        // Sin superficie no hace falta pbuffer: cualquier config de OpenGL sirve
+        const EGLint anyAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        if (!eglChooseConfig(display, anyAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+            fprintf(stderr, "ERROR::HEADLESS:: No hay configuracion EGL para OpenGL\n");
+            eglTerminate(display);
+            return false;
+        }
+    }
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "ERROR::HEADLESS:: No se pudo crear el contexto OpenGL 3.3 (EGL %d.%d)\n", major, minor);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+    m_display = display;
+    m_context = context;
+    return true;
+#endif
+}
+
+void HeadlessContext::destroy() {
+#ifdef _WIN32
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+        m_window = nullptr;
+    }
+#else
+    if (m_display) {
+        eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)m_display, (EGLContext)m_context);
+        eglTerminate((EGLDisplay)m_display);
+        m_display = m_context = nullptr;
+    }
+#endif
+}
+
+void* HeadlessContext::getProcAddress(const char* name) {
+#ifdef _WIN32
+    return (void*)glfwGetProcAddress(name);
+#else
+    return (void*)eglGetProcAddress(name);
+#endif
+}
+
+const std::vector<CameraPreset>& cameraPresets() {
+    static const std::vector<CameraPreset> presets = {
+        { "frente", -90.0f, 0.0f },
+        { "atras", 90.0f, 0.0f },
+        { "izquierda", 0.0f, 0.0f },
+        { "derecha", 180.0f, 0.0f },
+        { "arriba", -90.0f, -89.0f },
+        { "iso", -45.0f, -35.26f },
+    };
+    return presets;
+}
+
+const CameraPreset* findCameraPreset(const std::string& name) {
+    for (const auto& p : cameraPresets()) {
+        if (name == p.name) return &p;
+    }
+    return nullptr;
+}
+
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static void printUsage() {
+    fprintf(stderr,
+        "Uso: Proyecto2 [--headless] [opciones] modelo1.obj [modelo2.obj ...]\n"
+        "  --headless            Sin ventana: renderiza cada modelo y camara a PNG\n"
+        "  --size WxH            Resolucion de salida (por defecto 1920x1080)\n"
+        "  --out DIR             Carpeta de salida (por defecto renders)\n"
+        "  --cameras a,b,...     Camaras: frente, atras, izquierda, derecha, arriba, iso\n"
+        "  --wireframe --normals --vertices   Opciones de visualizacion\n"
+        "  --smooth GRADOS       Regenera normales suaves con ese angulo de pliegue\n"
+        "  --benchmark           Recorre un camino de camara con cada opcion y sale\n"
+        "  --path P              orbita, dolly, vuelo o archivo grabado (x y z yaw pitch)\n"
+        "  --frames N            Frames medidos por caso (por defecto 300)\n"
+        "  --json ARCHIVO        Resultados (por defecto benchmark.json)\n"
+        "  --budget-ms X         Sale con codigo 3 si el p95 de algun caso supera X ms\n"
+        "  --check-allocs        Informa cada render() que asigne memoria (tras calentar)\n"
+        "  --texture-budget MB   Memoria de texturas en la GPU (por defecto 256)\n"
+        "  --lights N,M,...      Luces puntuales, hasta 4096 (el benchmark mide cada cantidad)\n"
+        "  --no-shadows --spot   Sin sombras / agrega un foco con sombra\n"
+        "  --ssao P              Oclusion ambiental: rendimiento o calidad\n"
+        "  --trace-cpu           Captura las zonas CPU y las guarda en traza_cpu.json\n"
+        "Los modelos se buscan en objetos3D/.\n");
+}
+
+bool parseBatchArgs(int argc, char** argv, BatchJob& job, bool& headless) {
+    headless = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") headless = true;
+        else if (arg == "--size" && hasValue) {
+            char* end = nullptr;
+            job.width = (int)strtol(argv[++i], &end, 10);
+            job.height = (end && *end == 'x') ? (int)strtol(end + 1, &end, 10) : 0;
+            if (job.width <= 0 || job.height <= 0 || (end && *end != '\0')) {
+                fprintf(stderr, "Resolucion invalida: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--out" && hasValue) job.outputDir = argv[++i];
+        else if (arg == "--cameras" && hasValue) {
+            job.cameras = splitList(argv[++i]);
+            for (const auto& c : job.cameras) {
+                if (!findCameraPreset(c)) {
+                    fprintf(stderr, "Camara desconocida: %s\n", c.c_str());
+                    return false;
+                }
+            }
+        }
+        else if (arg == "--benchmark") job.benchmark.enabled = true;
+        else if (arg == "--path" && hasValue) job.benchmark.path = argv[++i];
+        else if (arg == "--frames" && hasValue) {
+            job.benchmark.frames = atoi(argv[++i]);
+            if (job.benchmark.frames <= 0) {
+                fprintf(stderr, "Numero de frames invalido: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--json" && hasValue) job.benchmark.jsonPath = argv[++i];
+        else if (arg == "--budget-ms" && hasValue) job.benchmark.budgetMs = (float)atof(argv[++i]);
+        else if (arg == "--wireframe") job.wireframe = true;
+        else if (arg == "--normals") job.normals = true;
+        else if (arg == "--vertices") job.vertices = true;
+        else if (arg == "--smooth" && hasValue) job.smoothAngle = (float)atof(argv[++i]);
+        else if (arg == "--check-allocs") job.checkAllocations = true;
+        else if (arg == "--texture-budget" && hasValue) {
+            job.textureBudgetMB = atoi(argv[++i]);
+            if (job.textureBudgetMB <= 0) {
+                fprintf(stderr, "Presupuesto de texturas invalido: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--no-shadows") job.shadows = false;
+        else if (arg == "--spot") job.spot = true;
+        else if (arg == "--trace-cpu") job.cpuTrace = true;
+        else if (arg == "--ssao" && hasValue) {
+            std::string preset = argv[++i];
+            job.ssaoPreset = -1;
+            for (int p = 0; p < kSsaoPresets; p++) {
+                if (preset == ssaoPresetName(p)) job.ssaoPreset = p;
+            }
+            if (job.ssaoPreset < 0) {
+                fprintf(stderr, "Preajuste de SSAO invalido: %s\n", preset.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--lights" && hasValue) {
+            job.lightCounts.clear();
+            for (const auto& n : splitList(argv[++i])) {
+                char* end = nullptr;
+                long count = strtol(n.c_str(), &end, 10);
+                if (count < 0 || (end && *end != '\0')) {
+                    fprintf(stderr, "Cantidad de luces invalida: %s\n", n.c_str());
+                    return false;
+                }
+                if (count > LightClusters::kMaxLights) {
+                    fprintf(stderr, "Cantidad de luces %ld: se usan %d (el maximo)\n", count, LightClusters::kMaxLights);
+                    count = LightClusters::kMaxLights;
+                }
+                job.lightCounts.push_back((int)count);
+            }
+        }
+        else if (arg == "--help" || arg == "-h") { printUsage(); return false; }
+        else if (!arg.empty() && arg[0] == '-') {
+            fprintf(stderr, "Opcion desconocida: %s\n", arg.c_str());
+            printUsage();
+            return false;
+        }
+        else job.models.push_back(arg);
+    }
+    if (job.cameras.empty()) job.cameras = { "frente", "iso" };
+    if ((headless || job.benchmark.enabled) && job.models.empty()) {
+        fprintf(stderr, "Los modos --headless y --benchmark necesitan al menos un modelo\n");
+        printUsage();
+        return false;
+    }
+    return true;
+}
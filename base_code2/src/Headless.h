@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+struct GLFWwindow;
+
+// Contexto OpenGL 3.3 core sin ventana visible.
+// Linux: EGL sin superficie (EGL_MESA_platform_surfaceless), funciona con
+// llvmpipe en nodos sin pantalla ni GPU. Windows: ventana GLFW oculta.
+// Se dibuja siempre en un FBO propio, nunca en el framebuffer por defecto.
+class HeadlessContext {
+public:
+    bool create();
+    void destroy();
+    // Cargador para gladLoadGLLoader
+    static void* getProcAddress(const char* name);
+    GLFWwindow* window() const { return m_window; }
+private:
+    GLFWwindow* m_window = nullptr;
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+};
+
+// Trabajo por lotes desde la linea de comandos
+struct BatchJob {
+    int width = 1920;
+    int height = 1080;
+    std::string outputDir = "renders";
+    std::vector<std::string> models;
+    std::vector<std::string> cameras;
+    bool wireframe = false;
+    bool normals = false;
+    bool vertices = false;
+    // >= 0: regenerar normales suaves con este angulo de pliegue (grados) tras cargar
+    float smoothAngle = -1.0f;
+    // Marca las asignaciones del heap dentro de render() tras el calentamiento
+    bool checkAllocations = false;
+    // Presupuesto de memoria de texturas en la GPU (MB)
+    int textureBudgetMB = 256;
+    // Luces puntuales: las capturas y los casos del benchmark usan la primera cantidad;
+    // con varias, el benchmark agrega un caso luces_N por cada una
+    std::vector<int> lightCounts;
+    // Sombras de la luz direccional; con spot, tambien un foco con sombra
+    bool shadows = true;
+    bool spot = false;
+    // Preajuste de SSAO (-1 = sin SSAO); el benchmark mide ademas cada preajuste en un caso ssao_*
+    int ssaoPreset = -1;
+    // Captura las zonas del perfilador CPU y las guarda en traza_cpu.json al salir
+    bool cpuTrace = false;
+    BenchmarkJob benchmark;
+};
+
+// Camara orbital alrededor del modelo (angulos como los de la camara FPS)
+struct CameraPreset {
+    const char* name;
+    float yaw;
+    float pitch;
+};
+
+const CameraPreset* findCameraPreset(const std::string& name);
+const std::vector<CameraPreset>& cameraPresets();
+// Devuelve false (y escribe el error) si los argumentos no son validos
+bool parseBatchArgs(int argc, char** argv, BatchJob& job, bool& headless);
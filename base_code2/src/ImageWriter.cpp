@@ -0,0 +1,16 @@
+#include "ImageWriter.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+bool writePNG(const std::string& path, int width, int height, const unsigned char* rgba, bool flipY) {
+    if (width <= 0 || height <= 0 || !rgba) return false;
+    int stride = width * 4;
+    // stbi_flip_vertically_on_write es global; se voltea empezando por la
+    // ultima fila con stride negativo, sin copiar la imagen
+    if (flipY) {
+        rgba += (size_t)stride * (height - 1);
+        stride = -stride;
+    }
+    return stbi_write_png(path.c_str(), width, height, 4, rgba, stride) != 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Escritor PNG (RGBA 8 bits) sobre stbi_write_png (include/stb/stb_image_write.h).
+// Si flipY es true la primera fila de 'rgba' es la inferior (orden de glReadPixels).
+bool writePNG(const std::string& path, int width, int height, const unsigned char* rgba, bool flipY = false);
@@ -0,0 +1,184 @@
+#include "LightClusters.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Distancia al cuadrado de un punto a una caja (0 si esta dentro)
+float distanceSquared(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 d = glm::max(lo - p, glm::max(p - hi, glm::vec3(0.0f)));
+    return glm::dot(d, d);
+}
+
+int tileOf(float ndc, int tiles) {
+    return glm::clamp((int)std::floor((ndc * 0.5f + 0.5f) * tiles), 0, tiles - 1);
+}
+
+} // namespace
+
+void LightClusters::swap(LightClusters& other) {
+    lights.swap(other.lights);
+    grid.swap(other.grid);
+    indices.swap(other.indices);
+    std::swap(zScale, other.zScale);
+    std::swap(zBias, other.zBias);
+    std::swap(dropped, other.dropped);
+}
+
+void LightClusterBuilder::updateClusterBounds(const glm::mat4& projection) {
+    glm::vec4 key(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+    if (key == m_boundsKey && !m_boundsMin.empty()) return;
+    m_boundsKey = key;
+    // Planos de glm::perspective: [2][2] = -(f+n)/(f-n), [3][2] = -2fn/(f-n)
+    m_near = projection[3][2] / (projection[2][2] - 1.0f);
+    m_far = projection[3][2] / (projection[2][2] + 1.0f);
+    const float range = std::log(m_far / m_near);
+    m_zScale = LightClusters::kSlices / range;
+    m_zBias = -LightClusters::kSlices * std::log(m_near) / range;
+    m_boundsMin.resize(LightClusters::kClusters);
+    m_boundsMax.resize(LightClusters::kClusters);
+    const float sx = projection[0][0], sy = projection[1][1];
+    for (int z = 0; z < LightClusters::kSlices; z++) {
+        float dn = m_near * std::pow(m_far / m_near, (float)z / LightClusters::kSlices);
+        float df = m_near * std::pow(m_far / m_near, (float)(z + 1) / LightClusters::kSlices);
+        for (int y = 0; y < LightClusters::kTilesY; y++) {
+            float ny0 = -1.0f + 2.0f * y / LightClusters::kTilesY;
+            float ny1 = -1.0f + 2.0f * (y + 1) / LightClusters::kTilesY;
+            for (int x = 0; x < LightClusters::kTilesX; x++) {
+                float nx0 = -1.0f + 2.0f * x / LightClusters::kTilesX;
+                float nx1 = -1.0f + 2.0f * (x + 1) / LightClusters::kTilesX;
+                // El froxel es un tronco de piramide: su caja toma los extremos de ambas tapas
+                int c = x + LightClusters::kTilesX * (y + LightClusters::kTilesY * z);
+                m_boundsMin[c] = glm::vec3(std::min(nx0 * dn, nx0 * df) / sx, std::min(ny0 * dn, ny0 * df) / sy, -df);
+                m_boundsMax[c] = glm::vec3(std::max(nx1 * dn, nx1 * df) / sx, std::max(ny1 * dn, ny1 * df) / sy, -dn);
+            }
+        }
+    }
+}
+
+int LightClusterBuilder::sliceOf(float depth) const {
+    return glm::clamp((int)std::floor(std::log(depth) * m_zScale + m_zBias), 0, LightClusters::kSlices - 1);
+}
+
+template <typename Fn>
+void LightClusterBuilder::forEachOverlap(int z, Fn&& fn) const {
+    const glm::vec3* boundsMin = m_boundsMin.data() + z * LightClusters::kTiles;
+    const glm::vec3* boundsMax = m_boundsMax.data() + z * LightClusters::kTiles;
+    for (uint32_t i = 0; i < (uint32_t)m_viewLights.size(); i++) {
+        const ViewLight& l = m_viewLights[i];
+        if (z < l.z0 || z > l.z1) continue;
+        const float r2 = l.radius * l.radius;
+        for (int y = l.y0; y <= l.y1; y++) {
+            for (int x = l.x0; x <= l.x1; x++) {
+                int tile = x + LightClusters::kTilesX * y;
+                if (distanceSquared(l.center, boundsMin[tile], boundsMax[tile]) <= r2) fn(tile, i);
+            }
+        }
+    }
+}
+
+void LightClusterBuilder::assignSlice(int z) {
+    Slice& s = m_slices[z];
+    // Dos pasadas (contar y escribir) en lugar de guardar los pares: la unica memoria
+    // que depende de la vista es indices, con tope conocido
+    s.count.assign(LightClusters::kTiles, 0);
+    s.first.resize(LightClusters::kTiles);
+    forEachOverlap(z, [&s](int tile, uint32_t) { s.count[tile]++; });
+    uint32_t total = 0;
+    s.dropped = 0;
+    for (int t = 0; t < LightClusters::kTiles; t++) {
+        if (s.count[t] > (uint32_t)LightClusters::kMaxPerCluster) {
+            s.dropped += s.count[t] - LightClusters::kMaxPerCluster;
+            s.count[t] = LightClusters::kMaxPerCluster;
+        }
+        s.first[t] = total;
+        total += s.count[t];
+    }
+    s.indices.resize(total);
+    // Las luces quedan en orden de indice; con el tope se descartan las ultimas
+    s.cursor.assign(LightClusters::kTiles, 0);
+    forEachOverlap(z, [&s](int tile, uint32_t light) {
+        uint32_t& c = s.cursor[tile];
+        if (c < s.count[tile]) s.indices[s.first[tile] + c++] = light;
+    });
+}
+
+void LightClusterBuilder::build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, LightClusters& out) {
+    PROFILE_FUNCTION();
+    updateClusterBounds(projection);
+    out.zScale = m_zScale;
+    out.zBias = m_zBias;
+    out.lights.resize(lights.size() * 2);
+    m_viewLights.resize(lights.size());
+    const float sx = projection[0][0], sy = projection[1][1];
+    for (size_t i = 0; i < lights.size(); i++) {
+        const PointLight& light = lights[i];
+        out.lights[2 * i] = glm::vec4(light.position, light.radius);
+        out.lights[2 * i + 1] = glm::vec4(light.color * light.intensity, 0.0f);
+        ViewLight& l = m_viewLights[i];
+        l.center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        l.radius = light.radius;
+        l.z0 = 1; l.z1 = 0;
+        const float r = light.radius;
+        const float depth = -l.center.z;
+        const float nearest = depth - r, farthest = depth + r;
+        if (r <= 0.0f || farthest <= m_near || nearest >= m_far) continue;
+        if (nearest <= m_near) {
+            // La esfera toca el plano near: puede cubrir cualquier parte de la pantalla
+            l.x0 = 0; l.x1 = LightClusters::kTilesX - 1;
+            l.y0 = 0; l.y1 = LightClusters::kTilesY - 1;
+        }
+        else {
+            // Rectangulo de la caja de la esfera: x/d es monotona en d, basta con las dos tapas
+            const glm::vec3& c = l.center;
+            float x0 = std::min((c.x - r) / nearest, (c.x - r) / farthest) * sx;
+            float x1 = std::max((c.x + r) / nearest, (c.x + r) / farthest) * sx;
+            float y0 = std::min((c.y - r) / nearest, (c.y - r) / farthest) * sy;
+            float y1 = std::max((c.y + r) / nearest, (c.y + r) / farthest) * sy;
+            if (x1 < -1.0f || x0 > 1.0f || y1 < -1.0f || y0 > 1.0f) continue;
+            l.x0 = tileOf(x0, LightClusters::kTilesX); l.x1 = tileOf(x1, LightClusters::kTilesX);
+            l.y0 = tileOf(y0, LightClusters::kTilesY); l.y1 = tileOf(y1, LightClusters::kTilesY);
+        }
+        l.z0 = sliceOf(std::max(nearest, m_near));
+        l.z1 = sliceOf(std::min(farthest, m_far));
+    }
+    m_slices.resize(LightClusters::kSlices);
+    // Cada luz aparece a lo sumo una vez por tesela: con ese tope la capacidad solo
+    // cambia cuando cambia la cantidad de luces, no al mover la camara
+    const size_t perSlice = std::min(lights.size(), (size_t)LightClusters::kMaxPerCluster) * LightClusters::kTiles;
+    for (Slice& s : m_slices) s.indices.reserve(perSlice);
+    out.indices.reserve(perSlice * LightClusters::kSlices);
+    if (lights.empty()) {
+        for (Slice& s : m_slices) {
+            s.count.assign(LightClusters::kTiles, 0);
+            s.first.assign(LightClusters::kTiles, 0);
+            s.indices.clear();
+            s.dropped = 0;
+        }
+    }
+    else {
+        // Un solo puntero capturado: std::function lo guarda sin reservar memoria
+        ThreadPool::instance().runOrInline(LightClusters::kSlices, [this](size_t z) { assignSlice((int)z); });
+    }
+    // Concatenar las rebanadas en orden
+    size_t total = 0;
+    for (const Slice& s : m_slices) total += s.indices.size();
+    out.indices.resize(total);
+    out.grid.resize(2 * LightClusters::kClusters);
+    out.dropped = 0;
+    size_t base = 0;
+    for (int z = 0; z < LightClusters::kSlices; z++) {
+        const Slice& s = m_slices[z];
+        uint32_t* grid = out.grid.data() + 2 * z * LightClusters::kTiles;
+        for (int t = 0; t < LightClusters::kTiles; t++) {
+            grid[2 * t] = (uint32_t)(base + s.first[t]);
+            grid[2 * t + 1] = s.count[t];
+        }
+        if (!s.indices.empty()) std::memcpy(out.indices.data() + base, s.indices.data(), s.indices.size() * sizeof(uint32_t));
+        base += s.indices.size();
+        out.dropped += s.dropped;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Luz puntual en espacio de mundo; la atenuacion llega a 0 en radius
+struct PointLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    float radius = 1.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+};
+
+// Luces de un frame repartidas en la rejilla de froxels de la camara: kTilesX x kTilesY
+// teselas de pantalla por kSlices rebanadas de profundidad exponenciales entre near y far
+struct LightClusters {
+    static const int kTilesX = 16;
+    static const int kTilesY = 9;
+    static const int kSlices = 24;
+    static const int kTiles = kTilesX * kTilesY;
+    static const int kClusters = kTiles * kSlices;
+    // Luces por cluster como maximo (las de indice mas alto se descartan)
+    static const int kMaxPerCluster = 256;
+    // Luces puntuales de la escena como maximo (slider de la UI y --lights)
+    static const int kMaxLights = 4096;
+
+    // 2 texeles por luz: posicion de mundo y radio, color por intensidad
+    std::vector<glm::vec4> lights;
+    // 2 por cluster (x + kTilesX * (y + kTilesY * z)): primer indice en indices y cantidad
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> indices;
+    // Rebanada de la profundidad de vista d: floor(log(d) * zScale + zBias)
+    float zScale = 0.0f;
+    float zBias = 0.0f;
+    // Pares luz-cluster descartados por kMaxPerCluster
+    size_t dropped = 0;
+
+    size_t lightCount() const { return lights.size() / 2; }
+    void swap(LightClusters& other);
+};
+
+// Reparte las luces entre los clusters de una vista con perspectiva simetrica
+// (glm::perspective). Cada rebanada es un trabajo del pool (runOrInline: no espera
+// a la carga de texturas). Toda la memoria se reutiliza entre frames.
+class LightClusterBuilder {
+public:
+    void build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, LightClusters& out);
+private:
+    // Luz en espacio de vista con su rango de rebanadas y teselas (z0 > z1: fuera de la vista)
+    struct ViewLight {
+        glm::vec3 center;
+        float radius;
+        int z0, z1, x0, x1, y0, y1;
+    };
+    struct Slice {
+        // Por tesela: primer indice (local a la rebanada), cantidad guardada y cursor
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> count;
+        std::vector<uint32_t> cursor;
+        std::vector<uint32_t> indices;
+        size_t dropped = 0;
+    };
+    // Cajas de los clusters en espacio de vista; solo cambian con la proyeccion
+    void updateClusterBounds(const glm::mat4& projection);
+    int sliceOf(float depth) const;
+    // fn(tesela, luz) por cada luz cuya esfera toca un cluster de la rebanada z
+    template <typename Fn>
+    void forEachOverlap(int z, Fn&& fn) const;
+    void assignSlice(int z);
+
+    glm::vec4 m_boundsKey = glm::vec4(0.0f);
+    float m_near = 0.1f, m_far = 100.0f;
+    float m_zScale = 0.0f, m_zBias = 0.0f;
+    std::vector<glm::vec3> m_boundsMin;
+    std::vector<glm::vec3> m_boundsMax;
+    std::vector<ViewLight> m_viewLights;
+    std::vector<Slice> m_slices;
+};
@@ -0,0 +1,438 @@
+#include "MeshGenerator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+namespace {
+
+uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Valor en [0, 1) que depende solo de sus argumentos
+float hashFloat(uint32_t a, uint32_t b, uint32_t c, uint32_t seed) {
+    uint32_t h = hash32(a ^ hash32(b ^ hash32(c ^ hash32(seed))));
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+// Ruido de valor 3D en [-1, 1]
+float valueNoise(const glm::vec3& p, uint32_t seed) {
+    glm::vec3 i = glm::floor(p);
+    glm::vec3 f = p - i;
+    glm::vec3 u = f * f * (3.0f - 2.0f * f);
+    int x = (int)i.x, y = (int)i.y, z = (int)i.z;
+    auto corner = [&](int dx, int dy, int dz) {
+        return hashFloat((uint32_t)(x + dx), (uint32_t)(y + dy), (uint32_t)(z + dz), seed);
+    };
+    float x00 = glm::mix(corner(0, 0, 0), corner(1, 0, 0), u.x);
+    float x10 = glm::mix(corner(0, 1, 0), corner(1, 1, 0), u.x);
+    float x01 = glm::mix(corner(0, 0, 1), corner(1, 0, 1), u.x);
+    float x11 = glm::mix(corner(0, 1, 1), corner(1, 1, 1), u.x);
+    float v = glm::mix(glm::mix(x00, x10, u.y), glm::mix(x01, x11, u.y), u.z);
+    return v * 2.0f - 1.0f;
+}
+
+float fbm(float x, float z, uint32_t seed) {
+    float sum = 0.0f, amp = 0.5f, freq = 1.0f;
+    for (int o = 0; o < 5; o++) {
+        sum += amp * valueNoise(glm::vec3(x * freq, 0.5f, z * freq), seed + o);
+        amp *= 0.5f;
+        freq *= 2.0f;
+    }
+    return sum;
+}
+
+// Cara f del cubo [-1, 1]^3 parametrizada por s, t en [0, 1]
+glm::vec3 cubePoint(int face, float s, float t) {
+    float a = 2.0f * s - 1.0f, b = 2.0f * t - 1.0f;
+    switch (face) {
+    case 0: return glm::vec3(1.0f, b, -a);
+    case 1: return glm::vec3(-1.0f, b, a);
+    case 2: return glm::vec3(a, 1.0f, -b);
+    case 3: return glm::vec3(a, -1.0f, b);
+    case 4: return glm::vec3(a, b, 1.0f);
+    default: return glm::vec3(-a, b, -1.0f);
+    }
+}
+
+// Porcion de una cara: filas de quads [row0, row1) de una rejilla cols x faceRows
+struct Patch {
+    int face = 0;
+    int part = 0;
+    int group = 0;
+    int cols = 1;
+    int faceRows = 1;
+    int row0 = 0, row1 = 1;
+    // Invierte el orden de los triangulos para que la cara mire hacia afuera
+    bool flip = false;
+    // Indice 0-based del primer vertice
+    unsigned long long firstVertex = 0;
+    unsigned long long vertexCount() const { return (unsigned long long)(cols + 1) * (row1 - row0 + 1); }
+    unsigned long long triangleCount() const { return 2ull * cols * (row1 - row0); }
+};
+
+struct Layout {
+    GeneratorParams params;
+    int assemblyGrid = 1;
+    // Ordenados por grupo: los del grupo g empiezan en groupFirstPatch[g]
+    std::vector<Patch> patches;
+    std::vector<int> groupFirstPatch;
+};
+
+// Centro y semiejes de la pieza 'part' del ensamblado
+void partBox(const Layout& L, int part, glm::vec3& center, glm::vec3& half) {
+    int n = L.assemblyGrid;
+    int ix = part % n, iy = (part / n) % n, iz = part / (n * n);
+    const float spacing = 1.0f;
+    center = (glm::vec3((float)ix, (float)iy, (float)iz) - 0.5f * (n - 1)) * spacing;
+    uint32_t seed = L.params.seed;
+    half = glm::vec3(
+        0.2f + 0.25f * hashFloat(part, 11, 0, seed),
+        0.2f + 0.25f * hashFloat(part, 12, 0, seed),
+        0.2f + 0.25f * hashFloat(part, 13, 0, seed)) * spacing;
+}
+
+glm::vec3 evalPosition(const Layout& L, int face, int part, float s, float t) {
+    switch (L.params.shape) {
+    case GeneratedShape::Sphere: {
+        glm::vec3 d = glm::normalize(cubePoint(face, s, t));
+        return d * (1.0f + 0.04f * valueNoise(d * 3.0f, L.params.seed));
+    }
+    case GeneratedShape::Terrain: {
+        float x = (s - 0.5f) * 10.0f, z = (t - 0.5f) * 10.0f;
+        return glm::vec3(x, 1.2f * fbm(x * 0.25f, z * 0.25f, L.params.seed), z);
+    }
+    default: {
+        glm::vec3 center, half;
+        partBox(L, part, center, half);
+        glm::vec3 c = cubePoint(face, s, t);
+        // Caja redondeada: mezcla entre el cubo y la esfera
+        return center + glm::mix(c, glm::normalize(c) * 1.2f, 0.35f) * half;
+    }
+    }
+}
+
+// Derivadas numericas: sirve para las tres formas sin casos especiales
+glm::vec3 evalCross(const Layout& L, int face, int part, float s, float t) {
+    const float e = 1e-3f;
+    glm::vec3 ds = evalPosition(L, face, part, s + e, t) - evalPosition(L, face, part, s - e, t);
+    glm::vec3 dt = evalPosition(L, face, part, s, t + e) - evalPosition(L, face, part, s, t - e);
+    return glm::cross(ds, dt);
+}
+
+bool faceNeedsFlip(const Layout& L, int face) {
+    glm::vec3 n = evalCross(L, face, 0, 0.5f, 0.5f);
+    glm::vec3 outward;
+    if (L.params.shape == GeneratedShape::Terrain) {
+        outward = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    else {
+        glm::vec3 center(0.0f), half;
+        if (L.params.shape == GeneratedShape::Assembly) partBox(L, 0, center, half);
+        outward = evalPosition(L, face, 0, 0.5f, 0.5f) - center;
+    }
+    return glm::dot(n, outward) < 0.0f;
+}
+
+Layout buildLayout(const GeneratorParams& in) {
+    Layout L;
+    L.params = in;
+    GeneratorParams& p = L.params;
+    p.triangles = std::max(p.triangles, 12ull);
+    p.groups = std::max(1, std::min(p.groups, 1000000));
+    int faces = 1, parts = 1, n = 1;
+    if (p.shape == GeneratedShape::Sphere) {
+        faces = 6;
+        n = std::max(1, (int)std::lround(std::sqrt(p.triangles / 12.0)));
+        p.groups = std::min(p.groups, 6 * n);
+    }
+    else if (p.shape == GeneratedShape::Terrain) {
+        n = std::max(1, (int)std::lround(std::sqrt(p.triangles / 2.0)));
+        p.groups = std::min(p.groups, n);
+    }
+    else {
+        faces = 6;
+        parts = p.groups;
+        n = std::max(1, (int)std::lround(std::sqrt(p.triangles / (12.0 * parts))));
+        while (L.assemblyGrid * L.assemblyGrid * L.assemblyGrid < parts) L.assemblyGrid++;
+    }
+    p.materials = std::max(1, std::min(p.materials, p.groups));
+    bool flip[6];
+    for (int f = 0; f < faces; f++) flip[f] = faceNeedsFlip(L, f);
+    L.groupFirstPatch.resize(p.groups);
+    for (int g = 0; g < p.groups; g++) {
+        L.groupFirstPatch[g] = (int)L.patches.size();
+        Patch patch;
+        patch.group = g;
+        patch.cols = n;
+        patch.faceRows = n;
+        if (p.shape == GeneratedShape::Assembly) {
+            // Una pieza cerrada por grupo
+            patch.part = g;
+            for (int f = 0; f < faces; f++) {
+                patch.face = f;
+                patch.flip = flip[f];
+                patch.row0 = 0;
+                patch.row1 = n;
+                L.patches.push_back(patch);
+            }
+            continue;
+        }
+        // Bandas de filas consecutivas sobre todas las caras
+        long long totalRows = (long long)faces * n;
+        long long a = totalRows * g / p.groups, b = totalRows * (g + 1) / p.groups;
+        for (int f = 0; f < faces; f++) {
+            long long r0 = std::max(a, (long long)f * n), r1 = std::min(b, (long long)(f + 1) * n);
+            if (r0 >= r1) continue;
+            patch.face = f;
+            patch.flip = flip[f];
+            patch.row0 = (int)(r0 - (long long)f * n);
+            patch.row1 = (int)(r1 - (long long)f * n);
+            L.patches.push_back(patch);
+        }
+    }
+    unsigned long long first = 0;
+    for (auto& patch : L.patches) {
+        patch.firstVertex = first;
+        first += patch.vertexCount();
+    }
+    return L;
+}
+
+void appendUInt(std::string& out, unsigned long long v) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) out.push_back(digits[--n]);
+}
+
+// Punto fijo con 6 decimales (como "%.6f", pero sin locale y mucho mas rapido)
+void appendFloat(std::string& out, float f) {
+    double v = f;
+    bool negative = v < 0.0;
+    unsigned long long scaled = (unsigned long long)((negative ? -v : v) * 1e6 + 0.5);
+    if (negative && scaled) out.push_back('-');
+    appendUInt(out, scaled / 1000000);
+    out.push_back('.');
+    unsigned long long frac = scaled % 1000000;
+    char digits[6];
+    for (int i = 5; i >= 0; i--) {
+        digits[i] = (char)('0' + frac % 10);
+        frac /= 10;
+    }
+    out.append(digits, 6);
+}
+
+// Trozo del OBJ que un hilo formatea por separado
+struct WriteItem {
+    int patch = 0;
+    bool faces = false;
+    // Filas de vertices (o de quads) relativas al parche: [begin, end)
+    int begin = 0, end = 0;
+};
+
+void appendVertexRef(std::string& out, unsigned long long index, const GeneratorParams& p) {
+    appendUInt(out, index + 1);
+    if (p.normals && p.texcoords) {
+        out.push_back('/');
+        appendUInt(out, index + 1);
+        out.push_back('/');
+        appendUInt(out, index + 1);
+    }
+    else if (p.normals) {
+        out.append("//");
+        appendUInt(out, index + 1);
+    }
+    else if (p.texcoords) {
+        out.push_back('/');
+        appendUInt(out, index + 1);
+    }
+}
+
+void groupHeader(std::string& out, const Layout& L, int group) {
+    char line[96];
+    if (L.params.groups == 1) snprintf(line, sizeof(line), "g %s\n", shapeName(L.params.shape));
+    else snprintf(line, sizeof(line), "g %s_%05d\n", shapeName(L.params.shape), group);
+    out.append(line);
+    snprintf(line, sizeof(line), "usemtl mat_%04d\n", group % L.params.materials);
+    out.append(line);
+}
+
+void formatItem(const Layout& L, const WriteItem& item, std::string& out) {
+    const Patch& patch = L.patches[item.patch];
+    const GeneratorParams& p = L.params;
+    if (!item.faces) {
+        for (int r = item.begin; r < item.end; r++) {
+            float t = (float)(patch.row0 + r) / patch.faceRows;
+            for (int c = 0; c <= patch.cols; c++) {
+                float s = (float)c / patch.cols;
+                glm::vec3 pos = evalPosition(L, patch.face, patch.part, s, t);
+                out.append("v ");
+                appendFloat(out, pos.x);
+                out.push_back(' ');
+                appendFloat(out, pos.y);
+                out.push_back(' ');
+                appendFloat(out, pos.z);
+                out.push_back('\n');
+                if (p.texcoords) {
+                    out.append("vt ");
+                    appendFloat(out, s);
+                    out.push_back(' ');
+                    appendFloat(out, t);
+                    out.push_back('\n');
+                }
+                if (p.normals) {
+                    glm::vec3 n = glm::normalize(evalCross(L, patch.face, patch.part, s, t));
+                    if (patch.flip) n = -n;
+                    out.append("vn ");
+                    appendFloat(out, n.x);
+                    out.push_back(' ');
+                    appendFloat(out, n.y);
+                    out.push_back(' ');
+                    appendFloat(out, n.z);
+                    out.push_back('\n');
+                }
+            }
+        }
+        return;
+    }
+    if (item.begin == 0 && L.groupFirstPatch[patch.group] == item.patch) groupHeader(out, L, patch.group);
+    const unsigned long long stride = patch.cols + 1;
+    for (int r = item.begin; r < item.end; r++) {
+        for (int c = 0; c < patch.cols; c++) {
+            unsigned long long v00 = patch.firstVertex + r * stride + c;
+            unsigned long long v10 = v00 + 1, v01 = v00 + stride, v11 = v01 + 1;
+            unsigned long long tri[2][3] = { { v00, v10, v11 }, { v00, v11, v01 } };
+            if (patch.flip) {
+                std::swap(tri[0][1], tri[0][2]);
+                std::swap(tri[1][1], tri[1][2]);
+            }
+            for (int k = 0; k < 2; k++) {
+                out.append("f ");
+                appendVertexRef(out, tri[k][0], p);
+                out.push_back(' ');
+                appendVertexRef(out, tri[k][1], p);
+                out.push_back(' ');
+                appendVertexRef(out, tri[k][2], p);
+                out.push_back('\n');
+            }
+        }
+    }
+}
+
+std::string materialLibrary(const Layout& L) {
+    std::string out;
+    char line[160];
+    for (int m = 0; m < L.params.materials; m++) {
+        uint32_t seed = L.params.seed;
+        snprintf(line, sizeof(line), "newmtl mat_%04d\nKd %.3f %.3f %.3f\nKa 0.1 0.1 0.1\nKs 0.5 0.5 0.5\nNs 32\nd 1.0\nillum 2\n\n", m,
+            0.25f + 0.7f * hashFloat(m, 1, 0, seed), 0.25f + 0.7f * hashFloat(m, 2, 0, seed), 0.25f + 0.7f * hashFloat(m, 3, 0, seed));
+        out.append(line);
+    }
+    return out;
+}
+
+} // namespace
+
+const char* shapeName(GeneratedShape shape) {
+    switch (shape) {
+    case GeneratedShape::Sphere: return "esfera";
+    case GeneratedShape::Terrain: return "terreno";
+    case GeneratedShape::Assembly: return "ensamblado";
+    default: return "?";
+    }
+}
+
+bool parseShapeName(const std::string& name, GeneratedShape& shape) {
+    for (GeneratedShape s : { GeneratedShape::Sphere, GeneratedShape::Terrain, GeneratedShape::Assembly }) {
+        if (name == shapeName(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool generateOBJ(const std::string& objPath, const GeneratorParams& params, GeneratorStats* stats, std::string& error) {
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    Layout L = buildLayout(params);
+    std::string mtlPath = objPath.substr(0, objPath.find_last_of('.')) + ".mtl";
+    std::string mtlName = mtlPath.substr(mtlPath.find_last_of("/\\") + 1);
+    std::ofstream obj(objPath, std::ios::binary);
+    std::ofstream mtl(mtlPath, std::ios::binary);
+    if (!obj.is_open() || !mtl.is_open()) {
+        error = "No se pudo crear " + objPath;
+        return false;
+    }
+    std::string mtlText = materialLibrary(L);
+    mtl.write(mtlText.data(), mtlText.size());
+
+    // Trozos de ~16K vertices (o quads): todos los vertices primero, luego las caras por grupo
+    std::vector<WriteItem> items;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < (int)L.patches.size(); i++) {
+            const Patch& patch = L.patches[i];
+            int rows = patch.row1 - patch.row0 + (pass == 0 ? 1 : 0);
+            int step = std::max(1, 16384 / (patch.cols + 1));
+            for (int r = 0; r < rows; r += step) {
+                WriteItem item;
+                item.patch = i;
+                item.faces = pass == 1;
+                item.begin = r;
+                item.end = std::min(rows, r + step);
+                items.push_back(item);
+            }
+        }
+    }
+    std::string header = "# Malla sintetica: " + std::string(shapeName(L.params.shape)) + ", semilla " + std::to_string(L.params.seed) + "\nmtllib " + mtlName + "\n";
+    obj.write(header.data(), header.size());
+    unsigned long long bytes = header.size() + mtlText.size();
+    // Ventanas de trozos: los hilos formatean en paralelo y se escriben en orden,
+    // asi la memoria queda acotada aunque el archivo pese varios GB
+    const size_t window = workerCount() * 4;
+    std::vector<std::string> buffers(window);
+    for (size_t w = 0; w < items.size(); w += window) {
+        size_t count = std::min(window, items.size() - w);
+        parallelFor(count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                buffers[i].clear();
+                formatItem(L, items[w + i], buffers[i]);
+            }
+        });
+        for (size_t i = 0; i < count; i++) {
+            obj.write(buffers[i].data(), buffers[i].size());
+            bytes += buffers[i].size();
+        }
+    }
+    if (!obj.good() || !mtl.good()) {
+        error = "Error de escritura en " + objPath;
+        return false;
+    }
+    if (stats) {
+        stats->vertices = L.patches.empty() ? 0 : L.patches.back().firstVertex + L.patches.back().vertexCount();
+        stats->triangles = 0;
+        for (const auto& patch : L.patches) stats->triangles += patch.triangleCount();
+        stats->groups = L.params.groups;
+        stats->materials = L.params.materials;
+        stats->bytes = bytes;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
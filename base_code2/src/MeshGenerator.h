@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+// Generador determinista de OBJ/MTL sinteticos para pruebas de estres.
+// Los mismos parametros producen exactamente los mismos bytes, sin importar
+// cuantos hilos formateen el archivo.
+
+enum class GeneratedShape {
+    Sphere,   // cubo subdividido proyectado a la esfera, con relieve leve
+    Terrain,  // rejilla con ruido fractal
+    Assembly  // muchas piezas (cajas redondeadas), una por grupo
+};
+
+struct GeneratorParams {
+    GeneratedShape shape = GeneratedShape::Sphere;
+    // Triangulos aproximados (se redondea a la subdivision mas cercana)
+    unsigned long long triangles = 1000000;
+    // Grupos 'g' y materiales 'usemtl' (los materiales se reparten ciclicamente)
+    int groups = 1;
+    int materials = 1;
+    unsigned int seed = 1;
+    bool normals = true;
+    bool texcoords = false;
+};
+
+struct GeneratorStats {
+    unsigned long long vertices = 0;
+    unsigned long long triangles = 0;
+    int groups = 0;
+    int materials = 0;
+    unsigned long long bytes = 0;
+    double seconds = 0.0;
+};
+
+const char* shapeName(GeneratedShape shape);
+bool parseShapeName(const std::string& name, GeneratedShape& shape);
+// Escribe objPath y el .mtl con el mismo nombre. 'stats' puede ser nullptr
+bool generateOBJ(const std::string& objPath, const GeneratorParams& params, GeneratorStats* stats, std::string& error);
@@ -0,0 +1,634 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "MeshPipeline.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+
+namespace {
+
+// Lee el OBJ por bloques para tinyobj y sigue los grupos 's', que la API de callbacks
+// no informa: las lineas ya leidas se revisan al llegar a cada cara (scanTo) o antes de
+// pisar el bloque (underflow). El bloque vive en la arena; una linea cortada entre dos
+// bloques pasa al principio del siguiente.
+class ObjReader : public std::streambuf {
+public:
+    ObjReader(std::istream& file, std::pmr::memory_resource* resource)
+        : m_file(file), m_block(kBlockSize, resource) {
+        setg(m_block.data(), m_block.data(), m_block.data());
+        m_scanned = m_block.data();
+    }
+    unsigned int smoothingGroup() const { return m_smoothingGroup; }
+    // Revisa todo lo que tinyobj ya leyo (la linea actual termina en gptr)
+    void scanTo() { scanLines(gptr(), true); }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        scanLines(egptr(), false);
+        // Una linea mas larga que medio bloque no se revisa: se salta hasta su fin
+        size_t tail = egptr() - m_scanned;
+        if (tail > kBlockSize / 2) {
+            tail = 0;
+            m_skipLine = true;
+        }
+        std::memmove(m_block.data(), m_scanned, tail);
+        m_file.read(m_block.data() + tail, (std::streamsize)(kBlockSize - tail));
+        size_t read = (size_t)m_file.gcount();
+        if (read == 0) return traits_type::eof();
+        // Archivos con solo '\r' como fin de linea
+        if (m_firstBlock && !std::memchr(m_block.data() + tail, '\n', read) && std::memchr(m_block.data() + tail, '\r', read)) m_newline = '\r';
+        m_firstBlock = false;
+        setg(m_block.data(), m_block.data() + tail, m_block.data() + tail + read);
+        m_scanned = m_block.data();
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    static const size_t kBlockSize = 1 << 20;
+
+    // Lineas completas de [m_scanned, end); con last, tambien la ultima sin fin de linea
+    void scanLines(const char* end, bool last) {
+        const char* p = m_scanned;
+        if (m_skipLine) {
+            const char* eol = static_cast<const char*>(std::memchr(p, m_newline, end - p));
+            if (!eol) {
+                m_scanned = end;
+                return;
+            }
+            p = eol + 1;
+            m_skipLine = false;
+        }
+        while (p < end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, m_newline, end - p));
+            if (!eol && !last) break;
+            const char* lineEnd = eol ? eol : end;
+            parseSmoothing(p, lineEnd);
+            p = eol ? eol + 1 : end;
+        }
+        m_scanned = p;
+    }
+
+    // Como LoadObj: "s off" o un numero negativo = 0
+    void parseSmoothing(const char* line, const char* end) {
+        while (line < end && (*line == ' ' || *line == '\t')) line++;
+        if (end - line < 2 || line[0] != 's' || (line[1] != ' ' && line[1] != '\t')) return;
+        line += 2;
+        while (line < end && (*line == ' ' || *line == '\t')) line++;
+        if (line == end || *line == '\r') return;
+        if (end - line >= 3 && std::strncmp(line, "off", 3) == 0) {
+            m_smoothingGroup = 0;
+            return;
+        }
+        bool negative = *line == '-';
+        if (*line == '-' || *line == '+') line++;
+        unsigned int value = 0;
+        while (line < end && *line >= '0' && *line <= '9') value = value * 10 + (unsigned int)(*line++ - '0');
+        m_smoothingGroup = negative ? 0 : value;
+    }
+
+    std::istream& m_file;
+    std::pmr::vector<char> m_block;
+    const char* m_scanned = nullptr;
+    char m_newline = '\n';
+    bool m_firstBlock = true;
+    bool m_skipLine = false;
+    unsigned int m_smoothingGroup = 0;
+};
+
+// Estado que reciben los callbacks de tinyobj
+struct ObjParser {
+    ObjData& obj;
+    ObjReader& reader;
+    std::string& warn;
+    int material = -1;
+    bool badIndex = false;
+
+    // 'g' u 'o': si el shape actual no tiene caras se reutiliza, como hace LoadObj al descartarlo
+    void beginShape(std::string_view name) {
+        if (obj.shapes.back().faceCount > 0) {
+            ObjShape shape;
+            shape.firstFace = obj.faces.size();
+            shape.firstCorner = obj.corners.size();
+            obj.shapes.push_back(shape);
+        }
+        ObjShape& shape = obj.shapes.back();
+        shape.nameOffset = obj.names.size();
+        shape.nameLength = name.size();
+        obj.names.append(name);
+    }
+};
+
+// Indice de un 'f' a base 0 como fixIndex de tinyobj (negativo = relativo al final).
+// 0 pasa a -1; para la posicion es un error
+int fixIndex(int index, size_t count) {
+    if (index > 0) return index - 1;
+    if (index == 0) return -1;
+    return (int)count + index;
+}
+
+} // namespace
+
+ObjData::ObjData(std::pmr::memory_resource* resource)
+    : positions(resource), normals(resource), texcoords(resource), corners(resource),
+      faces(resource), shapes(resource), names(resource) {}
+
+size_t ObjData::triangleCount() const {
+    size_t total = 0;
+    for (const ObjFace& face : faces) total += face.count - 2;
+    return total;
+}
+
+bool parseOBJ(const std::string& fullPath, ObjData& obj, std::string& warn, std::string& err) {
+    PROFILE_SCOPE("tinyobj::LoadObjWithCallback");
+    for (auto* a : { &obj.positions, &obj.normals, &obj.texcoords }) a->clear();
+    obj.corners.clear();
+    obj.faces.clear();
+    obj.maxPositionIndex = -1;
+    obj.shapes.clear();
+    obj.names.clear();
+    obj.materials.clear();
+    std::ifstream file(fullPath, std::ios::binary);
+    if (!file.is_open()) {
+        err += "Cannot open file [" + fullPath + "]\n";
+        return false;
+    }
+    ObjReader reader(file, obj.resource());
+    std::istream stream(&reader);
+    ObjParser parser{ obj, reader, warn };
+    obj.shapes.push_back(ObjShape());
+
+    tinyobj::callback_t callbacks;
+    callbacks.vertex_cb = [](void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+        auto& positions = static_cast<ObjParser*>(user)->obj.positions;
+        positions.push_back(x);
+        positions.push_back(y);
+        positions.push_back(z);
+    };
+    callbacks.normal_cb = [](void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z) {
+        auto& normals = static_cast<ObjParser*>(user)->obj.normals;
+        normals.push_back(x);
+        normals.push_back(y);
+        normals.push_back(z);
+    };
+    callbacks.texcoord_cb = [](void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t) {
+        auto& texcoords = static_cast<ObjParser*>(user)->obj.texcoords;
+        texcoords.push_back(x);
+        texcoords.push_back(y);
+    };
+    callbacks.index_cb = [](void* user, tinyobj::index_t* indices, int count) {
+        ObjParser& p = *static_cast<ObjParser*>(user);
+        ObjData& obj = p.obj;
+        p.reader.scanTo();
+        if (p.badIndex) return;
+        if (count < 3) {
+            p.warn += "Degenerated face found\n.";
+            return;
+        }
+        const size_t first = obj.corners.size();
+        for (int k = 0; k < count; k++) {
+            tinyobj::index_t index;
+            index.vertex_index = fixIndex(indices[k].vertex_index, obj.positions.size() / 3);
+            index.normal_index = fixIndex(indices[k].normal_index, obj.normals.size() / 3);
+            index.texcoord_index = fixIndex(indices[k].texcoord_index, obj.texcoords.size() / 2);
+            // Igual que LoadObj: posicion 0 o cualquier relativo antes del inicio cortan la lectura
+            if (index.vertex_index < 0 || (indices[k].normal_index < 0 && index.normal_index < 0) ||
+                (indices[k].texcoord_index < 0 && index.texcoord_index < 0)) {
+                p.badIndex = true;
+                obj.corners.resize(first);
+                return;
+            }
+            obj.maxPositionIndex = std::max(obj.maxPositionIndex, index.vertex_index);
+            obj.corners.push_back(index);
+        }
+        ObjFace face;
+        face.count = (unsigned int)count;
+        face.material = p.material;
+        face.smoothingGroup = p.reader.smoothingGroup();
+        obj.faces.push_back(face);
+        obj.shapes.back().faceCount++;
+    };
+    callbacks.usemtl_cb = [](void* user, const char* name, int) {
+        // tinyobj pasa el resto de la linea; LoadObj usa solo la primera palabra
+        ObjParser& p = *static_cast<ObjParser*>(user);
+        std::string_view id(name);
+        id.remove_prefix(std::min(id.find_first_not_of(" \t"), id.size()));
+        id = id.substr(0, id.find_first_of(" \t"));
+        // Con nombres repetidos en el MTL gana el primero, como en el mapa de LoadMtl
+        p.material = -1;
+        for (size_t i = 0; i < p.obj.materials.size(); i++) {
+            if (p.obj.materials[i].name == id) {
+                p.material = (int)i;
+                break;
+            }
+        }
+        if (p.material < 0) p.warn += "material [ '" + std::string(id) + "' ] not found in .mtl\n";
+    };
+    callbacks.mtllib_cb = [](void* user, const tinyobj::material_t* materials, int count) {
+        static_cast<ObjParser*>(user)->obj.materials.assign(materials, materials + count);
+    };
+    callbacks.group_cb = [](void* user, const char** names, int count) {
+        // Los nombres de un 'g' se unen con espacios, como en LoadObj
+        ObjParser& p = *static_cast<ObjParser*>(user);
+        p.beginShape(std::string_view());
+        for (int i = 0; i < count; i++) {
+            if (i > 0) p.obj.names.push_back(' ');
+            p.obj.names.append(names[i]);
+        }
+        ObjShape& shape = p.obj.shapes.back();
+        shape.nameLength = p.obj.names.size() - shape.nameOffset;
+    };
+    callbacks.object_cb = [](void* user, const char* name) {
+        static_cast<ObjParser*>(user)->beginShape(name);
+    };
+
+    std::string baseDir = fullPath.substr(0, fullPath.find_last_of("/\\") + 1);
+    tinyobj::MaterialFileReader materialReader(baseDir);
+    bool ok = tinyobj::LoadObjWithCallback(stream, callbacks, &parser, &materialReader, &warn, &err);
+    if (obj.shapes.back().faceCount == 0) obj.shapes.pop_back();
+    if (parser.badIndex) {
+        err += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index).\n";
+        return false;
+    }
+    return ok;
+}
+
+void VertexStreams::clear() {
+    for (auto* a : { &px, &py, &pz, &nx, &ny, &nz, &u, &v }) a->clear();
+    tangent.clear();
+}
+
+void VertexStreams::reserve(size_t n) {
+    for (auto* a : { &px, &py, &pz, &nx, &ny, &nz, &u, &v }) a->reserve(n);
+    tangent.reserve(n);
+}
+
+void VertexStreams::resize(size_t n) {
+    for (auto* a : { &px, &py, &pz, &nx, &ny, &nz, &u, &v }) a->resize(n, 0.0f);
+    tangent.resize(n, 0u);
+}
+
+void VertexStreams::interleave(size_t first, size_t count, Vertex* out) const {
+    for (size_t i = 0; i < count; i++) {
+        size_t s = first + i;
+        out[i].Position = glm::vec3(px[s], py[s], pz[s]);
+        out[i].Normal = glm::vec3(nx[s], ny[s], nz[s]);
+        out[i].TexCoords = glm::vec2(u[s], v[s]);
+        out[i].Tangent = tangent[s];
+    }
+}
+
+namespace {
+
+bool validCorner(const ObjData& obj, const tinyobj::index_t& corner) {
+    return corner.vertex_index >= 0 && 3 * (size_t)corner.vertex_index + 2 < obj.positions.size();
+}
+
+// Triangulos y cuadrilateros como exportGroupsToShape de tinyobj, sin memoria extra:
+// escribe hasta 6 esquinas en out y devuelve los triangulos (0 = cara invalida)
+unsigned int triangulateQuad(const ObjData& obj, const tinyobj::index_t* corners, unsigned int count, tinyobj::index_t* out) {
+    for (unsigned int k = 0; k < count; k++) {
+        if (!validCorner(obj, corners[k])) return 0;
+    }
+    if (count == 3) {
+        std::copy(corners, corners + 3, out);
+        return 1;
+    }
+    // Se corta por la diagonal mas corta
+    const float* v0 = &obj.positions[3 * (size_t)corners[0].vertex_index];
+    const float* v1 = &obj.positions[3 * (size_t)corners[1].vertex_index];
+    const float* v2 = &obj.positions[3 * (size_t)corners[2].vertex_index];
+    const float* v3 = &obj.positions[3 * (size_t)corners[3].vertex_index];
+    float e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+    float e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+    float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+    float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+    static const int split02[6] = { 0, 1, 2, 0, 2, 3 };
+    static const int split13[6] = { 0, 1, 3, 1, 2, 3 };
+    const int* order = sqr02 < sqr13 ? split02 : split13;
+    for (int k = 0; k < 6; k++) out[k] = corners[order[k]];
+    return 2;
+}
+
+// Poligonos de 5 o mas lados: el recorte de orejas de tinyobj sobre una copia de sus
+// posiciones. Son raros, asi que sus temporales van al heap. Agrega las esquinas a out
+unsigned int triangulatePolygon(const ObjData& obj, const tinyobj::index_t* corners, unsigned int count, std::pmr::vector<tinyobj::index_t>& out) {
+    std::vector<tinyobj::real_t> positions(3 * (size_t)count);
+    tinyobj::PrimGroup group;
+    group.faceGroup.resize(1);
+    for (unsigned int k = 0; k < count; k++) {
+        if (!validCorner(obj, corners[k])) return 0;
+        std::copy_n(&obj.positions[3 * (size_t)corners[k].vertex_index], 3, &positions[3 * k]);
+        group.faceGroup[0].vertex_indices.push_back(tinyobj::vertex_index_t((int)k));
+    }
+    tinyobj::shape_t shape;
+    tinyobj::exportGroupsToShape(&shape, group, std::vector<tinyobj::tag_t>(), -1, std::string(), true, positions, nullptr);
+    for (const tinyobj::index_t& index : shape.mesh.indices) out.push_back(corners[index.vertex_index]);
+    return (unsigned int)(shape.mesh.indices.size() / 3);
+}
+
+} // namespace
+
+void flattenOBJ(const ObjData& obj, int modelIndex, VertexStreams& vertices, std::vector<SubMesh>& subMeshes,
+    std::vector<Material>& materials, std::vector<MaterialRange>& ranges, std::vector<unsigned int>* smoothingGroups) {
+    PROFILE_FUNCTION();
+    const int fileMaterials = (int)obj.materials.size();
+    const int materialBase = (int)materials.size();
+    materials.reserve(materials.size() + fileMaterials + 1);
+    for (const auto& m : obj.materials) {
+        Material mat;
+        mat.name = m.name;
+        mat.diffuseColor = glm::vec3(m.diffuse[0], m.diffuse[1], m.diffuse[2]);
+        mat.diffuseMap = m.diffuse_texname;
+        // tinyobj deja map_Bump/bump en bump_texname y norm en normal_texname
+        mat.normalMap = !m.normal_texname.empty() ? m.normal_texname : m.bump_texname;
+        materials.push_back(mat);
+    }
+    std::pmr::memory_resource* scratch = obj.resource();
+    // Cada cara da count - 2 triangulos, salvo las que tienen posiciones fuera de rango
+    // (0) y los poligonos de 5+ lados (el recorte de orejas puede dar menos). Solo si el
+    // archivo tiene alguna de esas se guarda el numero por cara, y las esquinas de los
+    // poligonos quedan en polygonCorners en el orden de las caras
+    const bool allValid = obj.maxPositionIndex < (int)(obj.positions.size() / 3);
+    size_t triangles = 0;
+    bool irregular = !allValid;
+    for (const ObjFace& face : obj.faces) {
+        triangles += face.count - 2;
+        irregular |= face.count > 4;
+    }
+    std::pmr::vector<unsigned int> faceTriangles(scratch);
+    std::pmr::vector<tinyobj::index_t> polygonCorners(scratch);
+    tinyobj::index_t quad[6];
+    if (irregular) {
+        faceTriangles.resize(obj.faces.size());
+        triangles = 0;
+        for (size_t f = 0, corner = 0; f < obj.faces.size(); f++) {
+            const unsigned int count = obj.faces[f].count;
+            const tinyobj::index_t* corners = obj.corners.data() + corner;
+            if (count == 3) faceTriangles[f] = allValid || (validCorner(obj, corners[0]) && validCorner(obj, corners[1]) && validCorner(obj, corners[2])) ? 1 : 0;
+            else if (count == 4) faceTriangles[f] = triangulateQuad(obj, corners, count, quad);
+            else faceTriangles[f] = triangulatePolygon(obj, corners, count, polygonCorners);
+            triangles += faceTriangles[f];
+            corner += count;
+        }
+    }
+    auto trianglesOf = [&](size_t f) { return irregular ? faceTriangles[f] : obj.faces[f].count - 2; };
+    // Gris para las caras sin material (o con un id fuera del MTL); se agrega si hace falta
+    int defaultMaterial = -1;
+    // Una sola reserva para todas las esquinas del modelo
+    size_t out = vertices.size();
+    vertices.resize(out + 3 * triangles);
+    subMeshes.reserve(subMeshes.size() + obj.shapes.size());
+    size_t triangleBase = 0;
+    if (smoothingGroups) {
+        triangleBase = smoothingGroups->size();
+        smoothingGroups->resize(triangleBase + triangles, 0);
+    }
+    const float* positions = obj.positions.data();
+    const float* normals = obj.normals.data();
+    const float* texcoords = obj.texcoords.data();
+    // Un indice fuera de rango cuenta como "sin normal" o "sin uv"
+    const size_t normalCount = obj.normals.size() / 3;
+    const size_t texcoordCount = obj.texcoords.size() / 2;
+    auto writeCorner = [&](size_t dst, const tinyobj::index_t& index) {
+        // Posicion
+        const float* p = positions + 3 * (size_t)index.vertex_index;
+        vertices.px[dst] = p[0];
+        vertices.py[dst] = p[1];
+        vertices.pz[dst] = p[2];
+        // Normales (sin normal quedan en cero, como dejo resize)
+        if ((size_t)index.normal_index < normalCount) {
+            const float* n = normals + 3 * (size_t)index.normal_index;
+            vertices.nx[dst] = n[0];
+            vertices.ny[dst] = n[1];
+            vertices.nz[dst] = n[2];
+        }
+        if ((size_t)index.texcoord_index < texcoordCount) {
+            const float* t = texcoords + 2 * (size_t)index.texcoord_index;
+            vertices.u[dst] = t[0];
+            vertices.v[dst] = t[1];
+        }
+    };
+    // Un cubo por material del archivo mas el de "sin material"; se reutiliza en cada shape
+    std::pmr::vector<unsigned int> cursor(fileMaterials + 1, scratch);
+    auto bucketOf = [&](const ObjFace& face) {
+        return (face.material >= 0 && face.material < fileMaterials) ? face.material : fileMaterials;
+    };
+    size_t polygonCorner = 0;
+    for (const ObjShape& shape : obj.shapes) {
+        const size_t firstFace = shape.firstFace;
+        const size_t lastFace = shape.firstFace + shape.faceCount;
+        // 1) Triangulos por material
+        std::fill(cursor.begin(), cursor.end(), 0u);
+        size_t shapeTriangles = 0;
+        for (size_t f = firstFace; f < lastFace; f++) {
+            const unsigned int count = trianglesOf(f);
+            cursor[bucketOf(obj.faces[f])] += count;
+            shapeTriangles += count;
+        }
+        // LoadObj descarta los shapes sin triangulos
+        if (shapeTriangles == 0) continue;
+        SubMesh subMesh;
+        subMesh.name = std::string(obj.shapeName(shape));
+        subMesh.model = modelIndex;
+        subMesh.firstVertex = (unsigned int)out;
+        subMesh.indexCount = (unsigned int)(shapeTriangles * 3);
+        subMesh.firstRange = (unsigned int)ranges.size();
+        // 2) Un rango por material usado; cursor pasa a ser el proximo triangulo libre del cubo
+        unsigned int first = 0;
+        for (int b = 0; b <= fileMaterials; b++) {
+            unsigned int count = cursor[b];
+            cursor[b] = first;
+            if (count == 0) continue;
+            int material = materialBase + b;
+            if (b == fileMaterials) {
+                if (defaultMaterial < 0) {
+                    defaultMaterial = (int)materials.size();
+                    Material gray;
+                    gray.name = "default";
+                    gray.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
+                    materials.push_back(gray);
+                }
+                material = defaultMaterial;
+            }
+            ranges.push_back(MaterialRange{ (int)subMeshes.size(), material, (unsigned int)(out + 3 * (size_t)first), 3 * count });
+            first += count;
+        }
+        subMesh.rangeCount = (unsigned int)ranges.size() - subMesh.firstRange;
+        // 3) Cada cara a su lugar; dentro de un material se conserva el orden del archivo
+        size_t corner = shape.firstCorner;
+        for (size_t f = firstFace; f < lastFace; f++) {
+            const ObjFace& face = obj.faces[f];
+            const tinyobj::index_t* corners = obj.corners.data() + corner;
+            corner += face.count;
+            const unsigned int count = trianglesOf(f);
+            if (count == 0) continue;
+            const tinyobj::index_t* tri = corners;
+            if (face.count == 4) {
+                triangulateQuad(obj, corners, face.count, quad);
+                tri = quad;
+            } else if (face.count > 4) {
+                tri = polygonCorners.data() + polygonCorner;
+                polygonCorner += 3 * (size_t)count;
+            }
+            size_t slot = cursor[bucketOf(face)];
+            cursor[bucketOf(face)] += count;
+            for (size_t t = 0; t < count; t++) {
+                size_t dst = out + 3 * (slot + t);
+                for (size_t k = 0; k < 3; k++) writeCorner(dst + k, tri[3 * t + k]);
+                if (smoothingGroups) (*smoothingGroups)[triangleBase + slot + t] = face.smoothingGroup;
+            }
+        }
+        out += shapeTriangles * 3;
+        triangleBase += shapeTriangles;
+        subMeshes.push_back(std::move(subMesh));
+    }
+}
+
+void computeFlatNormals(VertexStreams& vertices) {
+    PROFILE_FUNCTION();
+    const float* px = vertices.px.data();
+    const float* py = vertices.py.data();
+    const float* pz = vertices.pz.data();
+    float* nx = vertices.nx.data();
+    float* ny = vertices.ny.data();
+    float* nz = vertices.nz.data();
+    for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+        // Si la normal ya existe se respeta. Si es cero, calculamos.
+        if (nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i] >= 0.0001f) continue;
+        float e1x = px[i + 1] - px[i], e1y = py[i + 1] - py[i], e1z = pz[i + 1] - pz[i];
+        float e2x = px[i + 2] - px[i], e2y = py[i + 2] - py[i], e2z = pz[i + 2] - pz[i];
+        float cx = e1y * e2z - e1z * e2y;
+        float cy = e1z * e2x - e1x * e2z;
+        float cz = e1x * e2y - e1y * e2x;
+        float len = std::sqrt(cx * cx + cy * cy + cz * cz);
+        // Triangulo degenerado: normal hacia arriba en vez de NaN
+        if (len > 0.0f) { cx /= len; cy /= len; cz /= len; }
+        else { cx = 0.0f; cy = 1.0f; cz = 0.0f; }
+        for (size_t k = i; k < i + 3; k++) {
+            nx[k] = cx;
+            ny[k] = cy;
+            nz[k] = cz;
+        }
+    }
+}
+
+size_t normalLineFloats(const std::vector<Model>& models) {
+    size_t total = 0;
+    for (const auto& m : models) total += m.vertexCount;
+    return total * 6;
+}
+
+void buildNormalLines(const VertexStreams& vertices, const std::vector<Model>& models, float lengthPercent, float* out) {
+    PROFILE_FUNCTION();
+    float* o = out;
+    const float* px = vertices.px.data();
+    const float* py = vertices.py.data();
+    const float* pz = vertices.pz.data();
+    const float* nx = vertices.nx.data();
+    const float* ny = vertices.ny.data();
+    const float* nz = vertices.nz.data();
+    for (const auto& m : models) {
+        const float len = m.boundingBoxDiagonal * lengthPercent;
+        const size_t end = (size_t)m.firstVertex + m.vertexCount;
+        // Punto inicio y punto fin por vertice
+        for (size_t i = m.firstVertex; i < end; i++, o += 6) {
+            o[0] = px[i];
+            o[1] = py[i];
+            o[2] = pz[i];
+            o[3] = px[i] + nx[i] * len;
+            o[4] = py[i] + ny[i] * len;
+            o[5] = pz[i] + nz[i] * len;
+        }
+    }
+}
+
+bool writeOBJ(const std::string& filename, const VertexStreams& vertices, const std::vector<SubMesh>& subMeshes,
+    const std::vector<Material>& materials, const std::vector<MaterialRange>& ranges, size_t modelCount, const SceneGraph& scene) {
+    PROFILE_FUNCTION();
+    std::string mtlFilename = filename.substr(0, filename.find_last_of('.')) + ".mtl";
+    std::string mtlNameOnly = mtlFilename.substr(mtlFilename.find_last_of("/\\") + 1);
+    std::filesystem::path mtlDir = std::filesystem::absolute(mtlFilename).parent_path();
+    std::ofstream outObj(filename);
+    std::ofstream outMtl(mtlFilename);
+    if (!outObj.is_open() || !outMtl.is_open()) return false;
+    outObj << "# Exportado por C3DViewer\n";
+    outObj << "mtllib " << mtlNameOnly << "\n";
+    // Materiales de los sub-mallados visibles, cada uno una vez
+    std::vector<std::string> matNames(materials.size());
+    for (const auto& sub : subMeshes) {
+        if (!sub.visible) continue;
+        for (unsigned int r = sub.firstRange; r < sub.firstRange + sub.rangeCount; r++) {
+            std::string& matName = matNames[ranges[r].material];
+            if (!matName.empty()) continue;
+            const Material& mat = materials[ranges[r].material];
+            // Con varios modelos el nombre del material puede repetirse
+            matName = modelCount > 1 ? "Mat_" + std::to_string(ranges[r].material) + "_" + mat.name : "Mat_" + mat.name;
+            std::replace(matName.begin(), matName.end(), ' ', '_');
+            outMtl << "newmtl " << matName << "\n";
+            outMtl << "Kd " << mat.diffuseColor.r << " " << mat.diffuseColor.g << " " << mat.diffuseColor.b << "\n";
+            if (!mat.diffuseMap.empty()) {
+                std::error_code ec;
+                std::filesystem::path map = std::filesystem::proximate(mat.diffuseMap, mtlDir, ec);
+                outMtl << "map_Kd " << (ec ? mat.diffuseMap : map.generic_string()) << "\n";
+            }
+            if (!mat.normalMap.empty()) {
+                std::error_code ec;
+                std::filesystem::path map = std::filesystem::proximate(mat.normalMap, mtlDir, ec);
+                outMtl << "map_Bump " << (ec ? mat.normalMap : map.generic_string()) << "\n";
+            }
+            outMtl << "Ka 0.1 0.1 0.1\nKs 0.5 0.5 0.5\nNs 32\nd 1.0\nillum 2\n\n";
+        }
+    }
+    int vertexOffset = 1;
+    // Posiciones y normales ya transformadas del sub-mallado actual
+    std::vector<float> pos[3], nor[3];
+    for (const auto& sub : subMeshes) {
+        if (!sub.visible) continue;
+        outObj << "g " << sub.name << "\n";
+        // Matrices
+        const glm::mat4& m = scene.world(sub.node);
+        // Para normales
+        const glm::mat3& nm = scene.normalMatrix(sub.node);
+        // Transformar el sub-mallado entero de una vez (bucle vectorizable sobre los arreglos)
+        const size_t first = sub.firstVertex;
+        const int count = (int)sub.indexCount;
+        for (auto* a : { &pos[0], &pos[1], &pos[2], &nor[0], &nor[1], &nor[2] }) a->resize(count);
+        for (int k = 0; k < count; k++) {
+            float x = vertices.px[first + k], y = vertices.py[first + k], z = vertices.pz[first + k];
+            pos[0][k] = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+            pos[1][k] = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+            pos[2][k] = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+            float a = vertices.nx[first + k], b = vertices.ny[first + k], c = vertices.nz[first + k];
+            float tx = nm[0][0] * a + nm[1][0] * b + nm[2][0] * c;
+            float ty = nm[0][1] * a + nm[1][1] * b + nm[2][1] * c;
+            float tz = nm[0][2] * a + nm[1][2] * b + nm[2][2] * c;
+            float inv = 1.0f / std::sqrt(tx * tx + ty * ty + tz * tz);
+            nor[0][k] = tx * inv;
+            nor[1][k] = ty * inv;
+            nor[2][k] = tz * inv;
+        }
+        // Escribir Vertices y Normales
+        for (int k = 0; k < count; k++) {
+            outObj << "v " << pos[0][k] << " " << pos[1][k] << " " << pos[2][k] << "\n";
+            outObj << "vn " << nor[0][k] << " " << nor[1][k] << " " << nor[2][k] << "\n";
+        }
+        // Escribir Caras, un usemtl por rango
+        for (unsigned int r = sub.firstRange; r < sub.firstRange + sub.rangeCount; r++) {
+            const MaterialRange& range = ranges[r];
+            outObj << "usemtl " << matNames[range.material] << "\n";
+            int begin = (int)(range.firstVertex - sub.firstVertex);
+            for (int i = begin; i < begin + (int)range.vertexCount; i += 3) {
+                unsigned int i1 = vertexOffset + i;
+                unsigned int i2 = vertexOffset + i + 1;
+                unsigned int i3 = vertexOffset + i + 2;
+                outObj << "f " << i1 << "//" << i1 << " " << i2 << "//" << i2 << " " << i3 << "//" << i3 << "\n";
+            }
+        }
+        vertexOffset += count;
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cfloat>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include "tiny_obj_loader.h"
+#include "SceneGraph.h"
+
+// Etapas CPU de la malla (carga, normales, exportacion) sin contexto GL:
+// las usan el visor y el ejecutable de microbenchmarks (MeshBench).
+
+// Formato intercalado del VBO: solo se arma al subir a la GPU
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    // Tangente empaquetada 2_10_10_10 (xyz normalizados, w = signo de la bitangente)
+    uint32_t Tangent;
+};
+
+// Reserva alineada a 32 bytes (carga SSE/AVX alineada al inicio de cada arreglo)
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static const size_t kAlignment = 32;
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(kAlignment))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(kAlignment)); }
+    template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Vertices de la escena en memoria: un arreglo por componente (SoA), asi las pasadas
+// CPU leen solo lo que usan y los bucles se vectorizan de a 4/8 vertices.
+struct VertexStreams {
+    AlignedVector<float> px, py, pz;
+    AlignedVector<float> nx, ny, nz;
+    AlignedVector<float> u, v;
+    // Tangentes empaquetadas (ver packTangent en TangentGenerator.h); 0 = sin tangente
+    AlignedVector<uint32_t> tangent;
+
+    size_t size() const { return px.size(); }
+    bool empty() const { return px.empty(); }
+    // Bytes por vertice sumando todos los arreglos
+    static size_t bytesPerVertex() { return 8 * sizeof(float) + sizeof(uint32_t); }
+    void clear();
+    void reserve(size_t n);
+    void resize(size_t n);
+    glm::vec3 position(size_t i) const { return glm::vec3(px[i], py[i], pz[i]); }
+    glm::vec3 normal(size_t i) const { return glm::vec3(nx[i], ny[i], nz[i]); }
+    void setNormal(size_t i, const glm::vec3& n) { nx[i] = n.x; ny[i] = n.y; nz[i] = n.z; }
+    // Intercala [first, first + count) en out[0, count) para el VBO
+    void interleave(size_t first, size_t count, Vertex* out) const;
+};
+
+// Material del MTL (color difuso, su textura y el mapa de normales). Los de todos los modelos
+// comparten un arreglo; las caras sin material usan uno gris por modelo.
+struct Material {
+    std::string name;
+    glm::vec3 diffuseColor = glm::vec3(0.7f);
+    // map_Kd tal como viene en el MTL; el visor la cambia por la ruta resuelta
+    std::string diffuseMap;
+    // Id en la cache de texturas del visor (-1 = sin textura)
+    int diffuseTexture = -1;
+    // Mapa de normales en espacio tangente (norm, o map_Bump si no hay norm)
+    std::string normalMap;
+    int normalTexture = -1;
+};
+
+// Caras contiguas de un sub-mallado con un mismo material. flattenOBJ ordena las
+// caras de cada shape por material: un rango por material usado, en orden de material.
+struct MaterialRange {
+    int subMesh = -1;
+    int material = -1;
+    unsigned int firstVertex = 0;
+    unsigned int vertexCount = 0;
+};
+
+struct SubMesh {
+    std::string name;
+    // Vertices [firstVertex, firstVertex + indexCount) dentro de m_vertices
+    // (VBO compartido por todos los modelos, sin indexar)
+    unsigned int indexCount = 0;
+    unsigned int firstVertex = 0;
+    int model = -1;
+    int node = -1;
+    // Rangos por material [firstRange, firstRange + rangeCount), cubren todo el sub-mallado
+    unsigned int firstRange = 0;
+    unsigned int rangeCount = 0;
+    bool visible = true;
+    // Caja alineada en espacio local del sub-mallado
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+};
+
+struct Model {
+    std::string name;
+    // Nodo del modelo (TRS del usuario) y grupo de normalizacion (escala + centrado)
+    int node = -1;
+    int normalizeNode = -1;
+    unsigned int firstSubMesh = 0;
+    unsigned int subMeshCount = 0;
+    unsigned int firstVertex = 0;
+    unsigned int vertexCount = 0;
+    unsigned int firstMaterial = 0;
+    unsigned int materialCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float scaleFactor = 1.0f;
+    float boundingBoxDiagonal = 1.0f;
+    glm::vec3 homePosition = glm::vec3(0.0f, 0.0f, -3.0f);
+    // Animacion de giro (turntable) sobre el grupo de normalizacion, en grados
+    bool spinning = false;
+    float spinAngle = 0.0f;
+    float prevSpinAngle = 0.0f;
+};
+
+// Cara del OBJ tal como viene en el archivo: un poligono de 'count' esquinas
+struct ObjFace {
+    unsigned int count = 0;
+    // Material del archivo (-1 = sin usemtl o fuera del MTL) y grupo 's' (0 = sin suavizado)
+    int material = -1;
+    unsigned int smoothingGroup = 0;
+};
+
+// Caras de un mismo 'g' u 'o' (lo que tinyobj::LoadObj devuelve como shape_t)
+struct ObjShape {
+    size_t firstFace = 0;
+    size_t faceCount = 0;
+    size_t firstCorner = 0;
+    // Nombre dentro de ObjData::names
+    size_t nameOffset = 0;
+    size_t nameLength = 0;
+};
+
+// Salida de parseOBJ. Todo lo que crece con la malla vive en el memory_resource del
+// constructor (la arena de carga en el visor y en MeshBench); solo los materiales del
+// MTL quedan en el heap.
+struct ObjData {
+    explicit ObjData(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    std::pmr::vector<float> positions;  // xyz
+    std::pmr::vector<float> normals;    // xyz
+    std::pmr::vector<float> texcoords;  // uv
+    // Esquinas de todas las caras en orden, con indices base 0 (-1 = sin normal o uv)
+    std::pmr::vector<tinyobj::index_t> corners;
+    std::pmr::vector<ObjFace> faces;
+    // Mayor indice de posicion de las esquinas: si es valido, flattenOBJ no revisa cada cara
+    int maxPositionIndex = -1;
+    std::pmr::vector<ObjShape> shapes;
+    // Nombres de los shapes, uno detras de otro
+    std::pmr::string names;
+    std::vector<tinyobj::material_t> materials;
+
+    std::pmr::memory_resource* resource() const { return corners.get_allocator().resource(); }
+    std::string_view shapeName(const ObjShape& shape) const { return std::string_view(names).substr(shape.nameOffset, shape.nameLength); }
+    // Triangulos de todas las caras (count - 2 por cara)
+    size_t triangleCount() const;
+};
+
+// Lee el OBJ con la API de callbacks de tinyobj (sin un face_t por cara como LoadObj).
+// Los indices quedan resueltos como en LoadObj; la triangulacion la hace flattenOBJ
+bool parseOBJ(const std::string& fullPath, ObjData& obj, std::string& warn, std::string& err);
+// Triangula cada cara igual que tinyobj::LoadObj (cuadrilateros por la diagonal mas
+// corta, poligonos mayores por recorte de orejas) y aplana cada shape en vertices sin
+// indexar (uno por esquina). Agrega sus sub-mallados (sin limites: los calcula
+// computeBounds de Bounds.h), los materiales del archivo y los rangos por material. Las
+// caras de cada shape se ordenan por material (counting sort estable), asi cada material
+// del shape queda en un solo rango contiguo. Los temporales van al resource de obj.
+// smoothingGroups (opcional) recibe el grupo 's' de cada triangulo agregado
+void flattenOBJ(const ObjData& obj, int modelIndex, VertexStreams& vertices, std::vector<SubMesh>& subMeshes,
+    std::vector<Material>& materials, std::vector<MaterialRange>& ranges, std::vector<unsigned int>* smoothingGroups = nullptr);
+// Normal de cara para los triangulos que no traen normal
+void computeFlatNormals(VertexStreams& vertices);
+// Floats que escribe buildNormalLines para estos modelos
+size_t normalLineFloats(const std::vector<Model>& models);
+// Dos puntos (inicio, fin) por vertice; largo relativo a la diagonal de cada modelo.
+// out debe tener lugar para normalLineFloats(models) (el visor lo saca de la arena del frame)
+void buildNormalLines(const VertexStreams& vertices, const std::vector<Model>& models, float lengthPercent, float* out);
+// Escribe OBJ + MTL con las matrices de mundo del grafo (ya actualizado); un usemtl por rango.
+// Las texturas se escriben relativas al MTL nuevo
+bool writeOBJ(const std::string& filename, const VertexStreams& vertices, const std::vector<SubMesh>& subMeshes,
+    const std::vector<Material>& materials, const std::vector<MaterialRange>& ranges, size_t modelCount, const SceneGraph& scene);
@@ -0,0 +1,229 @@
+#include "NormalGenerator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NORMALS_SSE 1
+#else
+#define NORMALS_SSE 0
+#endif
+
+namespace {
+
+// Bits de la posicion (sin distinguir -0 de 0) para soldar por igualdad exacta
+struct PositionKey {
+    uint32_t x, y, z;
+    bool operator<(const PositionKey& o) const {
+        if (x != o.x) return x < o.x;
+        if (y != o.y) return y < o.y;
+        return z < o.z;
+    }
+    bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+uint32_t floatBits(float f) {
+    if (f == 0.0f) return 0;
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+PositionKey makeKey(const float* px, const float* py, const float* pz, size_t i) {
+    return PositionKey{ floatBits(px[i]), floatBits(py[i]), floatBits(pz[i]) };
+}
+
+uint64_t hashKey(const PositionKey& k) {
+    uint64_t h = ((uint64_t)k.x * 0x9E3779B185EBCA87ull) ^ ((uint64_t)k.y * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t)k.z * 0x165667B19E3779F9ull);
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+float cornerAngle(const glm::vec3& a, const glm::vec3& b) {
+    float la = glm::length(a), lb = glm::length(b);
+    if (la <= 0.0f || lb <= 0.0f) return 0.0f;
+    return std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+}
+
+} // namespace
+
+void generateNormals(VertexStreams& vertices, size_t first, size_t count, const unsigned int* smoothingGroups,
+    const NormalSettings& settings, NormalStats* stats, std::pmr::memory_resource* scratch) {
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    const size_t triangles = count / 3;
+    const size_t corners = triangles * 3;
+    const float* px = vertices.px.data() + first;
+    const float* py = vertices.py.data() + first;
+    const float* pz = vertices.pz.data() + first;
+    float* nx = vertices.nx.data() + first;
+    float* ny = vertices.ny.data() + first;
+    float* nz = vertices.nz.data() + first;
+    auto position = [&](size_t c) { return glm::vec3(px[c], py[c], pz[c]); };
+    auto setNormal = [&](size_t c, const glm::vec3& n) { nx[c] = n.x; ny[c] = n.y; nz[c] = n.z; };
+
+    // 1) Normal de cara (xyz, w = 0 para cargar con SSE) y peso de cada esquina
+    std::pmr::vector<glm::vec4> faceNormals(triangles, scratch);
+    std::pmr::vector<float> weights(corners, scratch);
+    parallelFor(triangles, 8192, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const glm::vec3 p0 = position(3 * t);
+            const glm::vec3 p1 = position(3 * t + 1);
+            const glm::vec3 p2 = position(3 * t + 2);
+            glm::vec3 c = glm::cross(p1 - p0, p2 - p0);
+            float len = glm::length(c);
+            faceNormals[t] = len > 0.0f ? glm::vec4(c / len, 0.0f) : glm::vec4(0.0f);
+            float area = settings.weightByArea ? 0.5f * len : (len > 0.0f ? 1.0f : 0.0f);
+            float a0 = 1.0f, a1 = 1.0f, a2 = 1.0f;
+            if (settings.weightByAngle) {
+                a0 = cornerAngle(p1 - p0, p2 - p0);
+                a1 = cornerAngle(p2 - p1, p0 - p1);
+                a2 = std::max(0.0f, 3.14159265f - a0 - a1);
+            }
+            weights[3 * t] = a0 * area;
+            weights[3 * t + 1] = a1 * area;
+            weights[3 * t + 2] = a2 * area;
+        }
+    });
+
+    auto fallback = [&](size_t t) {
+        const glm::vec4& n = faceNormals[t];
+        return (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(n);
+    };
+    if (!settings.smooth) {
+        parallelFor(corners, 16384, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) setNormal(c, fallback(c / 3));
+        });
+        if (stats) {
+            stats->triangles = triangles;
+            stats->weldedPositions = corners;
+            stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        return;
+    }
+
+    // 2) Soldar: repartir esquinas en cubetas por hash de la posicion (conteo + prefijos +
+    //    dispersion, cada trozo en su hilo) y ordenar cada cubeta por separado
+    const int bucketBits = 12;
+    const size_t buckets = (size_t)1 << bucketBits;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(workerCount(), corners / 16384));
+    std::pmr::vector<uint32_t> bucketOf(corners, scratch);
+    std::pmr::vector<size_t> counts(chunks * buckets, 0, scratch);
+    ThreadPool::instance().run(chunks, [&](size_t chunk) {
+        size_t* local = &counts[chunk * buckets];
+        for (size_t c = corners * chunk / chunks; c < corners * (chunk + 1) / chunks; c++) {
+            uint32_t b = (uint32_t)(hashKey(makeKey(px, py, pz, c)) >> (64 - bucketBits));
+            bucketOf[c] = b;
+            local[b]++;
+        }
+    });
+    // Desplazamientos: cubeta mayor, trozo menor (la dispersion queda estable)
+    std::pmr::vector<size_t> bucketStart(buckets + 1, 0, scratch);
+    size_t offset = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bucketStart[b] = offset;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            size_t n = counts[chunk * buckets + b];
+            counts[chunk * buckets + b] = offset;
+            offset += n;
+        }
+    }
+    bucketStart[buckets] = offset;
+    std::pmr::vector<uint32_t> order(corners, scratch);
+    ThreadPool::instance().run(chunks, [&](size_t chunk) {
+        size_t* local = &counts[chunk * buckets];
+        for (size_t c = corners * chunk / chunks; c < corners * (chunk + 1) / chunks; c++) {
+            order[local[bucketOf[c]]++] = (uint32_t)c;
+        }
+    });
+    bucketOf = std::pmr::vector<uint32_t>(scratch);
+
+    // Sin 's' en el archivo (todo 0) los grupos se ignoran: si no, todo saldria facetado
+    bool useGroups = false;
+    if (settings.useSmoothingGroups && smoothingGroups) {
+        for (size_t t = 0; t < triangles && !useGroups; t++) useGroups = smoothingGroups[t] != 0;
+    }
+    const float cosCrease = std::cos(glm::radians(glm::clamp(settings.creaseAngle, 0.0f, 180.0f)));
+    const bool everythingSmooth = !useGroups && settings.creaseAngle >= 180.0f;
+    auto compatible = [&](size_t a, size_t b) {
+        size_t ta = a / 3, tb = b / 3;
+        if (ta == tb) return true;
+        if (useGroups) {
+            unsigned int ga = smoothingGroups[ta], gb = smoothingGroups[tb];
+            if (ga == 0 || gb == 0 || ga != gb) return false;
+        }
+        return glm::dot(glm::vec3(faceNormals[ta]), glm::vec3(faceNormals[tb])) >= cosCrease;
+    };
+    auto accumulate = [&](const uint32_t* run, size_t n, size_t self, bool filter) {
+#if NORMALS_SSE
+        __m128 acc = _mm_setzero_ps();
+        for (size_t k = 0; k < n; k++) {
+            size_t d = run[k];
+            if (filter && !compatible(self, d)) continue;
+            __m128 fn = _mm_loadu_ps(&faceNormals[d / 3].x);
+            acc = _mm_add_ps(acc, _mm_mul_ps(fn, _mm_set1_ps(weights[d])));
+        }
+        alignas(16) float out[4];
+        _mm_store_ps(out, acc);
+        return glm::vec3(out[0], out[1], out[2]);
+#else
+        glm::vec3 acc(0.0f);
+        for (size_t k = 0; k < n; k++) {
+            size_t d = run[k];
+            if (filter && !compatible(self, d)) continue;
+            acc += glm::vec3(faceNormals[d / 3]) * weights[d];
+        }
+        return acc;
+#endif
+    };
+    auto finish = [&](const glm::vec3& acc, size_t corner) {
+        float len = glm::length(acc);
+        return len > 1e-20f ? acc / len : fallback(corner / 3);
+    };
+
+    // 3) Por cada posicion soldada, cada esquina promedia las caras compatibles
+    std::atomic<size_t> welded{ 0 };
+    parallelFor(buckets, 16, [&](size_t begin, size_t end) {
+        size_t localWelded = 0;
+        for (size_t b = begin; b < end; b++) {
+            uint32_t* slice = order.data() + bucketStart[b];
+            size_t n = bucketStart[b + 1] - bucketStart[b];
+            std::sort(slice, slice + n, [&](uint32_t a, uint32_t c) {
+                PositionKey ka = makeKey(px, py, pz, a), kc = makeKey(px, py, pz, c);
+                if (ka == kc) return a < c;
+                return ka < kc;
+            });
+            for (size_t i = 0; i < n;) {
+                PositionKey key = makeKey(px, py, pz, slice[i]);
+                size_t j = i + 1;
+                while (j < n && makeKey(px, py, pz, slice[j]) == key) j++;
+                const uint32_t* run = slice + i;
+                size_t runSize = j - i;
+                localWelded++;
+                if (everythingSmooth) {
+                    // Todas las esquinas comparten la misma suma
+                    glm::vec3 acc = accumulate(run, runSize, run[0], false);
+                    for (size_t k = 0; k < runSize; k++) setNormal(run[k], finish(acc, run[k]));
+                }
+                else {
+                    for (size_t k = 0; k < runSize; k++) setNormal(run[k], finish(accumulate(run, runSize, run[k], true), run[k]));
+                }
+                i = j;
+            }
+        }
+        welded += localWelded;
+    });
+    if (stats) {
+        stats->triangles = triangles;
+        stats->weldedPositions = welded;
+        stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
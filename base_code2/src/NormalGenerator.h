@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include "MeshPipeline.h"
+
+struct NormalSettings {
+    // false = normal de cara en cada esquina (facetado)
+    bool smooth = true;
+    // Caras cuyo angulo supera este valor (grados) no se promedian; 180 = todo suave
+    float creaseAngle = 60.0f;
+    // Respetar 's' del OBJ (0/off = facetado; solo se suavizan caras con el mismo id)
+    bool useSmoothingGroups = true;
+    bool weightByArea = true;
+    bool weightByAngle = true;
+};
+
+struct NormalStats {
+    size_t triangles = 0;
+    // Posiciones distintas tras soldar las esquinas
+    size_t weldedPositions = 0;
+    double milliseconds = 0.0;
+};
+
+// Recalcula la normal de cada esquina de vertices[first, first + count), que son
+// triangulos sin indexar (como los deja flattenOBJ). Las esquinas con la misma
+// posicion exacta se sueldan y promedian las normales de cara compatibles.
+// smoothingGroups: un valor por triangulo del rango, o nullptr. Corre en el ThreadPool.
+// scratch: de donde salen los temporales (la arena de carga en el visor)
+void generateNormals(VertexStreams& vertices, size_t first, size_t count, const unsigned int* smoothingGroups,
+    const NormalSettings& settings, NormalStats* stats = nullptr,
+    std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
@@ -0,0 +1,97 @@
+#include "Parallel.h"
+#include "Profiler.h"
+
+namespace {
+// Evita que un lote anidado espere a un pool ocupado por el lote que lo contiene
+thread_local bool t_inPool = false;
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool() {
+    unsigned n = workerCount();
+    for (unsigned i = 1; i < n; i++) m_threads.emplace_back(&ThreadPool::workerMain, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+size_t ThreadPool::work(Batch& batch) {
+    size_t done = 0;
+    for (;;) {
+        size_t i = batch.next.fetch_add(1);
+        if (i >= batch.count) break;
+        (*batch.fn)(i);
+        done++;
+    }
+    return done;
+}
+
+void ThreadPool::run(size_t jobs, const std::function<void(size_t)>& fn) {
+    if (jobs == 0) return;
+    if (t_inPool || jobs == 1 || m_threads.empty()) {
+        for (size_t i = 0; i < jobs; i++) fn(i);
+        return;
+    }
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    dispatch(jobs, fn);
+}
+
+void ThreadPool::runOrInline(size_t jobs, const std::function<void(size_t)>& fn) {
+    if (jobs == 0) return;
+    std::unique_lock<std::mutex> runLock(m_runMutex, std::defer_lock);
+    if (t_inPool || jobs == 1 || m_threads.empty() || !runLock.try_lock()) {
+        for (size_t i = 0; i < jobs; i++) fn(i);
+        return;
+    }
+    dispatch(jobs, fn);
+}
+
+void ThreadPool::dispatch(size_t jobs, const std::function<void(size_t)>& fn) {
+    Batch batch;
+    batch.fn = &fn;
+    batch.count = jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        batch.id = ++m_nextId;
+        m_batch = &batch;
+    }
+    m_wake.notify_all();
+    t_inPool = true;
+    size_t done = work(batch);
+    t_inPool = false;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    batch.finished += done;
+    // El lote vive en esta pila: esperar tambien a que ningun hilo lo siga usando
+    m_done.wait(lock, [&batch]() { return batch.finished == batch.count && batch.workers == 0; });
+    m_batch = nullptr;
+}
+
+void ThreadPool::workerMain() {
+    PROFILE_THREAD_NAME("Pool");
+    t_inPool = true;
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this, seen]() { return m_stop || (m_batch && m_batch->id != seen); });
+        if (m_stop) return;
+        Batch* batch = m_batch;
+        seen = batch->id;
+        batch->workers++;
+        lock.unlock();
+        size_t done = work(*batch);
+        lock.lock();
+        batch->finished += done;
+        batch->workers--;
+        if (batch->finished == batch->count && batch->workers == 0) m_done.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de hilos persistente para trabajo de carga. El hilo que llama a run()
+// tambien trabaja, asi que el pool tiene workerCount()-1 hilos. Un lote a la
+// vez: si dos hilos llaman a run(), el segundo espera. Llamar a run() desde un
+// trabajo del pool ejecuta el lote anidado en linea. El trabajo de frame usa
+// runOrInline(), que no espera a un lote de carga en curso.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+    unsigned size() const { return (unsigned)m_threads.size() + 1; }
+    // Llama fn(i) para i en [0, jobs) y bloquea hasta que terminen todos
+    void run(size_t jobs, const std::function<void(size_t)>& fn);
+    // Como run(), pero si el pool esta ocupado hace el lote entero en este hilo
+    void runOrInline(size_t jobs, const std::function<void(size_t)>& fn);
+private:
+    struct Batch {
+        const std::function<void(size_t)>* fn = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{ 0 };
+        // Protegidos por m_mutex
+        size_t finished = 0;
+        int workers = 0;
+        unsigned long long id = 0;
+    };
+    ThreadPool();
+    ~ThreadPool();
+    void workerMain();
+    static size_t work(Batch& batch);
+    // Reparte el lote en el pool; m_runMutex ya tomado
+    void dispatch(size_t jobs, const std::function<void(size_t)>& fn);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    Batch* m_batch = nullptr;
+    unsigned long long m_nextId = 0;
+    bool m_stop = false;
+};
+
+// Hilos a usar para trabajo de carga: todos los nucleos logicos
+inline unsigned workerCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 4;
+}
+
+// Reparte [0, count) en bloques contiguos de al menos minBlock elementos y llama
+// fn(begin, end) desde el pool. Con pocos elementos corre todo en linea.
+template <typename Fn>
+void parallelFor(size_t count, size_t minBlock, Fn&& fn) {
+    if (count == 0) return;
+    size_t blocks = std::min<size_t>(workerCount(), (count + minBlock - 1) / std::max<size_t>(minBlock, 1));
+    if (blocks <= 1) {
+        fn((size_t)0, count);
+        return;
+    }
+    ThreadPool::instance().run(blocks, [&fn, count, blocks](size_t b) {
+        fn(count * b / blocks, count * (b + 1) / blocks);
+    });
+}
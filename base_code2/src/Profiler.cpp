@@ -0,0 +1,194 @@
+#include "Profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ZoneEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Buffer de un solo escritor: el hilo dueno agrega eventos sin bloqueos y
+// publica cada uno incrementando 'count' con release. El volcado lee hasta
+// 'count' con acquire. Los bloques no se mueven ni se liberan mientras el lector
+// los recorre: solo el dueno los recicla, con el registro bloqueado, cuando ve
+// que reset() cambio la generacion.
+struct ThreadBuffer {
+    static const size_t kChunkEvents = 4096;
+    static const size_t kMaxChunks = 1024;
+    std::atomic<ZoneEvent*> chunks[kMaxChunks] = {};
+    std::atomic<size_t> count{ 0 };
+    std::atomic<size_t> dropped{ 0 };
+    std::atomic<const char*> name{ nullptr };
+    // Generacion de los eventos guardados (la del registro al escribirlos)
+    std::atomic<unsigned> generation{ 0 };
+    int tid = 0;
+
+    ~ThreadBuffer() {
+        for (auto& c : chunks) std::free(c.load());
+    }
+    void push(const ZoneEvent& e) {
+        size_t n = count.load(std::memory_order_relaxed);
+        size_t chunk = n / kChunkEvents;
+        if (chunk >= kMaxChunks) { dropped.fetch_add(1, std::memory_order_relaxed); return; }
+        ZoneEvent* block = chunks[chunk].load(std::memory_order_relaxed);
+        if (!block) {
+            // malloc y no new: la memoria del perfilador no entra en los contadores
+            // de AllocTracker ni cuenta como asignacion dentro de render()
+            block = static_cast<ZoneEvent*>(std::malloc(kChunkEvents * sizeof(ZoneEvent)));
+            if (!block) { dropped.fetch_add(1, std::memory_order_relaxed); return; }
+            chunks[chunk].store(block, std::memory_order_release);
+        }
+        block[n % kChunkEvents] = e;
+        count.store(n + 1, std::memory_order_release);
+    }
+};
+
+// El registro solo se bloquea la primera vez que un hilo emite un evento
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<bool> capturing{ false };
+    std::atomic<unsigned> generation{ 0 };
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+ThreadBuffer& localBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = r.buffers.back().get();
+        buffer->tid = (int)r.buffers.size();
+        buffer->generation.store(r.generation.load());
+    }
+    return *buffer;
+}
+
+// Eventos de una generacion anterior: se descartan y se liberan los bloques salvo el primero
+void recycle(ThreadBuffer& b, unsigned generation) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 1; i < ThreadBuffer::kMaxChunks; i++) {
+        ZoneEvent* block = b.chunks[i].exchange(nullptr, std::memory_order_relaxed);
+        if (!block) break;
+        std::free(block);
+    }
+    b.count.store(0, std::memory_order_release);
+    b.dropped.store(0, std::memory_order_relaxed);
+    b.generation.store(generation, std::memory_order_release);
+}
+
+bool current(const ThreadBuffer& b) {
+    return b.generation.load(std::memory_order_acquire) == registry().generation.load(std::memory_order_acquire);
+}
+
+void writeEscaped(std::ofstream& out, const char* s) {
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\') out << '\\';
+        out << *s;
+    }
+}
+
+}
+
+namespace Profiler {
+
+uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+void record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer& b = localBuffer();
+    unsigned generation = registry().generation.load(std::memory_order_acquire);
+    if (b.generation.load(std::memory_order_relaxed) != generation) recycle(b, generation);
+    b.push({ name, startNs, endNs });
+}
+
+void setCapturing(bool on) {
+    registry().capturing.store(on, std::memory_order_relaxed);
+}
+
+bool capturing() {
+    return registry().capturing.load(std::memory_order_relaxed);
+}
+
+void reset() {
+    registry().generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void setThreadName(const char* name) {
+    localBuffer().name.store(name, std::memory_order_release);
+}
+
+size_t eventCount() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    size_t total = 0;
+    for (const auto& b : r.buffers) {
+        if (current(*b)) total += b->count.load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    Registry& r = registry();
+    // Solo protege la lista de hilos; los escritores no se detienen
+    std::lock_guard<std::mutex> lock(r.mutex);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    char num[64];
+    for (const auto& b : r.buffers) {
+        const char* threadName = b->name.load(std::memory_order_acquire);
+        if (threadName) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"args\":{\"name\":\"";
+            writeEscaped(out, threadName);
+            out << "\"}}";
+            first = false;
+        }
+        if (!current(*b)) continue;
+        size_t count = b->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const ZoneEvent& e = b->chunks[i / ThreadBuffer::kChunkEvents].load(std::memory_order_acquire)[i % ThreadBuffer::kChunkEvents];
+            out << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(out, e.name);
+            // Chrome usa microsegundos; se conservan los decimales del ns
+            snprintf(num, sizeof(num), "%.3f,\"dur\":%.3f", e.startNs / 1000.0, (e.endNs - e.startNs) / 1000.0);
+            out << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"ts\":" << num << "}";
+            first = false;
+        }
+        size_t dropped = b->dropped.load(std::memory_order_relaxed);
+        if (dropped > 0) {
+            out << (first ? "" : ",\n") << "{\"name\":\"eventos descartados: " << dropped
+                << "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << b->tid << ",\"ts\":0}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+// Perfilador de zonas CPU. Definir PROFILER_ENABLED=0 en el proyecto elimina
+// todas las macros (no queda ni una llamada en el binario). Con el perfilador
+// compilado, las zonas solo se guardan mientras la captura esta activa.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#if PROFILER_ENABLED
+
+#include <cstdint>
+#include <string>
+
+namespace Profiler {
+    // Nanosegundos desde el inicio del proceso (reloj monotono)
+    uint64_t nowNs();
+    // 'name' debe vivir todo el programa (literal o __FUNCTION__): no se copia
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+    void setThreadName(const char* name);
+    // Captura apagada por defecto: las zonas no leen el reloj ni ocupan memoria
+    void setCapturing(bool on);
+    bool capturing();
+    // Formato trace_event de Chrome (abrir en chrome://tracing o Perfetto)
+    bool writeChromeTrace(const std::string& path);
+    // Descarta lo capturado; cada hilo recicla su buffer en su proximo evento
+    void reset();
+    size_t eventCount();
+}
+
+// Zona con alcance: mide desde su construccion hasta el final del bloque
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : m_name(Profiler::capturing() ? name : nullptr), m_start(m_name ? Profiler::nowNs() : 0) {}
+    ~ProfileZone() { if (m_name) Profiler::record(m_name, m_start, Profiler::nowNs()); }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::setThreadName(name)
+#define PROFILE_DUMP(path) Profiler::writeChromeTrace(path)
+#define PROFILE_CAPTURE(on) Profiler::setCapturing(on)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_DUMP(path) false
+#define PROFILE_CAPTURE(on) ((void)0)
+
+#endif
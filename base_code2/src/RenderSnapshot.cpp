@@ -0,0 +1,160 @@
+#include "RenderSnapshot.h"
+#include <cstring>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+
+template<typename T>
+static void copyImVector(ImVector<T>& dst, const ImVector<T>& src) {
+    // resize() conserva la capacidad; operator= de ImVector libera y reserva
+    dst.resize(src.Size);
+    if (src.Size > 0) memcpy(dst.Data, src.Data, (size_t)src.Size * sizeof(T));
+}
+
+UiDrawData::~UiDrawData() {
+    for (ImDrawList* list : m_lists) IM_DELETE(list);
+}
+
+void UiDrawData::copyFrom(const ImDrawData* src) {
+    m_data.Clear();
+    if (!src || !src->Valid) return;
+    while (m_lists.Size < src->CmdListsCount) {
+        m_lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    }
+    for (int i = 0; i < src->CmdListsCount; i++) {
+        const ImDrawList* in = src->CmdLists[i];
+        ImDrawList* out = m_lists[i];
+        copyImVector(out->CmdBuffer, in->CmdBuffer);
+        copyImVector(out->IdxBuffer, in->IdxBuffer);
+        copyImVector(out->VtxBuffer, in->VtxBuffer);
+        out->Flags = in->Flags;
+        m_data.CmdLists.push_back(out);
+    }
+    m_data.Valid = true;
+    m_data.CmdListsCount = src->CmdListsCount;
+    m_data.TotalIdxCount = src->TotalIdxCount;
+    m_data.TotalVtxCount = src->TotalVtxCount;
+    m_data.DisplayPos = src->DisplayPos;
+    m_data.DisplaySize = src->DisplaySize;
+    m_data.FramebufferScale = src->FramebufferScale;
+}
+
+void UiDrawData::swap(UiDrawData& other) {
+    m_lists.swap(other.m_lists);
+    m_data.CmdLists.swap(other.m_data.CmdLists);
+    std::swap(m_data.Valid, other.m_data.Valid);
+    std::swap(m_data.CmdListsCount, other.m_data.CmdListsCount);
+    std::swap(m_data.TotalIdxCount, other.m_data.TotalIdxCount);
+    std::swap(m_data.TotalVtxCount, other.m_data.TotalVtxCount);
+    std::swap(m_data.DisplayPos, other.m_data.DisplayPos);
+    std::swap(m_data.DisplaySize, other.m_data.DisplaySize);
+    std::swap(m_data.FramebufferScale, other.m_data.FramebufferScale);
+}
+
+void RenderSnapshot::swap(RenderSnapshot& other) {
+    std::swap(frameId, other.frameId);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    std::swap(view, other.view);
+    std::swap(projection, other.projection);
+    std::swap(viewPos, other.viewPos);
+    std::swap(options, other.options);
+    items.swap(other.items);
+    ranges.swap(other.ranges);
+    lights.swap(other.lights);
+    for (int i = 0; i < ShadowMaps::Count; i++) std::swap(shadows[i], other.shadows[i]);
+    std::swap(shadowKey, other.shadowKey);
+    std::swap(spot, other.spot);
+    std::swap(selectedItem, other.selectedItem);
+    std::swap(selectedBox, other.selectedBox);
+    std::swap(sceneKey, other.sceneKey);
+    std::swap(pickRequested, other.pickRequested);
+    std::swap(pickX, other.pickX);
+    std::swap(pickY, other.pickY);
+    std::swap(inputTime, other.inputTime);
+    ui.swap(other.ui);
+}
+
+void SnapshotExchange::publish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Si el render no alcanzo a tomar el anterior, este lo reemplaza,
+        // pero una peticion de picking o una entrada pendiente no se pierde
+        if (m_fresh) {
+            if (m_shared.pickRequested && !m_back.pickRequested) {
+                m_back.pickRequested = true;
+                m_back.pickX = m_shared.pickX;
+                m_back.pickY = m_shared.pickY;
+            }
+            if (m_shared.inputTime > 0.0 && (m_back.inputTime == 0.0 || m_shared.inputTime < m_back.inputTime)) {
+                m_back.inputTime = m_shared.inputTime;
+            }
+        }
+        m_back.swap(m_shared);
+        m_fresh = true;
+    }
+    m_cv.notify_all();
+}
+
+bool SnapshotExchange::acquire(RenderSnapshot& out) {
+    bool got = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_fresh) {
+            out.swap(m_shared);
+            m_fresh = false;
+            got = true;
+        }
+    }
+    if (got) m_cv.notify_all();
+    return got;
+}
+
+bool SnapshotExchange::hasFresh() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fresh;
+}
+
+void SnapshotExchange::waitConsumed(double seconds) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait_for(lock, std::chrono::duration<double>(seconds), [this] { return !m_fresh; });
+}
+
+void SnapshotExchange::waitFresh() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_fresh || m_woken; });
+    m_woken = false;
+}
+
+void SnapshotExchange::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_woken = true;
+    }
+    m_cv.notify_all();
+}
+
+void PresentStats::addInterval(float ms) {
+    intervalsMs[intervalIndex] = ms;
+    intervalIndex = (intervalIndex + 1) % kHistory;
+    intervalCount = std::min(intervalCount + 1, kHistory);
+    float sum = 0.0f, maxMs = 0.0f;
+    for (int i = 0; i < intervalCount; i++) {
+        sum += intervalsMs[i];
+        maxMs = std::max(maxMs, intervalsMs[i]);
+    }
+    avgIntervalMs = sum / intervalCount;
+    float var = 0.0f;
+    for (int i = 0; i < intervalCount; i++) {
+        float d = intervalsMs[i] - avgIntervalMs;
+        var += d * d;
+    }
+    jitterMs = std::sqrt(var / intervalCount);
+    maxIntervalMs = maxMs;
+}
+
+void PresentStats::addLatency(float ms) {
+    lastLatencyMs = ms;
+    // Media movil exponencial
+    avgLatencyMs = (avgLatencyMs == 0.0f) ? ms : avgLatencyMs * 0.9f + ms * 0.1f;
+}
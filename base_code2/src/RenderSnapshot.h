@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include "imgui/imgui.h"
+#include "AllocTracker.h"
+#include "LightClusters.h"
+#include "ShadowMaps.h"
+#include "Ssao.h"
+
+// Un sub-mallado visible tal como lo vio el hilo principal en este tick
+struct DrawItem {
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+    unsigned int firstVertex = 0;
+    unsigned int vertexCount = 0;
+    // Indice en m_subMeshes (para el ID de picking)
+    int subMesh = -1;
+};
+
+struct RenderOptions {
+    bool showTriangles = true;
+    bool showWireframe = false;
+    bool showVertices = false;
+    bool showNormals = false;
+    bool showBoundingBox = false;
+    bool enableZBuffer = true;
+    bool enableCulling = true;
+    bool enableAntiAliasing = true;
+    bool useSceneCache = true;
+    bool gpuProfiling = true;
+    // Marca como violacion toda asignacion del heap dentro de render() (tras el calentamiento)
+    bool checkAllocations = false;
+    // Bytes de textura que se suben a la GPU antes de dibujar este frame
+    size_t textureUploadBytes = 4u << 20;
+    // Relleno por lotes (datos por rango en un texture buffer, una llamada por textura)
+    bool batchDraws = true;
+    // Consultas PCF de sombra: (2 * pcfRadius + 1)^2, cada una filtrada 2x2
+    int pcfRadius = 1;
+    // Oclusion ambiental a media resolucion sobre la pasada de relleno
+    SsaoSettings ssao;
+    float pointSize = 3.0f;
+    glm::vec3 bgColor = glm::vec3(0.1f);
+    glm::vec3 wireframeColor = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 vertexColor = glm::vec3(1.0f);
+    glm::vec3 normalsColor = glm::vec3(1.0f, 1.0f, 0.0f);
+    glm::vec3 boundingBoxColor = glm::vec3(1.0f, 0.0f, 1.0f);
+};
+
+// Copia propia de las listas de ImGui: el hilo principal puede empezar el
+// siguiente NewFrame mientras el hilo de render dibuja esta.
+// Las listas se reutilizan entre frames para no reservar memoria.
+class UiDrawData {
+public:
+    UiDrawData() {}
+    ~UiDrawData();
+    UiDrawData(const UiDrawData&) = delete;
+    UiDrawData& operator=(const UiDrawData&) = delete;
+    void copyFrom(const ImDrawData* src);
+    ImDrawData* get() { return m_data.Valid ? &m_data : nullptr; }
+    void swap(UiDrawData& other);
+private:
+    ImDrawData m_data;
+    ImVector<ImDrawList*> m_lists;
+};
+
+// Rango de un material dentro de un DrawItem (sus matrices). La pasada de relleno
+// los recorre ordenados por material: el color cambia una vez por material.
+struct DrawRange {
+    int item = -1;
+    int material = -1;
+    // Indice en m_materialRanges: fila de datos por dibujo y aDrawId de sus vertices
+    int range = -1;
+    glm::vec3 color = glm::vec3(0.7f);
+    // Id de la textura difusa en la cache (-1 = solo color)
+    int texture = -1;
+    // Id del mapa de normales en la cache (-1 = normal interpolada)
+    int normalTexture = -1;
+    unsigned int firstVertex = 0;
+    unsigned int vertexCount = 0;
+};
+
+// Estado inmutable de un frame: todo lo que el render necesita, sin tocar
+// el grafo de escena ni los modelos del hilo principal.
+struct RenderSnapshot {
+    unsigned long long frameId = 0;
+    int width = 1;
+    int height = 1;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    RenderOptions options;
+    std::vector<DrawItem> items;
+    // Rangos visibles ordenados por material (y por item dentro de cada material)
+    std::vector<DrawRange> ranges;
+    // Luces puntuales ya asignadas a los clusters de esta vista
+    LightClusters lights;
+    // Mapas de sombra de la luz direccional y del foco: el render los vuelve a dibujar
+    // solo cuando cambia shadowKey (luces, transformaciones, geometria o visibilidad)
+    ShadowView shadows[ShadowMaps::Count];
+    unsigned long long shadowKey = 0;
+    SpotLight spot;
+    // Indice en items del sub-mallado seleccionado (-1 = ninguno)
+    int selectedItem = -1;
+    // Caja del seleccionado: cubo unitario -> caja, en espacio del sub-mallado
+    glm::mat4 selectedBox = glm::mat4(1.0f);
+    unsigned long long sceneKey = 0;
+    // Peticion de picking (coordenadas de ventana)
+    bool pickRequested = false;
+    double pickX = 0.0, pickY = 0.0;
+    // Instante de la primera entrada aun no mostrada (0 = ninguna)
+    double inputTime = 0.0;
+    UiDrawData ui;
+
+    void swap(RenderSnapshot& other);
+};
+
+// Medidas del lado render, se copian a la UI bajo un mutex
+struct PresentStats {
+    static const int kHistory = 120;
+    // Intervalos entre presentaciones consecutivas (ritmo de frames)
+    float intervalsMs[kHistory] = {};
+    int intervalCount = 0;
+    int intervalIndex = 0;
+    float avgIntervalMs = 0.0f;
+    float jitterMs = 0.0f;
+    float maxIntervalMs = 0.0f;
+    // Latencia entrada -> presentacion
+    float lastLatencyMs = 0.0f;
+    float avgLatencyMs = 0.0f;
+    float renderTimeMs = 0.0f;
+    bool sceneReused = false;
+    unsigned long long sceneHits = 0;
+    unsigned long long sceneMisses = 0;
+    unsigned long long presentedFrames = 0;
+    // Asignaciones del heap dentro de render()
+    FrameAllocStats renderAllocs;
+
+    void addInterval(float ms);
+    void addLatency(float ms);
+};
+
+// Doble buffer entre hilos: el hilo principal llena back() y lo publica
+// intercambiandolo con el buffer compartido; el hilo de render toma el
+// ultimo publicado intercambiandolo con su copia de trabajo. Solo se
+// intercambian punteros internos, nunca se copian vectores.
+class SnapshotExchange {
+public:
+    RenderSnapshot& back() { return m_back; }
+    void publish();
+    // Devuelve false si no hay un snapshot nuevo desde la ultima llamada
+    bool acquire(RenderSnapshot& out);
+    bool hasFresh();
+    // Espera (como maximo 'seconds') a que el render consuma lo publicado
+    void waitConsumed(double seconds);
+    // Espera un snapshot nuevo o hasta que se llame a wake()
+    void waitFresh();
+    void wake();
+private:
+    RenderSnapshot m_back;
+    RenderSnapshot m_shared;
+    bool m_fresh = false;
+    bool m_woken = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
@@ -0,0 +1,50 @@
+#include "SceneGraph.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+SceneGraph::SceneGraph() {
+    clear();
+}
+
+void SceneGraph::clear() {
+    m_nodes.clear();
+    m_names.clear();
+    m_world.clear();
+    m_normal.clear();
+    // Nodo raiz de la escena
+    addNode(SceneNodeType::Group, "Escena", -1);
+    m_version++;
+}
+
+int SceneGraph::addNode(SceneNodeType type, const std::string& name, int parent, int payload) {
+    // Al agregar siempre al final, el padre (ya existente) queda antes que el hijo
+    SceneNode n;
+    n.type = type;
+    n.parent = parent;
+    n.payload = payload;
+    m_nodes.push_back(n);
+    m_names.push_back(name);
+    m_world.push_back(glm::mat4(1.0f));
+    m_normal.push_back(glm::mat3(1.0f));
+    return (int)m_nodes.size() - 1;
+}
+
+void SceneGraph::update() {
+    bool anyChanged = false;
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        SceneNode& n = m_nodes[i];
+        if (n.parent >= 0 && m_nodes[n.parent].changed) n.dirty = true;
+        n.changed = n.dirty;
+        if (!n.dirty) continue;
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), n.position);
+        local = local * glm::toMat4(n.rotation);
+        local = glm::scale(local, n.scale);
+        local = glm::translate(local, n.pivot);
+        m_world[i] = (n.parent >= 0) ? m_world[n.parent] * local : local;
+        // Transpuesta de la inversa para soportar escalas no uniformes
+        m_normal[i] = glm::mat3(glm::transpose(glm::inverse(m_world[i])));
+        n.dirty = false;
+        anyChanged = true;
+    }
+    if (anyChanged) m_version++;
+}
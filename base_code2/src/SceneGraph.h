@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+enum class SceneNodeType {
+    Group,
+    Model,
+    SubMesh
+};
+
+// Transformacion local TRS de un nodo: M = T(position) * R(rotation) * S(scale) * T(pivot)
+struct SceneNode {
+    SceneNodeType type = SceneNodeType::Group;
+    int parent = -1;
+    // Indice del Model o SubMesh asociado (-1 para grupos)
+    int payload = -1;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 pivot = glm::vec3(0.0f);
+    bool dirty = true;
+    // Recalculado en el ultimo barrido (para propagar a los hijos)
+    bool changed = false;
+};
+
+// Jerarquia plana: los nodos se guardan padre-antes-que-hijo, asi que update()
+// es un unico barrido lineal. Las matrices de mundo y de normales viven en
+// arreglos paralelos y solo se recalculan para nodos sucios o con ancestro sucio.
+class SceneGraph {
+public:
+    SceneGraph();
+    void clear();
+    int addNode(SceneNodeType type, const std::string& name, int parent, int payload = -1);
+    void markDirty(int index) { m_nodes[index].dirty = true; }
+    void update();
+
+    int root() const { return 0; }
+    size_t size() const { return m_nodes.size(); }
+    SceneNode& node(int index) { return m_nodes[index]; }
+    const SceneNode& node(int index) const { return m_nodes[index]; }
+    const std::string& name(int index) const { return m_names[index]; }
+    const glm::mat4& world(int index) const { return m_world[index]; }
+    const glm::mat3& normalMatrix(int index) const { return m_normal[index]; }
+    // Se incrementa cada vez que alguna matriz de mundo cambia
+    unsigned long long version() const { return m_version; }
+private:
+    std::vector<SceneNode> m_nodes;
+    std::vector<std::string> m_names;
+    std::vector<glm::mat4> m_world;
+    std::vector<glm::mat3> m_normal;
+    unsigned long long m_version = 0;
+};
@@ -0,0 +1,164 @@
+#include "ShadowMaps.h"
+#include "Bounds.h"
+#include "RenderSnapshot.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+
+const char* kDepthVertexSrc = R"glsl(
+    #version 330 core
+    layout(location = 0) in vec3 aPos;
+    uniform mat4 model;
+    uniform mat4 lightViewProjection;
+    void main() {
+        gl_Position = lightViewProjection * model * vec4(aPos, 1.0);
+    }
+)glsl";
+
+// Solo profundidad: el FBO no tiene color
+const char* kDepthFragmentSrc = R"glsl(
+    #version 330 core
+    void main() {}
+)glsl";
+
+GLuint compileStage(GLenum type, const char* src) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "Sombras: error al compilar el shader de profundidad\n%s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Arriba de la camara de la luz: cualquier eje que no sea paralelo a la direccion
+glm::vec3 upFor(const glm::vec3& dir) {
+    return std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+} // namespace
+
+glm::mat4 directionalShadowMatrix(const glm::vec3& toLight, const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 center = (lo + hi) * 0.5f;
+    glm::vec3 dir = glm::normalize(toLight);
+    glm::mat4 view = glm::lookAt(center + dir, center, upFor(dir));
+    glm::vec3 vlo, vhi;
+    transformBox(view, lo, hi, vlo, vhi);
+    // Un margen para que la escena no toque el borde del mapa
+    glm::vec3 pad = (vhi - vlo) * 0.02f + glm::vec3(1e-4f);
+    vlo -= pad;
+    vhi += pad;
+    return glm::ortho(vlo.x, vhi.x, vlo.y, vhi.y, -vhi.z, -vlo.z) * view;
+}
+
+glm::mat4 spotShadowMatrix(const SpotLight& spot, const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 dir = glm::normalize(spot.direction);
+    glm::mat4 view = glm::lookAt(spot.position, spot.position + dir, upFor(dir));
+    glm::vec3 vlo, vhi;
+    transformBox(view, lo, hi, vlo, vhi);
+    // La escena entre near y far; si rodea al foco, near es una fraccion de far
+    float farZ = std::max(-vlo.z, 1e-3f) * 1.01f;
+    float nearZ = std::max(-vhi.z * 0.99f, farZ * 0.002f);
+    float fov = 2.0f * std::acos(glm::clamp(spot.cosOuter, 0.0f, 1.0f));
+    fov = glm::clamp(fov, glm::radians(1.0f), glm::radians(170.0f));
+    return glm::perspective(fov, 1.0f, nearZ, farZ) * view;
+}
+
+bool ShadowMaps::init() {
+    GLuint vs = compileStage(GL_VERTEX_SHADER, kDepthVertexSrc);
+    GLuint fs = compileStage(GL_FRAGMENT_SHADER, kDepthFragmentSrc);
+    if (vs && fs) {
+        m_program = glCreateProgram();
+        glAttachShader(m_program, vs);
+        glAttachShader(m_program, fs);
+        glLinkProgram(m_program);
+        GLint ok = 0;
+        glGetProgramiv(m_program, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            fprintf(stderr, "Sombras: error al enlazar el shader de profundidad\n");
+            glDeleteProgram(m_program);
+            m_program = 0;
+        }
+    }
+    if (vs) glDeleteShader(vs);
+    if (fs) glDeleteShader(fs);
+    if (!m_program) return false;
+    m_modelLoc = glGetUniformLocation(m_program, "model");
+    m_lightLoc = glGetUniformLocation(m_program, "lightViewProjection");
+    return true;
+}
+
+void ShadowMaps::destroy() {
+    for (int i = 0; i < Count; i++) {
+        if (m_fbos[i]) glDeleteFramebuffers(1, &m_fbos[i]);
+        if (m_textures[i]) glDeleteTextures(1, &m_textures[i]);
+        m_fbos[i] = m_textures[i] = 0;
+        m_sizes[i] = 0;
+    }
+    if (m_program) glDeleteProgram(m_program);
+    m_program = 0;
+}
+
+bool ShadowMaps::ensureTarget(int index, int size) {
+    if (m_fbos[index] && m_sizes[index] == size) return true;
+    if (!m_textures[index]) glGenTextures(1, &m_textures[index]);
+    if (!m_fbos[index]) glGenFramebuffers(1, &m_fbos[index]);
+    glBindTexture(GL_TEXTURE_2D, m_textures[index]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // Comparacion en el muestreador: con LINEAR cada consulta ya filtra 2x2 (PCF por hardware)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[index]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_textures[index], 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        fprintf(stderr, "Sombras: FBO de %dx%d incompleto\n", size, size);
+        return false;
+    }
+    m_sizes[index] = size;
+    return true;
+}
+
+void ShadowMaps::render(int index, const ShadowView& view, const std::vector<DrawItem>& items, GLuint vao) {
+    PROFILE_FUNCTION();
+    if (!m_program || !ensureTarget(index, view.size)) return;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[index]);
+    glViewport(0, 0, view.size, view.size);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Los modelos pueden estar abiertos: ambas caras proyectan sombra. El desplazamiento
+    // por pendiente evita que la superficie se sombree a si misma (acne)
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_lightLoc, 1, GL_FALSE, glm::value_ptr(view.viewProjection));
+    glBindVertexArray(vao);
+    for (int i : view.items) {
+        const DrawItem& item = items[i];
+        glUniformMatrix4fv(m_modelLoc, 1, GL_FALSE, glm::value_ptr(item.model));
+        glDrawArrays(GL_TRIANGLES, item.firstVertex, item.vertexCount);
+    }
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct DrawItem;
+
+// Foco con cono suave entre cosInner y cosOuter (cosenos del angulo con direction)
+struct SpotLight {
+    bool enabled = false;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float cosInner = 0.95f;
+    float cosOuter = 0.9f;
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+// Lo que necesita el render para dibujar el mapa de sombra de una luz
+struct ShadowView {
+    bool enabled = false;
+    int size = 2048;
+    // Mundo -> recorte de la luz
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    // Indices en snap.items de los sub-mallados que tocan el frustum de la luz
+    std::vector<int> items;
+};
+
+// Luz direccional (toLight apunta hacia la luz): ortografica ajustada a la caja de la escena
+glm::mat4 directionalShadowMatrix(const glm::vec3& toLight, const glm::vec3& lo, const glm::vec3& hi);
+// Foco: perspectiva con el angulo exterior del cono y near/far ajustados a la caja
+glm::mat4 spotShadowMatrix(const SpotLight& spot, const glm::vec3& lo, const glm::vec3& hi);
+
+// Mapas de profundidad de las luces con sombra (lado render). Solo se dibujan cuando
+// el snapshot trae una clave distinta de la del contenido actual.
+class ShadowMaps {
+public:
+    enum { Directional = 0, Spot = 1, Count = 2 };
+    bool init();
+    void destroy();
+    // Dibuja la profundidad de los items de view en el mapa index (viewport y FBO quedan cambiados)
+    void render(int index, const ShadowView& view, const std::vector<DrawItem>& items, GLuint vao);
+    GLuint texture(int index) const { return m_textures[index]; }
+private:
+    bool ensureTarget(int index, int size);
+
+    GLuint m_program = 0;
+    GLint m_modelLoc = -1, m_lightLoc = -1;
+    GLuint m_fbos[Count] = { 0, 0 };
+    GLuint m_textures[Count] = { 0, 0 };
+    int m_sizes[Count] = { 0, 0 };
+};
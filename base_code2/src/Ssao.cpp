@@ -0,0 +1,375 @@
+#include "Ssao.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+
+// Triangulo que cubre la pantalla, sin buffers
+const char* kFullscreenVertexSrc = R"glsl(
+    #version 330 core
+    void main() {
+        vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+    }
+)glsl";
+
+// Profundidad de vista positiva a media resolucion: la mas cercana de los 2x2 pixeles
+const char* kLinearizeFragmentSrc = R"glsl(
+    #version 330 core
+    uniform sampler2D sceneDepth;
+    // projection[3][2] y projection[2][2] (glm::perspective)
+    uniform vec2 depthParams;
+    out float linearDepth;
+    void main() {
+        ivec2 size = textureSize(sceneDepth, 0) - 1;
+        ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+        float d = min(min(texelFetch(sceneDepth, min(p, size), 0).r, texelFetch(sceneDepth, min(p + ivec2(1, 0), size), 0).r),
+                      min(texelFetch(sceneDepth, min(p + ivec2(0, 1), size), 0).r, texelFetch(sceneDepth, min(p + ivec2(1, 1), size), 0).r));
+        linearDepth = depthParams.x / (d * 2.0 - 1.0 + depthParams.y);
+    }
+)glsl";
+
+const char* kAoFragmentSrc = R"glsl(
+    #version 330 core
+    uniform sampler2D linearDepth;
+    uniform mat4 projection;
+    // projection[0][0] y projection[1][1]
+    uniform vec2 projScale;
+    uniform vec3 kernel[16];
+    uniform int sampleCount;
+    uniform float radius;
+    uniform float farDepth;
+    out float occlusion;
+    const int bayer[16] = int[16](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+    vec3 viewPos(ivec2 p, vec2 size) {
+        vec2 ndc = (vec2(p) + 0.5) / size * 2.0 - 1.0;
+        float d = texelFetch(linearDepth, clamp(p, ivec2(0), ivec2(size) - 1), 0).r;
+        return vec3(ndc * d / projScale, -d);
+    }
+    void main() {
+        vec2 size = vec2(textureSize(linearDepth, 0));
+        ivec2 p = ivec2(gl_FragCoord.xy);
+        vec3 pos = viewPos(p, size);
+        if (-pos.z >= farDepth) { occlusion = 1.0; return; }
+        // Normal por diferencias de profundidad: de cada eje el vecino mas parecido (no cruza bordes)
+        vec3 r = viewPos(p + ivec2(1, 0), size) - pos, l = pos - viewPos(p - ivec2(1, 0), size);
+        vec3 u = viewPos(p + ivec2(0, 1), size) - pos, b = pos - viewPos(p - ivec2(0, 1), size);
+        vec3 n = normalize(cross(abs(r.z) < abs(l.z) ? r : l, abs(u.z) < abs(b.z) ? u : b));
+        if (dot(n, pos) > 0.0) n = -n;
+        // Nucleo rotado alrededor de la normal, 16 angulos en un patron 4x4 que quita el desenfoque
+        float a = (float(bayer[(p.x & 3) + 4 * (p.y & 3)]) + 0.5) * (6.2831853 / 16.0);
+        vec3 rnd = vec3(cos(a), sin(a), 0.0);
+        vec3 t = rnd - n * dot(rnd, n);
+        t = dot(t, t) < 1e-6 ? normalize(cross(n, vec3(0.0, 1.0, 0.0)) + vec3(1e-3, 0.0, 0.0)) : normalize(t);
+        mat3 tbn = mat3(t, cross(n, t), n);
+        float bias = radius * 0.05;
+        float sum = 0.0;
+        for (int i = 0; i < sampleCount; i++) {
+            vec3 s = pos + tbn * kernel[i] * radius;
+            vec4 c = projection * vec4(s, 1.0);
+            vec2 uv = c.xy / c.w * 0.5 + 0.5;
+            float sceneDepth = texture(linearDepth, uv).r;
+            // Lo que queda mas alla del radio no ocluye (evita halos en los bordes)
+            float range = smoothstep(0.0, 1.0, radius / abs(-pos.z - sceneDepth));
+            sum += (sceneDepth <= -s.z - bias ? 1.0 : 0.0) * range;
+        }
+        occlusion = 1.0 - sum / float(sampleCount);
+    }
+)glsl";
+
+// Desenfoque separable que no mezcla pixeles de profundidades distintas
+const char* kBlurFragmentSrc = R"glsl(
+    #version 330 core
+    uniform sampler2D aoMap;
+    uniform sampler2D linearDepth;
+    uniform ivec2 direction;
+    uniform int blurRadius;
+    out float occlusion;
+    void main() {
+        ivec2 size = textureSize(aoMap, 0) - 1;
+        ivec2 p = ivec2(gl_FragCoord.xy);
+        float d0 = texelFetch(linearDepth, p, 0).r;
+        float sum = 0.0, weights = 0.0;
+        for (int i = -blurRadius; i <= blurRadius; i++) {
+            ivec2 q = clamp(p + direction * i, ivec2(0), size);
+            float w = max(1.0 - abs(texelFetch(linearDepth, q, 0).r - d0) / (0.05 * d0), 0.0);
+            sum += texelFetch(aoMap, q, 0).r * w;
+            weights += w;
+        }
+        occlusion = sum / weights;
+    }
+)glsl";
+
+// Reescalado bilateral: de los 4 texeles de media resolucion alrededor del pixel, pesos
+// bilineales divididos por la diferencia de profundidad
+const char* kCompositeFragmentSrc = R"glsl(
+    #version 330 core
+    uniform sampler2D sceneColor;
+    uniform sampler2D sceneDepth;
+    uniform sampler2D linearDepth;
+    uniform sampler2D aoMap;
+    uniform vec2 depthParams;
+    uniform float strength;
+    out vec4 FragColor;
+    void main() {
+        ivec2 p = ivec2(gl_FragCoord.xy);
+        vec4 color = texelFetch(sceneColor, p, 0);
+        float raw = texelFetch(sceneDepth, p, 0).r;
+        gl_FragDepth = raw;
+        if (raw >= 1.0) { FragColor = vec4(color.rgb, 1.0); return; }
+        float d = depthParams.x / (raw * 2.0 - 1.0 + depthParams.y);
+        ivec2 size = textureSize(aoMap, 0) - 1;
+        vec2 h = (vec2(p) + 0.5) * 0.5 - 0.5;
+        ivec2 base = ivec2(floor(h));
+        vec2 f = h - vec2(base);
+        float sum = 0.0, weights = 0.0;
+        for (int i = 0; i < 4; i++) {
+            ivec2 o = ivec2(i & 1, i >> 1);
+            ivec2 q = clamp(base + o, ivec2(0), size);
+            vec2 bw = mix(1.0 - f, f, vec2(o));
+            float w = bw.x * bw.y / (abs(texelFetch(linearDepth, q, 0).r - d) + 1e-3 * d);
+            sum += texelFetch(aoMap, q, 0).r * w;
+            weights += w;
+        }
+        float ao = weights > 0.0 ? sum / weights : 1.0;
+        FragColor = vec4(color.rgb * max(1.0 - color.a * (1.0 - ao) * strength, 0.0), 1.0);
+    }
+)glsl";
+
+GLuint compileStage(GLenum type, const char* src) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "SSAO: error al compilar un shader\n%s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint linkProgram(const char* fragmentSrc) {
+    GLuint vs = compileStage(GL_VERTEX_SHADER, kFullscreenVertexSrc);
+    GLuint fs = compileStage(GL_FRAGMENT_SHADER, fragmentSrc);
+    GLuint program = 0;
+    if (vs && fs) {
+        program = glCreateProgram();
+        glAttachShader(program, vs);
+        glAttachShader(program, fs);
+        glLinkProgram(program);
+        GLint ok = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            fprintf(stderr, "SSAO: error al enlazar un shader\n");
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    if (vs) glDeleteShader(vs);
+    if (fs) glDeleteShader(fs);
+    return program;
+}
+
+GLuint makeTexture(GLenum internalFormat, GLenum format, GLenum type, int w, int h, GLenum filter) {
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+bool attach(GLuint fbo, GLenum attachment, GLuint tex) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, tex, 0);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+} // namespace
+
+SsaoSettings ssaoPreset(int preset) {
+    SsaoSettings s;
+    if (preset == 1) {
+        s.samples = 16;
+        s.blurRadius = 4;
+    }
+    return s;
+}
+
+const char* ssaoPresetName(int preset) {
+    return preset == 1 ? "calidad" : "rendimiento";
+}
+
+bool SsaoPass::init() {
+    m_linearizeProgram = linkProgram(kLinearizeFragmentSrc);
+    m_aoProgram = linkProgram(kAoFragmentSrc);
+    m_blurProgram = linkProgram(kBlurFragmentSrc);
+    m_compositeProgram = linkProgram(kCompositeFragmentSrc);
+    if (!m_linearizeProgram || !m_aoProgram || !m_blurProgram || !m_compositeProgram) {
+        destroy();
+        return false;
+    }
+    // Unidades fijas: 10 color de escena, 11 profundidad de escena, 12 profundidad lineal, 13 oclusion
+    glUseProgram(m_linearizeProgram);
+    glUniform1i(glGetUniformLocation(m_linearizeProgram, "sceneDepth"), 11);
+    m_loc.depthParams = glGetUniformLocation(m_linearizeProgram, "depthParams");
+    glUseProgram(m_aoProgram);
+    glUniform1i(glGetUniformLocation(m_aoProgram, "linearDepth"), 12);
+    m_loc.aoProjection = glGetUniformLocation(m_aoProgram, "projection");
+    m_loc.aoProjScale = glGetUniformLocation(m_aoProgram, "projScale");
+    m_loc.aoKernel = glGetUniformLocation(m_aoProgram, "kernel");
+    m_loc.aoSamples = glGetUniformLocation(m_aoProgram, "sampleCount");
+    m_loc.aoRadius = glGetUniformLocation(m_aoProgram, "radius");
+    m_loc.aoFar = glGetUniformLocation(m_aoProgram, "farDepth");
+    glUseProgram(m_blurProgram);
+    glUniform1i(glGetUniformLocation(m_blurProgram, "aoMap"), 13);
+    glUniform1i(glGetUniformLocation(m_blurProgram, "linearDepth"), 12);
+    m_loc.blurDirection = glGetUniformLocation(m_blurProgram, "direction");
+    m_loc.blurRadius = glGetUniformLocation(m_blurProgram, "blurRadius");
+    glUseProgram(m_compositeProgram);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "sceneColor"), 10);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "sceneDepth"), 11);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "linearDepth"), 12);
+    glUniform1i(glGetUniformLocation(m_compositeProgram, "aoMap"), 13);
+    m_loc.compositeDepthParams = glGetUniformLocation(m_compositeProgram, "depthParams");
+    m_loc.compositeStrength = glGetUniformLocation(m_compositeProgram, "strength");
+    glUseProgram(0);
+    glGenVertexArrays(1, &m_vao);
+    return true;
+}
+
+void SsaoPass::destroy() {
+    destroyTargets();
+    for (GLuint* program : { &m_linearizeProgram, &m_aoProgram, &m_blurProgram, &m_compositeProgram }) {
+        if (*program) glDeleteProgram(*program);
+        *program = 0;
+    }
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    m_vao = 0;
+}
+
+void SsaoPass::destroyTargets() {
+    GLuint fbos[] = { m_sceneFbo, m_linearFbo, m_aoFbos[0], m_aoFbos[1] };
+    GLuint textures[] = { m_sceneColor, m_sceneDepth, m_linearDepth, m_aoTextures[0], m_aoTextures[1] };
+    for (GLuint fbo : fbos) if (fbo) glDeleteFramebuffers(1, &fbo);
+    for (GLuint tex : textures) if (tex) glDeleteTextures(1, &tex);
+    m_sceneFbo = m_sceneColor = m_sceneDepth = m_linearFbo = m_linearDepth = 0;
+    m_aoFbos[0] = m_aoFbos[1] = m_aoTextures[0] = m_aoTextures[1] = 0;
+    m_width = m_height = m_halfWidth = m_halfHeight = 0;
+}
+
+bool SsaoPass::ensureTargets(int w, int h) {
+    if (m_sceneFbo && w == m_width && h == m_height) return true;
+    destroyTargets();
+    m_width = w;
+    m_height = h;
+    m_halfWidth = std::max((w + 1) / 2, 1);
+    m_halfHeight = std::max((h + 1) / 2, 1);
+    m_sceneColor = makeTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, w, h, GL_NEAREST);
+    m_sceneDepth = makeTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, w, h, GL_NEAREST);
+    // La oclusion usa texture() con coordenadas libres: NEAREST para no mezclar profundidades
+    m_linearDepth = makeTexture(GL_R32F, GL_RED, GL_FLOAT, m_halfWidth, m_halfHeight, GL_NEAREST);
+    for (int i = 0; i < 2; i++) m_aoTextures[i] = makeTexture(GL_R8, GL_RED, GL_UNSIGNED_BYTE, m_halfWidth, m_halfHeight, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &m_sceneFbo);
+    glGenFramebuffers(1, &m_linearFbo);
+    glGenFramebuffers(2, m_aoFbos);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_sceneDepth, 0);
+    bool complete = attach(m_sceneFbo, GL_COLOR_ATTACHMENT0, m_sceneColor) && attach(m_linearFbo, GL_COLOR_ATTACHMENT0, m_linearDepth)
+        && attach(m_aoFbos[0], GL_COLOR_ATTACHMENT0, m_aoTextures[0]) && attach(m_aoFbos[1], GL_COLOR_ATTACHMENT0, m_aoTextures[1]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        fprintf(stderr, "SSAO: FBOs de %dx%d incompletos, se desactiva\n", w, h);
+        destroyTargets();
+        m_failed = true;
+    }
+    return complete;
+}
+
+void SsaoPass::updateKernel(int samples) {
+    if (samples == m_kernelSamples) return;
+    m_kernelSamples = samples;
+    // Hemisferio +Z con semilla fija; las muestras se juntan hacia el centro (mas peso cerca)
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    for (int i = 0; i < samples; i++) {
+        glm::vec3 s(uni(rng) * 2.0f - 1.0f, uni(rng) * 2.0f - 1.0f, uni(rng));
+        s = glm::normalize(s + glm::vec3(0.0f, 0.0f, 1e-3f)) * uni(rng);
+        float scale = (float)(i + 1) / samples;
+        m_kernel[i] = s * (0.1f + 0.9f * scale * scale);
+    }
+}
+
+bool SsaoPass::beginScene(int w, int h) {
+    if (m_failed || !m_compositeProgram || !ensureTargets(w, h)) return false;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+    return true;
+}
+
+void SsaoPass::apply(GLuint target, const glm::mat4& projection, const SsaoSettings& settings) {
+    PROFILE_FUNCTION();
+    const int samples = glm::clamp(settings.samples, 1, kMaxSamples);
+    updateKernel(samples);
+    // glm::perspective: profundidad de vista d = [3][2] / (z_ndc + [2][2])
+    const glm::vec2 depthParams(projection[3][2], projection[2][2]);
+    const float farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glBindVertexArray(m_vao);
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_2D, m_sceneColor);
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_2D, m_sceneDepth);
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_2D, m_linearDepth);
+    // Media resolucion: profundidad lineal, oclusion y desenfoque horizontal y vertical
+    glViewport(0, 0, m_halfWidth, m_halfHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_linearFbo);
+    glUseProgram(m_linearizeProgram);
+    glUniform2fv(m_loc.depthParams, 1, glm::value_ptr(depthParams));
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_aoFbos[0]);
+    glUseProgram(m_aoProgram);
+    glUniformMatrix4fv(m_loc.aoProjection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform2f(m_loc.aoProjScale, projection[0][0], projection[1][1]);
+    glUniform3fv(m_loc.aoKernel, samples, glm::value_ptr(m_kernel[0]));
+    glUniform1i(m_loc.aoSamples, samples);
+    glUniform1f(m_loc.aoRadius, settings.radius);
+    glUniform1f(m_loc.aoFar, farDepth * 0.999f);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glUseProgram(m_blurProgram);
+    glUniform1i(m_loc.blurRadius, std::max(settings.blurRadius, 0));
+    glActiveTexture(GL_TEXTURE13);
+    for (int pass = 0; pass < 2; pass++) {
+        glBindTexture(GL_TEXTURE_2D, m_aoTextures[pass]);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_aoFbos[1 - pass]);
+        glUniform2i(m_loc.blurDirection, pass == 0 ? 1 : 0, pass == 0 ? 0 : 1);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    // El resultado quedo en m_aoTextures[0]; la composicion escribe profundidad (prueba siempre)
+    glBindTexture(GL_TEXTURE_2D, m_aoTextures[0]);
+    glViewport(0, 0, m_width, m_height);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glUseProgram(m_compositeProgram);
+    glUniform2fv(m_loc.compositeDepthParams, 1, glm::value_ptr(depthParams));
+    glUniform1f(m_loc.compositeStrength, settings.strength);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthFunc(GL_LESS);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
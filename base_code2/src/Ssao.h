@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Oclusion ambiental en espacio de pantalla
+struct SsaoSettings {
+    bool enabled = false;
+    // Muestras del hemisferio (hasta SsaoPass::kMaxSamples)
+    int samples = 8;
+    // Radio del desenfoque bilateral en texeles de media resolucion
+    int blurRadius = 2;
+    // Radio del hemisferio en unidades de vista
+    float radius = 0.3f;
+    float strength = 1.0f;
+};
+
+// Preajustes: 0 rendimiento, 1 calidad
+static const int kSsaoPresets = 2;
+SsaoSettings ssaoPreset(int preset);
+const char* ssaoPresetName(int preset);
+
+// Lado render. La escena se dibuja en un FBO propio (color y profundidad en texturas);
+// apply() linealiza la profundidad a media resolucion, calcula la oclusion con un
+// nucleo rotado por pixel (patron 4x4), la desenfoca en dos pasadas bilaterales y
+// compone en el destino con un reescalado guiado por la profundidad. Solo se oscurece
+// la parte ambiental del color, que la pasada de relleno deja en el alfa.
+class SsaoPass {
+public:
+    static const int kMaxSamples = 16;
+    bool init();
+    void destroy();
+    // Enlaza el FBO de escena de w x h (lo crea o redimensiona); false si no se pudo
+    bool beginScene(int w, int h);
+    // Compone en target color y profundidad (para las pasadas que siguen). Cambia
+    // programa, VAO y unidades 10 a 13; deja enlazado target con su viewport
+    void apply(GLuint target, const glm::mat4& projection, const SsaoSettings& settings);
+private:
+    bool ensureTargets(int w, int h);
+    void destroyTargets();
+    void updateKernel(int samples);
+
+    GLuint m_linearizeProgram = 0, m_aoProgram = 0, m_blurProgram = 0, m_compositeProgram = 0;
+    struct {
+        GLint depthParams = -1;
+        GLint aoProjection = -1, aoProjScale = -1, aoKernel = -1, aoSamples = -1, aoRadius = -1, aoFar = -1;
+        GLint blurDirection = -1, blurRadius = -1;
+        GLint compositeDepthParams = -1, compositeStrength = -1;
+    } m_loc;
+    // Sin atributos: el triangulo de pantalla completa sale de gl_VertexID
+    GLuint m_vao = 0;
+    GLuint m_sceneFbo = 0, m_sceneColor = 0, m_sceneDepth = 0;
+    // Media resolucion: profundidad lineal (R32F) y oclusion (R8) en dos texturas para el desenfoque
+    GLuint m_linearFbo = 0, m_linearDepth = 0;
+    GLuint m_aoFbos[2] = { 0, 0 };
+    GLuint m_aoTextures[2] = { 0, 0 };
+    int m_width = 0, m_height = 0;
+    int m_halfWidth = 0, m_halfHeight = 0;
+    bool m_failed = false;
+    glm::vec3 m_kernel[kMaxSamples];
+    int m_kernelSamples = 0;
+};
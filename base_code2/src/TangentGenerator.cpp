@@ -0,0 +1,184 @@
+#include "TangentGenerator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Lo que tiene que coincidir para que dos esquinas sean el mismo vertice (como en MikkTSpace)
+struct CornerKey {
+    uint32_t bits[8];
+    int32_t orientation;
+};
+
+struct CornerHash {
+    uint64_t hash;
+    uint32_t corner;
+    bool operator<(const CornerHash& o) const { return hash != o.hash ? hash < o.hash : corner < o.corner; }
+};
+
+uint64_t hashKey(const CornerKey& key) {
+    uint64_t h = (uint64_t)(uint32_t)key.orientation;
+    for (uint32_t b : key.bits) h = (h ^ b) * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 32;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return h;
+}
+
+bool sameKey(const CornerKey& a, const CornerKey& b) {
+    return std::memcmp(&a, &b, sizeof(CornerKey)) == 0;
+}
+
+uint32_t keyBits(float f) {
+    if (f == 0.0f) return 0;
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float cornerAngle(const glm::vec3& a, const glm::vec3& b) {
+    float la = glm::length(a), lb = glm::length(b);
+    if (la <= 0.0f || lb <= 0.0f) return 0.0f;
+    return std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+}
+
+// Cualquier perpendicular a la normal, para vertices sin direccion U definida
+glm::vec3 perpendicular(const glm::vec3& n) {
+    glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 t = glm::cross(axis, n);
+    float len = glm::length(t);
+    return len > 1e-20f ? t / len : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+void tangentsForSpan(VertexStreams& vertices, const VertexSpan& span, TangentStats& stats, std::pmr::memory_resource* scratch) {
+    const size_t triangles = span.count / 3;
+    const size_t corners = triangles * 3;
+    const float* px = vertices.px.data() + span.first;
+    const float* py = vertices.py.data() + span.first;
+    const float* pz = vertices.pz.data() + span.first;
+    const float* nx = vertices.nx.data() + span.first;
+    const float* ny = vertices.ny.data() + span.first;
+    const float* nz = vertices.nz.data() + span.first;
+    const float* u = vertices.u.data() + span.first;
+    const float* v = vertices.v.data() + span.first;
+    uint32_t* out = vertices.tangent.data() + span.first;
+    auto position = [&](size_t c) { return glm::vec3(px[c], py[c], pz[c]); };
+    auto normal = [&](size_t c) { return glm::vec3(nx[c], ny[c], nz[c]); };
+
+    // 1) Por cara: direccion de U (unitaria) y orientacion de las UV (+1/-1). Por esquina:
+    //    esa direccion proyectada sobre su normal y pesada por el angulo de la esquina.
+    //    Sin area en UV la esquina no aporta (suma 0)
+    std::pmr::vector<glm::vec3> cornerTangents(corners, scratch);
+    std::pmr::vector<CornerKey> keys(corners, scratch);
+    std::pmr::vector<CornerHash> order(corners, scratch);
+    std::atomic<size_t> degenerate{ 0 };
+    parallelFor(triangles, 8192, [&](size_t begin, size_t end) {
+        size_t localDegenerate = 0;
+        for (size_t t = begin; t < end; t++) {
+            const size_t c = 3 * t;
+            const glm::vec3 p[3] = { position(c), position(c + 1), position(c + 2) };
+            glm::vec3 d1 = p[1] - p[0], d2 = p[2] - p[0];
+            float t21x = u[c + 1] - u[c], t21y = v[c + 1] - v[c];
+            float t31x = u[c + 2] - u[c], t31y = v[c + 2] - v[c];
+            float signedArea = t21x * t31y - t21y * t31x;
+            glm::vec3 os = t31y * d1 - t21y * d2;
+            float len = glm::length(os);
+            int32_t orientation = signedArea > 0.0f ? 1 : -1;
+            glm::vec3 ft(0.0f);
+            if (signedArea != 0.0f && len > 0.0f) ft = os * ((float)orientation / len);
+            else localDegenerate++;
+            for (int k = 0; k < 3; k++) {
+                const size_t ck = c + k;
+                const glm::vec3 n = normal(ck);
+                glm::vec3 pt = ft - n * glm::dot(n, ft);
+                float plen = glm::length(pt);
+                cornerTangents[ck] = plen > 1e-20f ? pt * (cornerAngle(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]) / plen) : glm::vec3(0.0f);
+                CornerKey& key = keys[ck];
+                key.bits[0] = keyBits(px[ck]); key.bits[1] = keyBits(py[ck]); key.bits[2] = keyBits(pz[ck]);
+                key.bits[3] = keyBits(nx[ck]); key.bits[4] = keyBits(ny[ck]); key.bits[5] = keyBits(nz[ck]);
+                key.bits[6] = keyBits(u[ck]); key.bits[7] = keyBits(v[ck]);
+                key.orientation = orientation;
+                order[ck] = CornerHash{ hashKey(key), (uint32_t)ck };
+            }
+        }
+        degenerate += localDegenerate;
+    });
+
+    // 2) Soldar: se ordena por hash de la clave (enteros, no la clave de 36 bytes) y
+    //    cada corrida del mismo hash se ordena por clave exacta por si hay colisiones
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < corners;) {
+        size_t j = i + 1;
+        while (j < corners && order[j].hash == order[i].hash) j++;
+        if (j - i > 1) {
+            std::sort(order.begin() + i, order.begin() + j, [&](const CornerHash& a, const CornerHash& b) {
+                int cmp = std::memcmp(&keys[a.corner], &keys[b.corner], sizeof(CornerKey));
+                return cmp != 0 ? cmp < 0 : a.corner < b.corner;
+            });
+        }
+        i = j;
+    }
+
+    // 3) Cada vertice soldado suma lo de sus esquinas (todas con la misma normal)
+    size_t welded = 0;
+    for (size_t i = 0; i < corners;) {
+        size_t j = i + 1;
+        while (j < corners && sameKey(keys[order[i].corner], keys[order[j].corner])) j++;
+        const glm::vec3 n = normal(order[i].corner);
+        glm::vec3 sum(0.0f);
+        for (size_t k = i; k < j; k++) sum += cornerTangents[order[k].corner];
+        glm::vec3 t = sum - n * glm::dot(n, sum);
+        float len = glm::length(t);
+        t = len > 1e-20f ? t / len : perpendicular(n);
+        const uint32_t packed = packTangent(t, (float)keys[order[i].corner].orientation);
+        for (size_t k = i; k < j; k++) out[order[k].corner] = packed;
+        welded++;
+        i = j;
+    }
+    stats.triangles = triangles;
+    stats.weldedVertices = welded;
+    stats.degenerate = degenerate;
+}
+
+} // namespace
+
+uint32_t packTangent(const glm::vec3& tangent, float sign) {
+    auto snorm10 = [](float f) { return (uint32_t)((int)std::lround(glm::clamp(f, -1.0f, 1.0f) * 511.0f) & 0x3FF); };
+    // w de 2 bits con signo: +1 = 01, -1 = 11
+    uint32_t w = sign < 0.0f ? 3u : 1u;
+    return snorm10(tangent.x) | (snorm10(tangent.y) << 10) | (snorm10(tangent.z) << 20) | (w << 30);
+}
+
+void generateTangents(VertexStreams& vertices, const std::vector<VertexSpan>& spans, TangentStats* stats,
+    std::pmr::memory_resource* scratch) {
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<TangentStats> partial(spans.size());
+    if (spans.size() == 1) {
+        // Un solo sub-mallado: las pasadas por cara se reparten en el pool
+        tangentsForSpan(vertices, spans[0], partial[0], scratch);
+    }
+    else if (!spans.empty()) {
+        // Los tramos mas grandes primero, asi el ultimo trabajo no queda solo al final
+        std::vector<size_t> order(spans.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return spans[a].count > spans[b].count; });
+        ThreadPool::instance().run(order.size(), [&](size_t i) {
+            tangentsForSpan(vertices, spans[order[i]], partial[order[i]], scratch);
+        });
+    }
+    if (stats) {
+        *stats = TangentStats();
+        for (const TangentStats& p : partial) {
+            stats->triangles += p.triangles;
+            stats->weldedVertices += p.weldedVertices;
+            stats->degenerate += p.degenerate;
+        }
+        stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
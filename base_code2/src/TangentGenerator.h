@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include "MeshPipeline.h"
+
+struct TangentStats {
+    size_t triangles = 0;
+    // Vertices distintos (posicion, normal, UV y orientacion) tras soldar las esquinas
+    size_t weldedVertices = 0;
+    // Triangulos sin area en UV (toman la tangente de sus vecinos o una perpendicular)
+    size_t degenerate = 0;
+    double milliseconds = 0.0;
+};
+
+// Tramo de triangulos sin indexar dentro de VertexStreams (un sub-mallado)
+struct VertexSpan {
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// Tangente unitaria y signo de la bitangente (+1/-1) en 2_10_10_10 con signo,
+// el formato de GL_INT_2_10_10_10_REV normalizado
+uint32_t packTangent(const glm::vec3& tangent, float sign);
+
+// Tangentes compatibles con MikkTSpace: por cara, la direccion de U en el plano del
+// triangulo con el signo de la orientacion UV; por esquina, proyectada sobre la normal
+// y pesada por el angulo; las esquinas con igual posicion, normal, UV y orientacion
+// se sueldan y comparten el promedio. Cada tramo se procesa por separado (un trabajo
+// del ThreadPool por tramo; con un solo tramo, sus pasadas se reparten en el pool).
+// Necesita normales ya calculadas: hay que regenerarlas si cambian.
+// scratch: de donde salen los temporales (la arena de carga en el visor)
+void generateTangents(VertexStreams& vertices, const std::vector<VertexSpan>& spans, TangentStats* stats = nullptr,
+    std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
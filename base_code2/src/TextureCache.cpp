@@ -0,0 +1,1068 @@
+#include "TextureCache.h"
+#include "BlockCompress.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+// Se lee el archivo con ifstream y se decodifica desde memoria (sin FILE* de stb)
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#include "stb/stb_image.h"
+
+// S3TC no esta en el nucleo de GL 3.3 (glad no trae la extension)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace {
+// Subidas parciales por llamada a upload() (una por nivel o trozo de nivel)
+const int kMaxChunks = 64;
+
+// Cabecera de los archivos de cache; cambiar kCacheVersion invalida los anteriores
+const char kCacheMagic[4] = { 'B', 'T', 'E', 'X' };
+const uint32_t kCacheVersion = 1;
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t levels;
+    int64_t mtime;
+};
+
+BlockFormat blockFormatOf(GLenum format) {
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) return BlockFormat::BC1;
+    if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) return BlockFormat::BC3;
+    return BlockFormat::BC5;
+}
+
+// FNV-1a de 64 bits
+unsigned long long hashString(const std::string& s) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Deja en pixels solo los niveles [first, endLevel)
+void keepLevels(TextureImage& image, int first) {
+    if (first <= image.firstLevel) return;
+    size_t start = image.offset[first];
+    std::vector<unsigned char>(image.pixels.begin() + start, image.pixels.end()).swap(image.pixels);
+    for (int l = first; l < image.endLevel; l++) image.offset[l] -= start;
+    image.firstLevel = first;
+}
+
+size_t rawLevelBytes(int width, int height, int level) {
+    return (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * 4;
+}
+}
+
+const char* TextureCache::kCacheDir = "cache_texturas";
+
+TextureCache::~TextureCache() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_loader.joinable()) m_loader.join();
+}
+
+void TextureCache::init() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) m_s3tc = true;
+    }
+    if (!m_s3tc) std::cout << "Texturas: sin S3TC, el color se sube sin comprimir" << std::endl;
+}
+
+int TextureCache::request(const std::string& path, TextureKind kind) {
+    std::error_code ec;
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return -1;
+    Entry entry;
+    entry.path = path;
+    entry.key = std::filesystem::weakly_canonical(path, ec).string();
+    if (ec) entry.key = path;
+    entry.mtime = mtime;
+    entry.kind = kind;
+    entry.compress = m_compression && (kind == TextureKind::Normal || m_s3tc);
+    // El mismo archivo puede pedirse con otro uso o sin comprimir: son texturas distintas
+    std::string key = entry.key + (kind == TextureKind::Normal ? "#n" : "#c") + (entry.compress ? "z" : "");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_byPath.find(key);
+    // Mismo archivo sin cambios: se reutiliza; si cambio en disco se decodifica de nuevo
+    if (it != m_byPath.end() && m_entries[it->second].mtime == mtime) return it->second;
+    int id = (int)m_entries.size();
+    m_entries.push_back(std::move(entry));
+    m_byPath[key] = id;
+    m_queue.push_back(Job{ id, 0, 0 });
+    m_outstanding++;
+    if (!m_loader.joinable()) m_loader = std::thread(&TextureCache::loaderMain, this);
+    m_wake.notify_one();
+    return id;
+}
+
+std::string TextureCache::path(int id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries[id].path;
+}
+
+void TextureCache::clear() {
+    PROFILE_FUNCTION();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Lo que sigue en la cola no se lee; la ronda en curso todavia escribe en m_entries
+    m_outstanding -= (int)m_queue.size();
+    m_queue.clear();
+    m_decodedCv.wait(lock, [this]() { return m_decoding == 0; });
+    m_outstanding -= (int)m_decoded.size();
+    m_decoded.clear();
+    m_entries.clear();
+    m_byPath.clear();
+    m_decodedCount = 0;
+    m_failed = 0;
+    m_cacheHits = 0;
+    m_encoded = 0;
+    m_decodeMs = 0.0;
+    m_encodeMs = 0.0;
+    m_wantedBytes = 0;
+    m_streamedLevels = 0;
+    m_evictedLevels = 0;
+    m_ungrouped = false;
+    m_arrays = 0;
+    m_atlases = 0;
+    m_grouped = 0;
+    m_generation++;
+}
+
+TextureStats TextureCache::stats() const {
+    TextureStats s;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.requested = (int)m_entries.size();
+        s.decoded = m_decodedCount;
+        s.failed = m_failed;
+        s.decodeMs = m_decodeMs;
+        s.encodeMs = m_encodeMs;
+        s.cacheHits = m_cacheHits;
+        s.encoded = m_encoded;
+        s.wantedBytes = m_wantedBytes;
+        s.budgetBytes = m_budgetBytes;
+        s.streamedLevels = m_streamedLevels;
+        s.arrays = m_arrays;
+        s.atlases = m_atlases;
+        s.grouped = m_grouped;
+    }
+    s.uploaded = m_uploaded.load();
+    s.gpuBytes = m_gpuBytes.load();
+    s.rawBytes = m_rawBytes.load();
+    s.evictedLevels = m_evictedLevels.load();
+    return s;
+}
+
+void TextureCache::updateResidency(const std::vector<TextureUse>& uses, size_t budgetBytes) {
+    PROFILE_FUNCTION();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frame++;
+    m_budgetBytes = budgetBytes;
+    // Se agrupa con el cargador libre: asi entran juntas todas las texturas de una carga
+    if (m_ungrouped && m_queue.empty() && m_decoding == 0) formGroups();
+    for (const TextureUse& use : uses) {
+        if (use.id < 0 || use.id >= (int)m_entries.size()) continue;
+        // Un miembro se cuenta como uso de su grupo
+        int unit = m_entries[use.id].group >= 0 ? m_entries[use.id].group : use.id;
+        Entry& e = m_entries[unit];
+        if (!e.known) continue;
+        // Nivel mas grueso que todavia da al menos un texel por pixel
+        int side = std::max(e.width, e.height);
+        int level = 0;
+        while (level + 1 < e.levels && std::max(side >> (level + 1), 1) >= use.pixels) level++;
+        e.wanted = e.lastUsed == m_frame ? std::min(e.wanted, level) : level;
+        e.lastUsed = m_frame;
+    }
+    auto bytesFrom = [](const Entry& e, int level) {
+        size_t bytes = 0;
+        for (int l = level; l < e.levels; l++) bytes += e.levelBytes[l];
+        return bytes;
+    };
+    // Sin presupuesto: lo visible baja hasta el nivel que necesita y nada se libera
+    // mientras haya lugar (acercarse y alejarse no vuelve a leer el mismo nivel)
+    size_t wanted = 0, total = 0;
+    for (Entry& e : m_entries) {
+        if (!e.known || e.group >= 0) continue;
+        if (e.pinned) {
+            e.target = 0;
+        }
+        else {
+            if (e.lastUsed == m_frame) wanted += bytesFrom(e, e.wanted);
+            else e.wanted = e.levels - 1;
+            e.target = std::max(std::min(e.requested, e.wanted), e.minLevel);
+        }
+        total += bytesFrom(e, e.target);
+    }
+    // Sobre el presupuesto se quita de a un nivel: primero los que no hacen falta, de la
+    // textura usada hace mas tiempo; despues los necesarios, del nivel mas grande
+    auto dropsBefore = [](const Entry& a, const Entry& b) {
+        bool spareA = a.target < a.wanted, spareB = b.target < b.wanted;
+        if (spareA != spareB) return spareA;
+        if (spareA && a.lastUsed != b.lastUsed) return a.lastUsed < b.lastUsed;
+        return a.levelBytes[a.target] > b.levelBytes[b.target];
+    };
+    while (total > budgetBytes) {
+        Entry* drop = nullptr;
+        for (Entry& e : m_entries) {
+            if (!e.known || e.group >= 0 || e.pinned || e.target >= e.levels - 1) continue;
+            if (!drop || dropsBefore(e, *drop)) drop = &e;
+        }
+        if (!drop) break;
+        total -= drop->levelBytes[drop->target];
+        drop->target++;
+    }
+    bool wake = false;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        Entry& e = m_entries[i];
+        if (!e.known || e.group >= 0 || e.pinned) continue;
+        // Los niveles que faltan se leen del archivo; los que sobran los libera el render
+        // al ver el nuevo valor de requested
+        if (e.target < e.requested) {
+            m_queue.push_back(Job{ (int)i, e.target, std::min(e.requested, e.levels) });
+            m_outstanding++;
+            wake = true;
+        }
+        e.requested = e.target;
+    }
+    m_wantedBytes = wanted;
+    if (wake) m_wake.notify_one();
+}
+
+void TextureCache::formGroups() {
+    PROFILE_FUNCTION();
+    m_ungrouped = false;
+    // Candidatas: ya cargadas, con archivo de cache (de ahi se arma el grupo) y sin mirar
+    std::vector<int> candidates;
+    for (int i = 0; i < (int)m_entries.size(); i++) {
+        Entry& e = m_entries[i];
+        if (!e.known || e.grouped || !e.members.empty()) continue;
+        e.grouped = true;
+        if (!e.pinned) candidates.push_back(i);
+    }
+    // Arrays: mismo formato, tamanno y niveles
+    auto shape = [this](int id) {
+        const Entry& e = m_entries[id];
+        return std::make_tuple(e.format, e.width, e.height, e.levels);
+    };
+    std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) { return shape(a) < shape(b); });
+    std::vector<int> loose;
+    for (size_t begin = 0; begin < candidates.size();) {
+        size_t end = begin + 1;
+        while (end < candidates.size() && end - begin < (size_t)kMaxArrayLayers && shape(candidates[end]) == shape(candidates[begin])) end++;
+        if (end - begin >= 2) {
+            const Entry& first = m_entries[candidates[begin]];
+            addGroup(std::vector<int>(candidates.begin() + begin, candidates.begin() + end), false, first.width, first.height);
+        }
+        else {
+            loose.push_back(candidates[begin]);
+        }
+        begin = end;
+    }
+    // Atlas: las sueltas chicas de un mismo formato, con lados multiplo del margen
+    const int pad = kAtlasPadding;
+    std::vector<int> fit;
+    fit.reserve(loose.size());
+    for (int id : loose) {
+        const Entry& e = m_entries[id];
+        if (std::max(e.width, e.height) <= kAtlasMaxTexture && e.width % pad == 0 && e.height % pad == 0) fit.push_back(id);
+    }
+    // Mas altas primero: los estantes quedan parejos
+    std::stable_sort(fit.begin(), fit.end(), [this](int a, int b) {
+        const Entry& ea = m_entries[a];
+        const Entry& eb = m_entries[b];
+        return ea.format != eb.format ? ea.format < eb.format : ea.height > eb.height;
+    });
+    for (size_t begin = 0; begin < fit.size();) {
+        size_t end = begin + 1;
+        while (end < fit.size() && m_entries[fit[end]].format == m_entries[fit[begin]].format) end++;
+        if (end - begin < 2) {
+            begin = end;
+            continue;
+        }
+        // Estantes sobre un ancho potencia de 2 que cubre el area; si no entra en
+        // kAtlasMaxSize de alto se prueba el doble de ancho
+        size_t area = 0;
+        int widest = 0;
+        for (size_t i = begin; i < end; i++) {
+            const Entry& e = m_entries[fit[i]];
+            area += (size_t)(e.width + 2 * pad) * (e.height + 2 * pad);
+            widest = std::max(widest, e.width + 2 * pad);
+        }
+        int atlasW = widest, atlasH = 0;
+        while (atlasW < kAtlasMaxSize && (size_t)atlasW * atlasW < area) atlasW *= 2;
+        int p2 = 1;
+        while (p2 < atlasW) p2 *= 2;
+        atlasW = p2;
+        for (; atlasW <= kAtlasMaxSize; atlasW *= 2) {
+            int x = 0, y = 0, shelf = 0;
+            for (size_t i = begin; i < end; i++) {
+                Entry& e = m_entries[fit[i]];
+                if (x + e.width + 2 * pad > atlasW) {
+                    x = 0;
+                    y += shelf;
+                    shelf = 0;
+                }
+                e.atlasX = x;
+                e.atlasY = y;
+                x += e.width + 2 * pad;
+                shelf = std::max(shelf, e.height + 2 * pad);
+            }
+            atlasH = 1;
+            while (atlasH < y + shelf) atlasH *= 2;
+            if (atlasH <= kAtlasMaxSize) break;
+        }
+        if (atlasW <= kAtlasMaxSize) {
+            for (size_t i = begin; i < end; i++) {
+                Entry& e = m_entries[fit[i]];
+                e.uvScale[0] = (float)e.width / atlasW;
+                e.uvScale[1] = (float)e.height / atlasH;
+                e.uvOffset[0] = (float)(e.atlasX + pad) / atlasW;
+                e.uvOffset[1] = (float)(e.atlasY + pad) / atlasH;
+            }
+            addGroup(std::vector<int>(fit.begin() + begin, fit.begin() + end), true, atlasW, atlasH);
+        }
+        begin = end;
+    }
+}
+
+int TextureCache::addGroup(std::vector<int> members, bool atlas, int width, int height) {
+    const Entry& first = m_entries[members[0]];
+    Entry g;
+    g.path = std::string(atlas ? "atlas" : "array") + " de " + std::to_string(members.size()) + " texturas";
+    g.kind = first.kind;
+    g.compress = first.compress;
+    g.format = first.format;
+    g.known = true;
+    g.grouped = true;
+    g.atlas = atlas;
+    g.width = width;
+    g.height = height;
+    int firstLevel = 0;
+    if (atlas) {
+        // Pocos niveles y siempre residente: sin archivo propio, se arma una sola vez
+        TextureImage shape;
+        shape.compressedFormat = g.format == GL_RGBA8 ? 0 : g.format;
+        shape.blockBytes = shape.compressedFormat ? (int)blockBytes(blockFormatOf(g.format)) : 0;
+        g.levels = kAtlasLevels;
+        for (int l = 0; l < g.levels; l++) {
+            shape.width[l] = std::max(width >> l, 1);
+            shape.height[l] = std::max(height >> l, 1);
+            g.levelBytes[l] = shape.levelBytes(l);
+        }
+        g.pinned = true;
+    }
+    else {
+        // Arranca con los niveles que ya tienen sus miembros: el cambio no se nota
+        g.levels = first.levels;
+        for (int l = 0; l < g.levels; l++) g.levelBytes[l] = first.levelBytes[l] * members.size();
+        firstLevel = g.levels - 1;
+        for (int id : members) firstLevel = std::min(firstLevel, m_entries[id].requested);
+    }
+    g.requested = firstLevel;
+    int id = (int)m_entries.size();
+    for (size_t i = 0; i < members.size(); i++) {
+        Entry& e = m_entries[members[i]];
+        e.group = id;
+        e.layer = atlas ? 0 : (int)i;
+    }
+    m_grouped += (int)members.size();
+    (atlas ? m_atlases : m_arrays)++;
+    g.members = std::move(members);
+    m_queue.push_back(Job{ id, firstLevel, g.levels });
+    m_entries.push_back(std::move(g));
+    m_outstanding++;
+    m_wake.notify_one();
+    return id;
+}
+
+void TextureCache::loaderMain() {
+    PROFILE_THREAD_NAME("Texturas");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if (m_stop) return;
+        // Rondas de a lo sumo un archivo por nucleo: entre ronda y ronda el pool queda
+        // libre para la carga de mallas, que no espera a que se decodifique todo
+        size_t n = std::min<size_t>(m_queue.size(), workerCount());
+        std::vector<Job> jobs(m_queue.begin(), m_queue.begin() + n);
+        m_queue.erase(m_queue.begin(), m_queue.begin() + n);
+        std::vector<Entry> entries(n);
+        std::vector<std::vector<Entry>> members(n);
+        for (size_t i = 0; i < n; i++) {
+            entries[i] = m_entries[jobs[i].id];
+            for (int m : entries[i].members) members[i].push_back(m_entries[m]);
+        }
+        m_decoding += (int)n;
+        lock.unlock();
+        std::vector<LoadResult> results(n);
+        ThreadPool::instance().run(n, [&](size_t i) {
+            if (!members[i].empty()) loadGroup(entries[i], members[i], jobs[i], results[i]);
+            else load(entries[i], jobs[i], results[i]);
+            if (results[i].image) results[i].image->id = jobs[i].id;
+        });
+        lock.lock();
+        m_decoding -= (int)n;
+        for (size_t i = 0; i < n; i++) {
+            LoadResult& r = results[i];
+            const Job& job = jobs[i];
+            if (!r.image) {
+                if (job.endLevel == 0) {
+                    m_failed++;
+                }
+                else {
+                    // Los niveles no llegaron: se quitan de lo pedido para que el proximo
+                    // updateResidency los vuelva a leer, hasta kMaxReadRetries veces
+                    Entry& e = m_entries[job.id];
+                    e.requested = std::max(e.requested, job.endLevel);
+                    if (++e.readFailures >= kMaxReadRetries && e.minLevel < job.endLevel) {
+                        e.minLevel = job.endLevel;
+                        std::cerr << "Textura: " << e.path << " se queda en el nivel " << e.minLevel << std::endl;
+                    }
+                }
+                m_outstanding--;
+                continue;
+            }
+            if (job.endLevel == 0) {
+                m_decodeMs += r.ms;
+                m_encodeMs += r.encodeMs;
+                m_cacheHits += r.cacheHit;
+                m_encoded += r.encoded;
+                m_decodedCount++;
+                const TextureImage& img = *r.image;
+                Entry& e = m_entries[job.id];
+                e.known = true;
+                e.pinned = !r.cached;
+                e.format = img.compressedFormat ? img.compressedFormat : GL_RGBA8;
+                m_ungrouped = true;
+                e.levels = img.levels;
+                e.width = img.width[0];
+                e.height = img.height[0];
+                for (int l = 0; l < img.levels; l++) e.levelBytes[l] = img.levelBytes(l);
+                e.requested = img.firstLevel;
+            }
+            else {
+                m_streamedLevels += job.endLevel - job.firstLevel;
+                m_entries[job.id].readFailures = 0;
+            }
+            m_decoded.push_back(std::move(r.image));
+        }
+        m_decodedCv.notify_all();
+    }
+}
+
+void TextureCache::load(const Entry& entry, const Job& job, LoadResult& result) {
+    PROFILE_SCOPE("Cargar textura");
+    auto t0 = std::chrono::steady_clock::now();
+    auto image = std::make_unique<TextureImage>();
+    if (job.endLevel > 0) {
+        // Niveles finos de una textura ya cargada: siempre del archivo de cache
+        if (readCache(entry, *image, job.firstLevel, job.endLevel)) result.image = std::move(image);
+        else std::cerr << "Textura: no se pudieron leer los niveles " << job.firstLevel << "-" << job.endLevel - 1
+                       << " de " << entry.path << " en " << kCacheDir << std::endl;
+    }
+    else if (readCache(entry, *image, -1, -1)) {
+        result.cacheHit = true;
+        result.cached = true;
+        result.image = std::move(image);
+    }
+    else if (decode(entry.path, *image)) {
+        buildMips(*image);
+        if (entry.compress) {
+            auto e0 = std::chrono::steady_clock::now();
+            compress(*image, entry.kind);
+            result.encoded = true;
+            result.encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - e0).count();
+        }
+        // Con el archivo guardado alcanza con subir la vista previa; sin el, van todos los niveles
+        result.cached = writeCache(entry, *image);
+        if (result.cached) keepLevels(*image, previewLevel(*image));
+        result.image = std::move(image);
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void TextureCache::loadGroup(const Entry& group, const std::vector<Entry>& members, const Job& job, LoadResult& result) {
+    PROFILE_SCOPE("Armar grupo de texturas");
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<TextureImage> sources(members.size());
+    for (size_t m = 0; m < members.size(); m++) {
+        const Entry& me = members[m];
+        TextureImage& src = sources[m];
+        // Si un miembro cambio en disco el grupo ya no vale: queda con lo que tenia
+        if (!readCache(me, src, job.firstLevel, job.endLevel) || src.compressedFormat != sources[0].compressedFormat ||
+            src.levels != me.levels || src.width[0] != me.width || src.height[0] != me.height) {
+            std::cerr << "Textura: no se pudo armar el " << group.path << " (" << members[m].path << ")" << std::endl;
+            return;
+        }
+    }
+    auto image = std::make_unique<TextureImage>();
+    image->compressedFormat = sources[0].compressedFormat;
+    image->blockBytes = sources[0].blockBytes;
+    image->levels = group.levels;
+    image->firstLevel = job.firstLevel;
+    image->endLevel = job.endLevel;
+    size_t total = 0;
+    if (!group.atlas) {
+        // Cada nivel con las capas en orden de miembro
+        image->layers = (int)members.size();
+        for (int l = 0; l < image->levels; l++) {
+            image->width[l] = sources[0].width[l];
+            image->height[l] = sources[0].height[l];
+        }
+        for (int l = job.firstLevel; l < job.endLevel; l++) {
+            image->offset[l] = total;
+            total += image->levelBytes(l) * image->layers;
+        }
+        image->pixels.resize(total);
+        for (int l = job.firstLevel; l < job.endLevel; l++) {
+            for (size_t m = 0; m < members.size(); m++) {
+                memcpy(image->pixels.data() + image->offset[l] + m * image->levelBytes(l),
+                    sources[m].pixels.data() + sources[m].offset[l], image->levelBytes(l));
+            }
+        }
+    }
+    else {
+        for (int l = 0; l < image->levels; l++) {
+            image->width[l] = std::max(group.width >> l, 1);
+            image->height[l] = std::max(group.height >> l, 1);
+            image->offset[l] = total;
+            total += image->levelBytes(l);
+        }
+        image->pixels.assign(total, 0);
+        // Se copia por bloques (o texeles sin comprimir); el margen repite la textura
+        // como si tuviera GL_REPEAT, asi el filtrado en el borde no toma a la vecina
+        const int unit = image->rowTexels();
+        const size_t unitBytes = image->compressedFormat ? (size_t)image->blockBytes : 4;
+        for (size_t m = 0; m < members.size(); m++) {
+            const Entry& me = members[m];
+            const TextureImage& src = sources[m];
+            for (int l = 0; l < image->levels; l++) {
+                const int uw = (src.width[l] + unit - 1) / unit, uh = (src.height[l] + unit - 1) / unit;
+                const int pad = (kAtlasPadding >> l) / unit;
+                const int ox = ((me.atlasX + kAtlasPadding) >> l) / unit, oy = ((me.atlasY + kAtlasPadding) >> l) / unit;
+                const size_t rowUnits = image->rowBytes(l) / unitBytes;
+                unsigned char* dst = image->pixels.data() + image->offset[l];
+                const unsigned char* from = src.pixels.data() + src.offset[l];
+                for (int dy = -pad; dy < uh + pad; dy++) {
+                    int sy = (dy % uh + uh) % uh;
+                    for (int dx = -pad; dx < uw + pad; dx++) {
+                        int sx = (dx % uw + uw) % uw;
+                        memcpy(dst + ((size_t)(oy + dy) * rowUnits + ox + dx) * unitBytes, from + ((size_t)sy * uw + sx) * unitBytes, unitBytes);
+                    }
+                }
+            }
+        }
+    }
+    result.image = std::move(image);
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool TextureCache::decode(const std::string& path, TextureImage& image) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        std::cerr << "Textura: no se pudo abrir " << path << std::endl;
+        return false;
+    }
+    std::streamoff size = in.tellg();
+    if (size <= 0) {
+        std::cerr << "Textura: " << path << " esta vacia" << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> file((size_t)size);
+    in.seekg(0);
+    in.read((char*)file.data(), file.size());
+    int w = 0, h = 0, channels = 0;
+    unsigned char* data = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &channels, 4);
+    if (!data) {
+        std::cerr << "Textura: " << path << " no es una imagen valida (" << stbi_failure_reason() << ")" << std::endl;
+        return false;
+    }
+    // Tamanno de la cadena completa hasta 1x1
+    image.levels = 0;
+    size_t total = 0;
+    for (int lw = w, lh = h; image.levels < kMaxLevels; lw = std::max(lw / 2, 1), lh = std::max(lh / 2, 1)) {
+        image.width[image.levels] = lw;
+        image.height[image.levels] = lh;
+        image.offset[image.levels] = total;
+        total += (size_t)lw * lh * 4;
+        image.levels++;
+        if (lw == 1 && lh == 1) break;
+    }
+    image.firstLevel = 0;
+    image.endLevel = image.levels;
+    image.pixels.resize(total);
+    // El OBJ pone v = 0 abajo y stb entrega la fila de arriba primero: se invierte aqui
+    // (stbi_set_flip_vertically_on_load es global y no se puede usar desde varios hilos)
+    size_t rowBytes = (size_t)w * 4;
+    for (int y = 0; y < h; y++) {
+        memcpy(image.pixels.data() + (size_t)(h - 1 - y) * rowBytes, data + (size_t)y * rowBytes, rowBytes);
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+void TextureCache::buildMips(TextureImage& image) {
+    // Promedio de 2x2 texeles; en lados impares se repite el ultimo
+    for (int l = 1; l < image.levels; l++) {
+        const int sw = image.width[l - 1], sh = image.height[l - 1];
+        const int dw = image.width[l], dh = image.height[l];
+        const unsigned char* src = image.pixels.data() + image.offset[l - 1];
+        unsigned char* dst = image.pixels.data() + image.offset[l];
+        for (int y = 0; y < dh; y++) {
+            const unsigned char* row0 = src + (size_t)std::min(2 * y, sh - 1) * sw * 4;
+            const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, sh - 1) * sw * 4;
+            for (int x = 0; x < dw; x++) {
+                int x0 = std::min(2 * x, sw - 1) * 4, x1 = std::min(2 * x + 1, sw - 1) * 4;
+                for (int c = 0; c < 4; c++) {
+                    *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+void TextureCache::compress(TextureImage& image, TextureKind kind) {
+    PROFILE_FUNCTION();
+    BlockFormat format = BlockFormat::BC5;
+    image.compressedFormat = GL_COMPRESSED_RG_RGTC2;
+    if (kind == TextureKind::Color) {
+        // BC3 solo si algun texel no es opaco; si no BC1 ocupa la mitad
+        bool alpha = false;
+        const unsigned char* p = image.pixels.data();
+        for (size_t i = 3; i < (size_t)image.width[0] * image.height[0] * 4 && !alpha; i += 4) alpha = p[i] != 255;
+        format = alpha ? BlockFormat::BC3 : BlockFormat::BC1;
+        image.compressedFormat = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+    image.blockBytes = (int)blockBytes(format);
+    size_t offsets[kMaxLevels];
+    size_t total = 0;
+    for (int l = 0; l < image.levels; l++) {
+        offsets[l] = total;
+        total += compressedSize(format, image.width[l], image.height[l]);
+    }
+    std::vector<unsigned char> blocks(total);
+    for (int l = 0; l < image.levels; l++) {
+        compressImage(format, image.pixels.data() + image.offset[l], image.width[l], image.height[l], blocks.data() + offsets[l]);
+        image.offset[l] = offsets[l];
+    }
+    image.pixels.swap(blocks);
+}
+
+int TextureCache::previewLevel(const TextureImage& image) {
+    int level = 0;
+    while (level + 1 < image.levels && std::max(image.width[level], image.height[level]) > kPreviewSize) level++;
+    return level;
+}
+
+std::string TextureCache::cacheFile(const Entry& entry) {
+    char name[32];
+    std::string id = entry.key + (entry.kind == TextureKind::Normal ? "#n" : "#c") + (entry.compress ? "" : "r");
+    snprintf(name, sizeof(name), "%016llx.btex", hashString(id));
+    return (std::filesystem::path(kCacheDir) / name).string();
+}
+
+bool TextureCache::readCache(const Entry& entry, TextureImage& image, int firstLevel, int endLevel) {
+    std::ifstream in(cacheFile(entry), std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+    std::streamoff size = in.tellg();
+    CacheHeader header;
+    if (size < (std::streamoff)sizeof(header)) return false;
+    in.seekg(0);
+    in.read((char*)&header, sizeof(header));
+    // Otra version, o la imagen cambio despues de guardarla
+    if (memcmp(header.magic, kCacheMagic, 4) != 0 || header.version != kCacheVersion ||
+        header.mtime != (int64_t)entry.mtime.time_since_epoch().count() ||
+        header.levels < 1 || header.levels > kMaxLevels || header.width < 1 || header.height < 1) return false;
+    if (entry.compress) {
+        if (header.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT &&
+            header.format != GL_COMPRESSED_RG_RGTC2) return false;
+        image.compressedFormat = header.format;
+        image.blockBytes = (int)blockBytes(blockFormatOf(header.format));
+    }
+    else if (header.format != GL_RGBA8) {
+        return false;
+    }
+    image.levels = header.levels;
+    // Desplazamiento de cada nivel en el archivo (despues de la cabecera)
+    size_t fileOffset[kMaxLevels + 1];
+    size_t total = 0;
+    for (int l = 0, w = header.width, h = header.height; l < image.levels; l++, w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+        image.width[l] = w;
+        image.height[l] = h;
+        fileOffset[l] = total;
+        total += image.levelBytes(l);
+    }
+    fileOffset[image.levels] = total;
+    if ((size_t)size != sizeof(header) + total) return false;
+    if (firstLevel < 0) firstLevel = previewLevel(image);
+    if (endLevel < 0 || endLevel > image.levels) endLevel = image.levels;
+    if (firstLevel >= endLevel) return false;
+    image.firstLevel = firstLevel;
+    image.endLevel = endLevel;
+    for (int l = firstLevel; l < endLevel; l++) image.offset[l] = fileOffset[l] - fileOffset[firstLevel];
+    image.pixels.resize(fileOffset[endLevel] - fileOffset[firstLevel]);
+    in.seekg(sizeof(header) + fileOffset[firstLevel]);
+    in.read((char*)image.pixels.data(), image.pixels.size());
+    return (bool)in;
+}
+
+bool TextureCache::writeCache(const Entry& entry, const TextureImage& image) {
+    std::error_code ec;
+    std::filesystem::create_directories(kCacheDir, ec);
+    std::string path = cacheFile(entry);
+    // Se escribe aparte y se renombra: otro proceso nunca lee un archivo a medias
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        CacheHeader header;
+        memcpy(header.magic, kCacheMagic, 4);
+        header.version = kCacheVersion;
+        header.format = image.compressedFormat ? image.compressedFormat : GL_RGBA8;
+        header.width = image.width[0];
+        header.height = image.height[0];
+        header.levels = image.levels;
+        header.mtime = (int64_t)entry.mtime.time_since_epoch().count();
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)image.pixels.data(), image.pixels.size());
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+TextureBinding TextureCache::binding(int id) const {
+    TextureBinding b;
+    if (id < 0 || id >= (int)m_gl.size()) return b;
+    const GlTexture& t = m_gl[id];
+    if (t.released) {
+        const GlTexture& g = m_gl[t.group];
+        b.texture = g.visible;
+        b.mode = g.atlas ? TextureBinding::Atlas : TextureBinding::Array;
+        b.layer = t.layer;
+        for (int k = 0; k < 2; k++) {
+            b.uvScale[k] = t.uvScale[k];
+            b.uvOffset[k] = t.uvOffset[k];
+        }
+    }
+    else {
+        b.texture = t.visible;
+        b.mode = TextureBinding::Single;
+    }
+    if (!b.texture) b.mode = TextureBinding::None;
+    return b;
+}
+
+void TextureCache::beginUpload(std::unique_ptr<TextureImage> image) {
+    GlTexture& t = m_gl[image->id];
+    // Niveles de un miembro que ya se dibuja desde su grupo
+    if (t.released) {
+        m_outstanding--;
+        return;
+    }
+    Upload up;
+    if (!t.name) {
+        up.initial = !t.isGroup;
+        t.compressed = image->compressedFormat != 0;
+        t.internalFormat = t.compressed ? image->compressedFormat : GL_RGBA8;
+        t.target = image->layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        t.layers = image->layers;
+        t.levels = image->levels;
+        t.width = image->width[0];
+        t.height = image->height[0];
+        for (int l = 0; l < t.levels; l++) t.levelBytes[l] = image->levelBytes(l) * t.layers;
+        t.base = t.levels;
+        glGenTextures(1, &t.name);
+        glBindTexture(t.target, t.name);
+        glTexParameteri(t.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(t.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // El atlas repite cada textura en el shader (fract); el borde del atlas no se repite
+        GLint wrap = t.atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+        glTexParameteri(t.target, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(t.target, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(t.target, GL_TEXTURE_BASE_LEVEL, t.levels - 1);
+        glTexParameteri(t.target, GL_TEXTURE_MAX_LEVEL, t.levels - 1);
+    }
+    else {
+        glBindTexture(t.target, t.name);
+    }
+    // Se reservan los niveles que trae y faltan; el contenido llega por PBO en los proximos frames
+    for (int l = image->firstLevel; l < image->endLevel; l++) {
+        if (l < t.allowed || (t.defined >> l & 1u)) continue;
+        if (t.target == GL_TEXTURE_2D_ARRAY) {
+            glTexImage3D(t.target, l, t.internalFormat, image->width[l], image->height[l], t.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else {
+            glTexImage2D(t.target, l, t.internalFormat, image->width[l], image->height[l], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        t.defined |= 1u << l;
+        m_gpuBytes += t.levelBytes[l];
+        m_rawBytes += rawLevelBytes(t.width, t.height, l) * t.layers;
+    }
+    up.level = image->endLevel - 1;
+    up.image = std::move(image);
+    m_uploads.push_back(std::move(up));
+}
+
+void TextureCache::setBaseLevel(GlTexture& t, int level) {
+    glBindTexture(t.target, t.name);
+    glTexParameteri(t.target, GL_TEXTURE_BASE_LEVEL, level);
+    t.base = level;
+    t.visible = t.name;
+}
+
+void TextureCache::evict(GlTexture& t) {
+    // La base sube primero a un nivel que queda (los mas gruesos que allowed ya estaban completos)
+    if (t.base < t.allowed) setBaseLevel(t, t.allowed);
+    glBindTexture(t.target, t.name);
+    for (int l = 0; l < t.allowed && l < t.levels; l++) {
+        if (!(t.defined >> l & 1u)) continue;
+        // Un nivel de 0x0 no ocupa memoria y queda fuera de [BASE_LEVEL, MAX_LEVEL]
+        if (t.target == GL_TEXTURE_2D_ARRAY) glTexImage3D(t.target, l, t.internalFormat, 0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        else glTexImage2D(t.target, l, t.internalFormat, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        t.defined &= ~(1u << l);
+        t.complete &= ~(1u << l);
+        m_gpuBytes -= t.levelBytes[l];
+        m_rawBytes -= rawLevelBytes(t.width, t.height, l) * t.layers;
+        m_evictedLevels++;
+    }
+}
+
+bool TextureCache::releaseGrouped() {
+    bool released = false;
+    for (GlTexture& t : m_gl) {
+        if (t.group < 0 || t.released) continue;
+        // Hasta que el grupo tenga todos los niveles pedidos se sigue usando la propia
+        const GlTexture& g = m_gl[t.group];
+        if (!g.visible || g.base > g.allowed) continue;
+        if (t.name) {
+            for (int l = 0; l < t.levels; l++) {
+                if (!(t.defined >> l & 1u)) continue;
+                m_gpuBytes -= t.levelBytes[l];
+                m_rawBytes -= rawLevelBytes(t.width, t.height, l);
+            }
+            glDeleteTextures(1, &t.name);
+        }
+        t.name = t.visible = 0;
+        t.defined = t.complete = 0;
+        t.released = true;
+        released = true;
+    }
+    return released;
+}
+
+bool TextureCache::upload(size_t budgetBytes) {
+    PROFILE_FUNCTION();
+    {
+        // swap conserva la capacidad de ambos: sin reservas en estado estable
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Despues de un clear(): lo que hay en m_decoded ya es de los ids nuevos
+        if (m_glGeneration != m_generation) {
+            m_glGeneration = m_generation;
+            releaseTextures();
+        }
+        m_incoming.swap(m_decoded);
+        if (m_gl.size() < m_entries.size()) m_gl.resize(m_entries.size());
+        for (size_t i = 0; i < m_entries.size(); i++) {
+            const Entry& e = m_entries[i];
+            GlTexture& t = m_gl[i];
+            t.allowed = e.requested;
+            t.isGroup = !e.members.empty();
+            t.atlas = e.atlas;
+            t.group = e.group;
+            t.layer = e.layer;
+            for (int k = 0; k < 2; k++) {
+                t.uvScale[k] = e.uvScale[k];
+                t.uvOffset[k] = e.uvOffset[k];
+            }
+        }
+    }
+    bool changed = false, bound = false;
+    // Niveles que el hilo principal ya no quiere (por distancia o por presupuesto)
+    for (GlTexture& t : m_gl) {
+        if (!t.name || t.allowed >= kMaxLevels || !(t.defined & ((1u << t.allowed) - 1))) continue;
+        evict(t);
+        changed = bound = true;
+    }
+    for (auto& image : m_incoming) {
+        beginUpload(std::move(image));
+        bound = true;
+    }
+    m_incoming.clear();
+    if (m_uploads.empty()) {
+        if (bound) {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        }
+        return changed;
+    }
+    if (!m_pbos[0]) {
+        glGenBuffers(kPboCount, m_pbos);
+        for (GLuint pbo : m_pbos) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, kPboSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    // Anillo de PBOs: el que se escribe no es el que la GPU puede estar leyendo
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbos[m_pboIndex]);
+    m_pboIndex = (m_pboIndex + 1) % kPboCount;
+    unsigned char* dst = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kPboSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return changed;
+    }
+    // Primero se copian las filas al PBO; glTexSubImage2D va despues de desmapear
+    // Un trozo no cruza de capa; done: completa el nivel en todas las capas
+    struct Chunk {
+        int upload, level, layer, row, rows;
+        size_t offset;
+        bool done;
+    } chunks[kMaxChunks];
+    int chunkCount = 0;
+    const size_t budget = std::min(std::max<size_t>(budgetBytes, 1), kPboSize);
+    size_t used = 0;
+    for (size_t u = 0; u < m_uploads.size() && chunkCount < kMaxChunks;) {
+        Upload& up = m_uploads[u];
+        const TextureImage& img = *up.image;
+        if (up.level < img.firstLevel) {
+            u++;
+            continue;
+        }
+        // Nivel liberado mientras esperaba, o ya subido por otro pedido
+        const GlTexture& t = m_gl[img.id];
+        if (up.level < t.allowed || !(t.defined >> up.level & 1u) || (t.complete >> up.level & 1u)) {
+            up.row = 0;
+            up.level--;
+            continue;
+        }
+        // up.row cuenta filas de todas las capas del nivel
+        size_t rowBytes = img.rowBytes(up.level);
+        const int layerRows = img.rows(up.level);
+        const int layer = up.row / layerRows, row = up.row % layerRows;
+        // Al menos una fila por llamada aunque el presupuesto sea menor
+        size_t room = used < budget ? budget - used : 0;
+        if (used == 0) room = std::max(room, rowBytes);
+        int rows = (int)std::min<size_t>(layerRows - row, room / rowBytes);
+        if (rows <= 0) break;
+        memcpy(dst + used, img.pixels.data() + img.offset[up.level] + layer * img.levelBytes(up.level) + row * rowBytes, rows * rowBytes);
+        up.row += rows;
+        bool done = up.row == layerRows * img.layers;
+        chunks[chunkCount++] = Chunk{ (int)u, up.level, layer, row, rows, used, done };
+        used += rows * rowBytes;
+        if (done) {
+            up.row = 0;
+            up.level--;
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    for (int c = 0; c < chunkCount; c++) {
+        const Chunk& ch = chunks[c];
+        const TextureImage& img = *m_uploads[ch.upload].image;
+        GlTexture& t = m_gl[img.id];
+        glBindTexture(t.target, t.name);
+        // Filas de bloques: y y alto en texeles, el ultimo bloque puede quedar cortado
+        int y = ch.row * img.rowTexels();
+        int h = std::min(ch.rows * img.rowTexels(), img.height[ch.level] - y);
+        GLsizei bytes = (GLsizei)(ch.rows * img.rowBytes(ch.level));
+        if (t.target == GL_TEXTURE_2D_ARRAY) {
+            if (img.compressedFormat) {
+                glCompressedTexSubImage3D(t.target, ch.level, 0, y, ch.layer, img.width[ch.level], h, 1, img.compressedFormat,
+                    bytes, (const void*)ch.offset);
+            }
+            else {
+                glTexSubImage3D(t.target, ch.level, 0, y, ch.layer, img.width[ch.level], h, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    (const void*)ch.offset);
+            }
+        }
+        else if (img.compressedFormat) {
+            glCompressedTexSubImage2D(t.target, ch.level, 0, y, img.width[ch.level], h, img.compressedFormat, bytes,
+                (const void*)ch.offset);
+        }
+        else {
+            glTexSubImage2D(t.target, ch.level, 0, y, img.width[ch.level], h, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)ch.offset);
+        }
+        if (!ch.done) continue;
+        // Nivel completo: la base baja mientras los niveles mas finos ya esten subidos
+        // (los pedidos de niveles pueden terminar en cualquier orden)
+        t.complete |= 1u << ch.level;
+        int base = t.base;
+        while (base > 0 && (t.complete >> (base - 1) & 1u)) base--;
+        if (base != t.base) {
+            setBaseLevel(t, base);
+            changed = true;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // La copia en CPU se libera al terminar de subir
+    for (const Upload& up : m_uploads) {
+        if (up.level >= up.image->firstLevel) continue;
+        if (up.initial) m_uploaded++;
+        m_outstanding--;
+    }
+    m_uploads.erase(std::remove_if(m_uploads.begin(), m_uploads.end(),
+        [](const Upload& up) { return up.level < up.image->firstLevel; }), m_uploads.end());
+    // Con el grupo completo, sus miembros dejan de ocupar una textura propia
+    if (releaseGrouped()) changed = true;
+    return changed;
+}
+
+void TextureCache::finish() {
+    PROFILE_FUNCTION();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_decodedCv.wait(lock, [this]() { return m_queue.empty() && m_decoding == 0; });
+    }
+    do upload(kPboSize); while (!m_uploads.empty());
+}
+
+void TextureCache::releaseTextures() {
+    for (GlTexture& t : m_gl) {
+        if (t.name) glDeleteTextures(1, &t.name);
+    }
+    m_gl.clear();
+    m_outstanding -= (int)m_uploads.size();
+    m_uploads.clear();
+    m_gpuBytes = 0;
+    m_rawBytes = 0;
+    m_uploaded = 0;
+}
+
+void TextureCache::destroyGL() {
+    releaseTextures();
+    if (m_pbos[0]) glDeleteBuffers(kPboCount, m_pbos);
+    for (GLuint& pbo : m_pbos) pbo = 0;
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Uso de la textura: decide el formato comprimido
+enum class TextureKind {
+    Color,  // BC1, o BC3 si tiene alfa
+    Normal  // BC5 (solo X e Y; Z se reconstruye en el shader)
+};
+
+// Niveles [firstLevel, endLevel) de una textura listos para subir (contiguos en
+// pixels, del mas fino al mas grueso): RGBA8 o bloques comprimidos (compressedFormat != 0).
+// width/height valen para todos los niveles; offset solo para los que trae.
+// Con layers > 1 es un array: cada nivel trae sus capas una detras de otra.
+struct TextureImage {
+    int id = -1;
+    GLenum compressedFormat = 0;
+    int blockBytes = 0;
+    int levels = 0;
+    int layers = 1;
+    int firstLevel = 0;
+    int endLevel = 0;
+    int width[16] = {};
+    int height[16] = {};
+    size_t offset[16] = {};
+    std::vector<unsigned char> pixels;
+    // La subida va por filas de texeles, o de bloques (4 texeles) si esta comprimida
+    int rowTexels() const { return compressedFormat ? 4 : 1; }
+    int rows(int level) const { return (height[level] + rowTexels() - 1) / rowTexels(); }
+    size_t rowBytes(int level) const {
+        return compressedFormat ? (size_t)((width[level] + 3) / 4) * blockBytes : (size_t)width[level] * 4;
+    }
+    // Bytes de una capa del nivel
+    size_t levelBytes(int level) const { return rows(level) * rowBytes(level); }
+};
+
+// Como dibujar una textura: sola, como capa de un array o como parte de un atlas
+// (uv = uvOffset + fract(uv) * uvScale)
+struct TextureBinding {
+    enum Mode { None = 0, Single = 1, Atlas = 2, Array = 3 };
+    Mode mode = None;
+    GLuint texture = 0;
+    int layer = 0;
+    float uvScale[2] = { 1.0f, 1.0f };
+    float uvOffset[2] = { 0.0f, 0.0f };
+};
+
+// Una textura en pantalla este frame: pixeles que ocupa (el mayor lado proyectado
+// de la parte que la usa)
+struct TextureUse {
+    int id = -1;
+    float pixels = 0.0f;
+};
+
+struct TextureStats {
+    int requested = 0;
+    int decoded = 0;
+    int uploaded = 0;
+    int failed = 0;
+    // Leidas de la cache en disco (sin decodificar) / comprimidas en esta sesion
+    int cacheHits = 0;
+    int encoded = 0;
+    // Niveles en la GPU (resident) y lo que pediria el ultimo frame sin presupuesto
+    size_t gpuBytes = 0;
+    size_t wantedBytes = 0;
+    size_t budgetBytes = 0;
+    // Lo que ocuparian los niveles en la GPU como RGBA8
+    size_t rawBytes = 0;
+    // Niveles leidos de la cache al acercarse y descartados por presupuesto
+    unsigned long long streamedLevels = 0;
+    unsigned long long evictedLevels = 0;
+    // Texturas que se dibujan desde un array o un atlas
+    int arrays = 0;
+    int atlases = 0;
+    int grouped = 0;
+    double decodeMs = 0.0;
+    double encodeMs = 0.0;
+};
+
+// Texturas de los MTL. Hilo principal: request() devuelve un id al instante y la
+// imagen se decodifica (stb_image) y se le arman los mips en el ThreadPool, desde
+// un hilo cargador propio. Lado render: upload() sube a la GPU lo ya decodificado
+// por un anillo de PBOs, con un limite de bytes por llamada, del mip mas chico al
+// mas grande; la textura se puede usar desde que tiene su nivel mas chico.
+// Una misma ruta con la misma fecha de modificacion se decodifica una sola vez.
+// Con compresion, los workers tambien comprimen los mips (BC1/BC3/BC5).
+//
+// Residencia: todos los mips se guardan en kCacheDir (un archivo por imagen, con
+// cada nivel en un desplazamiento conocido) y al principio solo se suben los de
+// kPreviewSize o menos. Cada frame updateResidency() elige el nivel mas fino que
+// necesita cada textura segun los pixeles que ocupa en pantalla; los niveles que
+// faltan se leen del archivo en el cargador y los que sobran se liberan en el
+// render. Si el total supera el presupuesto se bajan de a un nivel las texturas
+// usadas hace mas tiempo (LRU), y entre las de este frame las mas grandes.
+//
+// Agrupado: cuando el cargador queda libre, las texturas del mismo tamanno y formato
+// pasan a las capas de un GL_TEXTURE_2D_ARRAY y las chicas de tamanno suelto a un
+// atlas con margen, asi muchos materiales se dibujan con un solo enlace. Los grupos
+// se arman leyendo los archivos de cache de sus miembros; un array es una unidad de
+// residencia (sus niveles valen para todas las capas) y un atlas queda residente.
+class TextureCache {
+public:
+    static const int kMaxLevels = 16;
+    static const int kPreviewSize = 128;
+    static const int kMaxArrayLayers = 64;
+    // Atlas: lado maximo de cada textura y del atlas, niveles de mip y margen (texeles
+    // del nivel 0; multiplo de 4 << (kAtlasLevels - 1) para que cada nivel use bloques enteros)
+    static const int kAtlasMaxTexture = 512;
+    static const int kAtlasMaxSize = 4096;
+    static const int kAtlasLevels = 3;
+    static const int kAtlasPadding = 16;
+    static const char* kCacheDir;
+    TextureCache() {}
+    ~TextureCache();
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Lado render: consulta si la GPU acepta BC1/BC3 (S3TC); BC5 es parte de GL 3.0
+    void init();
+    // Hilo principal: vale para los pedidos siguientes
+    void setCompression(bool enabled) { m_compression = enabled; }
+    bool compression() const { return m_compression; }
+    // Hilo principal. -1 si el archivo no existe
+    int request(const std::string& path, TextureKind kind = TextureKind::Color);
+    std::string path(int id) const;
+    // Hilo principal: olvida todas las texturas (los ids dejan de valer). Espera la
+    // ronda del cargador en curso; lo que esta en la GPU lo borra el render en el
+    // proximo upload(). La cache en disco se conserva
+    void clear();
+    // Hilo principal, una vez por frame con las texturas visibles. Sin asignaciones
+    // en estado estable (los vectores internos conservan su capacidad)
+    void updateResidency(const std::vector<TextureUse>& uses, size_t budgetBytes);
+    // Quedan texturas (o niveles) por leer o por subir
+    bool busy() const { return m_outstanding.load() > 0; }
+    TextureStats stats() const;
+
+    // Lado render (con el contexto GL activo). Devuelve true si alguna textura cambio
+    bool upload(size_t budgetBytes);
+    // Mode None mientras la textura no tiene ningun nivel en la GPU
+    TextureBinding binding(int id) const;
+    // Espera a que se lea todo lo pedido y lo sube sin limite (capturas y benchmark)
+    void finish();
+    void destroyGL();
+
+private:
+    static const int kPboCount = 3;
+    static const size_t kPboSize = 4u << 20;
+    // Lecturas de niveles seguidas que pueden fallar antes de dejar de pedirlos
+    static const int kMaxReadRetries = 3;
+    struct Entry {
+        std::string path;
+        // Ruta canonica: nombre del archivo de cache
+        std::string key;
+        std::filesystem::file_time_type mtime;
+        TextureKind kind = TextureKind::Color;
+        bool compress = false;
+        // Datos de la imagen (validos desde que termina la primera carga)
+        bool known = false;
+        GLenum format = 0;
+        // Sin archivo de cache no se puede volver a leer un nivel: queda todo residente
+        bool pinned = false;
+        int levels = 0;
+        int width = 0, height = 0;
+        size_t levelBytes[16] = {};
+        // Nivel mas fino pedido al render (los mas gruesos tambien); kMaxLevels = ninguno
+        int requested = kMaxLevels;
+        // Lecturas de niveles fallidas seguidas; tras kMaxReadRetries no se pide nada
+        // mas fino que minLevel
+        int readFailures = 0;
+        int minLevel = 0;
+        // Uso en el frame en curso y ultimo frame en que se vio
+        int wanted = kMaxLevels;
+        int target = kMaxLevels;
+        unsigned long long lastUsed = 0;
+        // Miembro: grupo que lo dibuja (-1 = sola), capa o lugar en el atlas. Ya se
+        // considero para agrupar (no se vuelve a mirar)
+        int group = -1;
+        int layer = 0;
+        int atlasX = 0, atlasY = 0;
+        float uvScale[2] = { 1.0f, 1.0f };
+        float uvOffset[2] = { 0.0f, 0.0f };
+        bool grouped = false;
+        // Grupo: ids de los miembros (array en orden de capa, o atlas)
+        std::vector<int> members;
+        bool atlas = false;
+    };
+    // Trabajo del cargador: carga inicial (endLevel = 0) o niveles [firstLevel, endLevel) del archivo
+    struct Job {
+        int id = -1;
+        int firstLevel = 0;
+        int endLevel = 0;
+    };
+    // Resultado de un trabajo del cargador
+    struct LoadResult {
+        std::unique_ptr<TextureImage> image;
+        bool cacheHit = false;
+        bool encoded = false;
+        bool cached = false;
+        double ms = 0.0;
+        double encodeMs = 0.0;
+    };
+    // Estado GL de un id (solo lado render)
+    struct GlTexture {
+        GLuint name = 0;
+        // GL_TEXTURE_2D o GL_TEXTURE_2D_ARRAY (grupo)
+        GLenum target = GL_TEXTURE_2D;
+        int layers = 1;
+        bool isGroup = false;
+        bool atlas = false;
+        // Nombre para dibujar: name desde que el nivel mas chico esta subido
+        GLuint visible = 0;
+        GLenum internalFormat = 0;
+        bool compressed = false;
+        int levels = 0;
+        int width = 0, height = 0;
+        // Nivel completo mas fino (levels = ninguno); niveles con memoria reservada y
+        // niveles ya subidos (bits)
+        int base = 0;
+        unsigned int defined = 0;
+        unsigned int complete = 0;
+        // Copia de Entry::requested: lo mas fino que se puede tener
+        int allowed = kMaxLevels;
+        size_t levelBytes[16] = {};
+        // Copia de los datos de grupo de Entry; released: la textura propia se borro y
+        // se dibuja desde el grupo
+        int group = -1;
+        int layer = 0;
+        float uvScale[2] = { 1.0f, 1.0f };
+        float uvOffset[2] = { 0.0f, 0.0f };
+        bool released = false;
+    };
+    // Subida en curso: nivel y fila siguientes (los niveles van de endLevel-1 a firstLevel)
+    struct Upload {
+        std::unique_ptr<TextureImage> image;
+        int level = 0;
+        int row = 0;
+        bool initial = false;
+    };
+    void loaderMain();
+    static void load(const Entry& entry, const Job& job, LoadResult& result);
+    // Arma los niveles de un array o un atlas desde los archivos de cache de sus miembros
+    static void loadGroup(const Entry& group, const std::vector<Entry>& members, const Job& job, LoadResult& result);
+    // Hilo principal, con el cargador libre: agrupa las texturas nuevas
+    void formGroups();
+    int addGroup(std::vector<int> members, bool atlas, int width, int height);
+    static bool decode(const std::string& path, TextureImage& image);
+    static void buildMips(TextureImage& image);
+    static void compress(TextureImage& image, TextureKind kind);
+    static int previewLevel(const TextureImage& image);
+    static std::string cacheFile(const Entry& entry);
+    // firstLevel < 0: desde previewLevel; endLevel < 0: hasta el ultimo
+    static bool readCache(const Entry& entry, TextureImage& image, int firstLevel, int endLevel);
+    static bool writeCache(const Entry& entry, const TextureImage& image);
+    void beginUpload(std::unique_ptr<TextureImage> image);
+    // Lado render: borra las texturas y descarta las subidas en curso
+    void releaseTextures();
+    void evict(GlTexture& t);
+    void setBaseLevel(GlTexture& t, int level);
+    // Borra las texturas propias de los miembros cuyo grupo ya tiene todos sus niveles.
+    // true si alguna paso a dibujarse desde su grupo
+    bool releaseGrouped();
+
+    // Compartido entre el hilo principal, el cargador y el render
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_decodedCv;
+    std::vector<Entry> m_entries;
+    std::map<std::string, int> m_byPath;
+    std::vector<Job> m_queue;
+    std::vector<std::unique_ptr<TextureImage>> m_decoded;
+    int m_decoding = 0;
+    int m_decodedCount = 0;
+    int m_failed = 0;
+    int m_cacheHits = 0;
+    int m_encoded = 0;
+    double m_decodeMs = 0.0;
+    double m_encodeMs = 0.0;
+    size_t m_wantedBytes = 0;
+    size_t m_budgetBytes = 0;
+    unsigned long long m_frame = 0;
+    unsigned long long m_streamedLevels = 0;
+    // Hay texturas cargadas que todavia no se consideraron para agrupar
+    bool m_ungrouped = false;
+    int m_arrays = 0;
+    int m_atlases = 0;
+    int m_grouped = 0;
+    // Sube con cada clear(); el render lo compara con m_glGeneration
+    unsigned int m_generation = 0;
+    bool m_stop = false;
+    std::thread m_loader;
+    std::atomic<int> m_outstanding{ 0 };
+    std::atomic<int> m_uploaded{ 0 };
+    std::atomic<size_t> m_gpuBytes{ 0 };
+    std::atomic<size_t> m_rawBytes{ 0 };
+    std::atomic<unsigned long long> m_evictedLevels{ 0 };
+    bool m_compression = true;
+    std::atomic<bool> m_s3tc{ false };
+
+    // Solo lado render
+    std::vector<GlTexture> m_gl;
+    std::vector<Upload> m_uploads;
+    std::vector<std::unique_ptr<TextureImage>> m_incoming;
+    GLuint m_pbos[kPboCount] = {};
+    int m_pboIndex = 0;
+    unsigned int m_glGeneration = 0;
+};
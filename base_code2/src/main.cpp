@@ -1,12 +1,26 @@
 #include "3DViewer.h"
 #include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
+    BatchJob job;
+    bool headless = false;
+    if (!parseBatchArgs(argc, argv, job, headless)) return 2;
+    if (job.cpuTrace) PROFILE_CAPTURE(true);
     C3DViewer main;
-    if (!main.setup()) {
+    if (headless) {
+        if (!main.setupHeadless(job.width, job.height)) {
+            fprintf(stderr, "Failed to setup headless C3DViewer\n");
+            return -1;
+        }
+    }
+    else if (!main.setup()) {
         fprintf(stderr, "Failed to setup C3DViewer\n");
         return -1;
     }
+    // Benchmark: con o sin ventana, sale con 3 si se supera el presupuesto
+    if (job.benchmark.enabled) return main.runBenchmark(job);
+    // Render por lotes sin ventana: sale con 1 si algun modelo o captura fallo
+    if (headless) return main.runBatch(job) == 0 ? 0 : 1;
     main.mainLoop();
     return 0;
 }